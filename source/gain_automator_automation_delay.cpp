@@ -0,0 +1,323 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_automation_delay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Copies 'num_samples' to or from a circular line, starting at 'index'.
+template <typename SampleType>
+void write_wrapped(SampleType* line,
+                   int line_size,
+                   int index,
+                   const SampleType* in,
+                   int num_samples)
+{
+    const int first = std::min(num_samples, line_size - index);
+    std::memcpy(line + index, in, first * sizeof(SampleType));
+    std::memcpy(line, in + first, (num_samples - first) * sizeof(SampleType));
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void read_wrapped(const SampleType* line,
+                  int line_size,
+                  int index,
+                  SampleType* out,
+                  int num_samples)
+{
+    const int first = std::min(num_samples, line_size - index);
+    std::memcpy(out, line + index, first * sizeof(SampleType));
+    std::memcpy(out + first, line, (num_samples - first) * sizeof(SampleType));
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+float to_automation_offset(double normalized)
+{
+    const double clamped = std::min(std::max(normalized, 0.), 1.);
+    return static_cast<float>((2. * clamped - 1.) * kMaxAutomationOffset);
+}
+
+//------------------------------------------------------------------------
+double to_normalized_automation_offset(float milliseconds)
+{
+    return 0.5 + static_cast<double>(milliseconds) / (2. * kMaxAutomationOffset);
+}
+
+//------------------------------------------------------------------------
+int get_offset_samples(float milliseconds, double sample_rate)
+{
+    return static_cast<int>(std::lround(milliseconds * 0.001 * sample_rate));
+}
+
+//------------------------------------------------------------------------
+// automation_delay
+//------------------------------------------------------------------------
+void automation_delay::setup(int max_delay, int max_points_per_block, int max_queued)
+{
+    // At most one point per sample of the delay, plus points sharing an offset.
+    this->max_delay  = std::max(max_delay, 0);
+    const int queued = max_queued > 0 ? std::min(this->max_delay, max_queued) : this->max_delay;
+    const int size   = queued + 2 * std::max(max_points_per_block, 1);
+    ring.assign(size, breakpoint());
+    due.assign(size, automation_point());
+    reset();
+}
+
+//------------------------------------------------------------------------
+void automation_delay::reset()
+{
+    front    = 0;
+    count    = 0;
+    position = 0;
+}
+
+//------------------------------------------------------------------------
+void automation_delay::collapse()
+{
+    if (count == 0)
+        return;
+
+    const float value = ring[(front + count - 1) % static_cast<int>(ring.size())].value;
+    ring[0]           = {position, value};
+    front             = 0;
+    count             = 1;
+}
+
+//------------------------------------------------------------------------
+void automation_delay::push(std::int64_t point_position, float value)
+{
+    const int size = static_cast<int>(ring.size());
+    if (count > 0)
+    {
+        breakpoint& back = ring[(front + count - 1) % size];
+        point_position   = std::max(point_position, back.position);
+
+        // Only with many points per sample: the newest takes the value.
+        if (count == size)
+        {
+            back.value = value;
+            return;
+        }
+    }
+    ring[(front + count) % size] = {point_position, value};
+    ++count;
+}
+
+//------------------------------------------------------------------------
+const automation_point* automation_delay::process(const automation_point* points,
+                                                  int num_points,
+                                                  int delay,
+                                                  int num_samples,
+                                                  int& num_due)
+{
+    delay = std::min(std::max(delay, 0), max_delay);
+    if (delay == 0 && count == 0)
+    {
+        position += num_samples;
+        num_due = num_points;
+        return points;
+    }
+
+    for (int i = 0; i < num_points; ++i)
+        push(position + delay + points[i].offset, points[i].value);
+
+    const int size         = static_cast<int>(ring.size());
+    const std::int64_t end = position + num_samples;
+    num_due                = 0;
+    while (count > 0 && ring[front].position < end)
+    {
+        due[num_due++] = {static_cast<int>(ring[front].position - position), ring[front].value};
+        front          = front + 1 < size ? front + 1 : 0;
+        --count;
+    }
+    position = end;
+    return due.data();
+}
+
+//------------------------------------------------------------------------
+// audio_delay
+//------------------------------------------------------------------------
+void audio_delay::setup(int max_delay, int num_channels, int max_samples_per_block, bool is_double)
+{
+    delay        = std::max(max_delay, 0);
+    max_channels = std::max(num_channels, 0);
+    max_samples  = std::max(max_samples_per_block, 0);
+    line_size    = delay + max_samples;
+
+    // Only the sample type in use takes memory.
+    const size_t lines_size  = static_cast<size_t>(max_channels) * line_size;
+    const size_t blocks_size = static_cast<size_t>(max_channels) * max_samples;
+    lines32.assign(is_double ? 0 : lines_size, 0.f);
+    lines64.assign(is_double ? lines_size : 0, 0.);
+    blocks32.assign(is_double ? 0 : blocks_size, 0.f);
+    blocks64.assign(is_double ? blocks_size : 0, 0.);
+    outputs32.assign(is_double ? 0 : max_channels, nullptr);
+    outputs64.assign(is_double ? max_channels : 0, nullptr);
+    for (int channel = 0; channel < static_cast<int>(outputs32.size()); ++channel)
+        outputs32[channel] = blocks32.data() + channel * max_samples;
+    for (int channel = 0; channel < static_cast<int>(outputs64.size()); ++channel)
+        outputs64[channel] = blocks64.data() + channel * max_samples;
+
+    reset();
+}
+
+//------------------------------------------------------------------------
+void audio_delay::reset()
+{
+    std::fill(lines32.begin(), lines32.end(), 0.f);
+    std::fill(lines64.begin(), lines64.end(), 0.);
+    write_index = 0;
+}
+
+//------------------------------------------------------------------------
+void audio_delay::set_delay(int new_delay)
+{
+    delay = std::min(std::max(new_delay, 0), line_size - max_samples);
+    reset();
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType* audio_delay::get_line(int channel)
+{
+    if constexpr (std::is_same<SampleType, float>::value)
+        return lines32.data() + channel * line_size;
+    else
+        return lines64.data() + channel * line_size;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType** audio_delay::get_outputs()
+{
+    if constexpr (std::is_same<SampleType, float>::value)
+        return outputs32.empty() ? nullptr : outputs32.data();
+    else
+        return outputs64.empty() ? nullptr : outputs64.data();
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType** audio_delay::process(SampleType* const* in, int num_channels, int num_samples)
+{
+    SampleType** outputs = get_outputs<SampleType>();
+    if (!outputs || line_size == 0 || num_channels > max_channels || num_samples > max_samples)
+        return nullptr;
+
+    // Written first, so a delay shorter than the block reads part of it.
+    const int read_index = (write_index + line_size - delay) % line_size;
+    for (int channel = 0; channel < num_channels; ++channel)
+    {
+        SampleType* line = get_line<SampleType>(channel);
+        write_wrapped(line, line_size, write_index, in[channel], num_samples);
+        read_wrapped(line, line_size, read_index, outputs[channel], num_samples);
+    }
+    write_index = (write_index + num_samples) % line_size;
+    return outputs;
+}
+
+//------------------------------------------------------------------------
+// position_delay
+//------------------------------------------------------------------------
+void position_delay::reset()
+{
+    front      = 0;
+    count      = 0;
+    num_queued = 0;
+}
+
+//------------------------------------------------------------------------
+const position_run*
+position_delay::process(std::int64_t position, int num_samples, int delay, int& num_runs)
+{
+    // A new run, unless the block continues the latest one.
+    position          = std::max<std::int64_t>(position, -1);
+    bool is_continued = false;
+    if (count > 0)
+    {
+        const run_start& back = history[(front + count - 1) % kHistorySize];
+        is_continued = position < 0 ? back.position < 0
+                                    : back.position >= 0 &&
+                                          back.position + num_queued - back.sample == position;
+    }
+    if (!is_continued)
+    {
+        // A host locating every few samples: the oldest run is forgotten.
+        if (count == kHistorySize)
+        {
+            front = (front + 1) % kHistorySize;
+            --count;
+        }
+        history[(front + count) % kHistorySize] = {num_queued, position};
+        ++count;
+    }
+    num_queued += num_samples;
+
+    // Runs which ended before the delayed block are not needed anymore.
+    const std::int64_t end   = num_queued - std::max(delay, 0);
+    const std::int64_t begin = end - num_samples;
+    while (count > 1 && history[(front + 1) % kHistorySize].sample <= begin)
+    {
+        front = (front + 1) % kHistorySize;
+        --count;
+    }
+
+    num_runs = 0;
+    const run_start& oldest = history[front];
+    if (begin < oldest.sample)
+        add_run(0, static_cast<int>(std::min(oldest.sample, end) - begin), -1, num_runs);
+    for (int index = 0; index < count; ++index)
+    {
+        const run_start& run = history[(front + index) % kHistorySize];
+        const std::int64_t run_end =
+            index + 1 < count ? history[(front + index + 1) % kHistorySize].sample : num_queued;
+        const std::int64_t first = std::max(begin, run.sample);
+        const std::int64_t last  = std::min(end, run_end);
+        if (first >= last)
+            continue;
+
+        const std::int64_t first_position =
+            run.position < 0 ? -1 : run.position + first - run.sample;
+        add_run(static_cast<int>(first - begin), static_cast<int>(last - first), first_position,
+                num_runs);
+    }
+    return runs.data();
+}
+
+//------------------------------------------------------------------------
+void position_delay::add_run(int offset, int length, std::int64_t position, int& num_runs)
+{
+    // Beyond kMaxRuns, and between runs without a position, the runs merge.
+    if (num_runs > 0)
+    {
+        position_run& last = runs[num_runs - 1];
+        if (num_runs == kMaxRuns || (position < 0 && last.position < 0))
+        {
+            last.length   = offset + length - last.offset;
+            last.position = -1;
+            return;
+        }
+    }
+    runs[num_runs++] = {offset, length, position};
+}
+
+//------------------------------------------------------------------------
+template float** audio_delay::process<float>(float* const*, int, int);
+template double** audio_delay::process<double>(double* const*, int, int);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
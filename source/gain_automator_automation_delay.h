@@ -0,0 +1,181 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_segments.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Time offset of the gain automation in ms, mapped linearly to [0, 1],
+// 0.5 is no offset. Positive offsets apply the automation later, negative
+// ones earlier, which needs the audio delayed by the maximum: the offset
+// lookahead, a setting of its own, as it is the latency.
+static constexpr float kMaxAutomationOffset = 250.f;
+
+float to_automation_offset(double normalized);
+double to_normalized_automation_offset(float milliseconds);
+
+// The offset in samples, rounded, negative for negative offsets.
+int get_offset_samples(float milliseconds, double sample_rate);
+
+//------------------------------------------------------------------------
+// automation_delay
+//
+// Delays the points of one parameter by a number of samples: a ring of
+// breakpoints at absolute sample positions, allocated by setup(). Every
+// block queues its points and takes those falling due within the block,
+// rebased to its start. A point is due at its position plus the delay at
+// the time it was queued, but never before the points queued earlier, so
+// a shrinking delay does not reorder them.
+//
+// With a delay of 0 and nothing queued, process() returns the block's own
+// points, without a copy.
+//------------------------------------------------------------------------
+class automation_delay
+{
+public:
+    // Not real-time safe. The ring holds one point per sample of the delay
+    // unless 'max_queued' caps it. Beyond that, the newest point takes the
+    // value of the latest queued one.
+    void setup(int max_delay, int max_points_per_block, int max_queued = 0);
+    void reset();
+
+    // Drops the queued points but the latest, which falls due at the start
+    // of the next block: for a delay that jumps, so no value gets lost.
+    void collapse();
+
+    // Returns the points due in this block, 'num_due' of them.
+    const automation_point* process(const automation_point* points,
+                                    int num_points,
+                                    int delay,
+                                    int num_samples,
+                                    int& num_due);
+
+    bool is_empty() const { return count == 0; }
+
+private:
+    struct breakpoint
+    {
+        std::int64_t position = 0;
+        float value           = 0.f;
+    };
+
+    void push(std::int64_t position, float value);
+
+    std::vector<breakpoint> ring;
+    std::vector<automation_point> due;
+    int front             = 0;
+    int count             = 0;
+    int max_delay         = 0;
+    std::int64_t position = 0; // of the block
+};
+
+//------------------------------------------------------------------------
+// audio_delay
+//
+// A delay of all channels of a bus, fixed while processing: circular
+// lines of the maximum delay plus one block, allocated for one sample
+// type by setup(). The delayed block is copied out contiguously, so the
+// gain kernels read it as they read the host's buffers.
+//------------------------------------------------------------------------
+class audio_delay
+{
+public:
+    // Not real-time safe. The delay starts at 'max_delay'.
+    void setup(int max_delay, int num_channels, int max_samples_per_block, bool is_double);
+    void reset();
+
+    // Up to the maximum of setup(). Clears the lines, like reset().
+    void set_delay(int delay);
+    int get_delay() const { return delay; }
+
+    // Writes 'in' to the lines and returns the block 'delay' samples ago.
+    // Null if the block does not fit the setup.
+    template <typename SampleType>
+    SampleType** process(SampleType* const* in, int num_channels, int num_samples);
+
+private:
+    template <typename SampleType>
+    SampleType* get_line(int channel);
+    template <typename SampleType>
+    SampleType** get_outputs();
+
+    int delay        = 0;
+    int max_channels = 0;
+    int max_samples  = 0;
+    int line_size    = 0; // delay + max_samples
+    int write_index  = 0;
+
+    std::vector<float> lines32;
+    std::vector<double> lines64;
+    std::vector<float> blocks32;
+    std::vector<double> blocks64;
+    std::vector<float*> outputs32;
+    std::vector<double*> outputs64;
+};
+
+//------------------------------------------------------------------------
+// position_run
+//
+// Samples of a block with consecutive project times from 'position', or
+// without a position (negative) where the transport was not running.
+//------------------------------------------------------------------------
+struct position_run
+{
+    int offset            = 0;
+    int length            = 0;
+    std::int64_t position = -1;
+};
+
+//------------------------------------------------------------------------
+// position_delay
+//
+// Where the samples of delayed audio were on the host timeline: a short
+// history of the runs of consecutive project times the blocks had when
+// they were queued. A block coming out of an audio_delay of the same
+// length gets its runs, which may change at a locate or loop. Samples
+// older than the history, e.g. from before the start, have no position.
+// Never allocates.
+//------------------------------------------------------------------------
+class position_delay
+{
+public:
+    // Runs per block. With more, the rest of the block has no position.
+    static constexpr int kMaxRuns = 4;
+
+    void reset();
+
+    // Queues a block of 'num_samples' at 'position' (negative without a
+    // running transport) and returns the runs of the block 'delay'
+    // samples ago, 'num_runs' of them.
+    const position_run*
+    process(std::int64_t position, int num_samples, int delay, int& num_runs);
+
+private:
+    static constexpr int kHistorySize = 64;
+
+    struct run_start
+    {
+        std::int64_t sample   = 0; // samples queued before the run
+        std::int64_t position = -1;
+    };
+
+    void add_run(int offset, int length, std::int64_t position, int& num_runs);
+
+    std::array<run_start, kHistorySize> history;
+    std::array<position_run, kMaxRuns> runs;
+    int front               = 0;
+    int count               = 0;
+    std::int64_t num_queued = 0;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,286 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_capture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// capture_encoder
+//------------------------------------------------------------------------
+void capture_encoder::setup(double sample_rate, int max_samples_per_block, int max_delay)
+{
+    const double rate = sample_rate > 0. ? sample_rate : 44100.;
+    max_length        = static_cast<std::int32_t>(rate * kMaxCaptureRecordTime);
+    max_samples       = std::max(max_samples_per_block, 0);
+    line.assign(std::max(max_delay, 0) + max_samples, 1.f);
+    block.assign(max_samples, 1.f);
+    delay = 0;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::reset()
+{
+    position    = 0;
+    has_pending = false;
+    has_gap     = false;
+    std::fill(line.begin(), line.end(), 1.f);
+    write_index = 0;
+    latest_gain = 1.f;
+    changes[0]  = flags_change();
+    num_changes = 1;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::set_delay(int new_delay)
+{
+    new_delay = std::min(std::max(new_delay, 0), static_cast<int>(line.size()) - max_samples);
+    if (new_delay == delay)
+        return;
+
+    std::fill(line.begin(), line.end(), latest_gain);
+    delay = new_delay;
+
+    // Like the gain, the flags start over from the latest.
+    changes[0]  = changes[num_changes - 1];
+    num_changes = 1;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::set_channel_gains(bool is_applied)
+{
+    const std::uint32_t flags = is_applied ? static_cast<std::uint32_t>(kCaptureChannelGains) : 0u;
+    flags_change& back        = changes[num_changes - 1];
+    if (back.flags == flags)
+        return;
+
+    if (back.position == position && num_changes > 1)
+    {
+        // Switched back before a block was added.
+        --num_changes;
+        return;
+    }
+
+    // Switching every few samples: the oldest change is forgotten.
+    if (num_changes == kMaxFlagsChanges)
+    {
+        std::copy(changes.begin() + 1, changes.end(), changes.begin());
+        --num_changes;
+    }
+    changes[num_changes++] = {position, flags};
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::add(const gain_curve& curve,
+                          const float* reduction,
+                          const position_run* runs,
+                          int num_runs,
+                          capture_queue& queue)
+{
+    const int num_samples = curve.get_num_samples();
+    if (num_samples <= 0)
+        return;
+
+    latest_gain = curve.get_last_gain();
+
+    // Without a limiter the curve is taken over as it is.
+    const bool is_delayed = (delay > 0 || reduction) && num_samples <= max_samples;
+    bool is_constant      = false;
+    if (is_delayed)
+    {
+        // Written first, like the limiter's delay lines.
+        curve.render(block.data());
+        const int size  = static_cast<int>(line.size());
+        const int first = std::min(num_samples, size - write_index);
+        std::copy(block.data(), block.data() + first, line.data() + write_index);
+        std::copy(block.data() + first, block.data() + num_samples, line.data());
+
+        int read_index = (write_index + size - delay) % size;
+        is_constant    = true;
+        for (int i = 0; i < num_samples; ++i)
+        {
+            block[i] = reduction ? line[read_index] * reduction[i] : line[read_index];
+            is_constant &= block[i] == block[0];
+            read_index = read_index + 1 < size ? read_index + 1 : 0;
+        }
+        write_index = (write_index + num_samples) % size;
+    }
+
+    for (int index = 0; index < num_runs; ++index)
+    {
+        // Runs are cut where the flags change.
+        const position_run& run = runs[index];
+        const int end           = run.offset + run.length;
+        begin_run(run);
+        for (int first = run.offset; first < end;)
+        {
+            std::int64_t next_change = 0;
+            record_flags             = get_flags(position + first, next_change);
+            const int last = static_cast<int>(std::min<std::int64_t>(end, next_change - position));
+            if (!is_delayed)
+                add_curve(curve, first, last - first, queue);
+            else if (is_constant)
+                add_segment(first, last - first, block[0], 0.f, 0, queue);
+            else
+                add_samples(block.data(), first, last - first, queue);
+            first = last;
+        }
+    }
+    position += num_samples;
+
+    // Changes which no longer reach the output are not needed anymore.
+    int num_passed = 0;
+    while (num_passed + 1 < num_changes && changes[num_passed + 1].position <= position - delay)
+        ++num_passed;
+    std::copy(changes.begin() + num_passed, changes.begin() + num_changes, changes.begin());
+    num_changes -= num_passed;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::add_curve(const gain_curve& curve,
+                                int offset,
+                                int length,
+                                capture_queue& queue)
+{
+    const int end = offset + length;
+    switch (curve.get_shape())
+    {
+        case gain_curve::shape::constant:
+            add_segment(offset, length, curve.get_constant(), 0.f, 0, queue);
+            break;
+        case gain_curve::shape::segments:
+            // Segments cut at a run continue their ramp's phase.
+            for (const auto& segment : curve.get_segments())
+            {
+                const int first = std::max(segment.offset, offset);
+                const int last  = std::min(segment.offset + segment.length, end);
+                if (first < last)
+                    add_segment(first, last - first, segment.start, segment.increment,
+                                segment.phase + first - segment.offset, queue);
+            }
+            break;
+        case gain_curve::shape::samples:
+            add_samples(curve.get_samples(), offset, length, queue);
+            break;
+    }
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::begin_run(const position_run& run)
+{
+    run_offset       = run.offset;
+    run_project_time = run.position;
+}
+
+//------------------------------------------------------------------------
+std::uint32_t capture_encoder::get_flags(std::int64_t output_position,
+                                         std::int64_t& next_change) const
+{
+    // The output is 'delay' samples behind the blocks added.
+    const std::int64_t added = output_position - delay;
+    int index                = 0;
+    while (index + 1 < num_changes && changes[index + 1].position <= added)
+        ++index;
+
+    next_change = index + 1 < num_changes ? changes[index + 1].position + delay
+                                          : std::numeric_limits<std::int64_t>::max();
+    return changes[index].flags;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::add_segment(
+    int offset, int length, float start, float increment, int phase, capture_queue& queue)
+{
+    const std::int64_t segment_position = position + offset;
+    const std::int64_t project_time =
+        run_project_time < 0 ? -1 : run_project_time + offset - run_offset;
+
+    // Only constant runs are merged, a merged ramp would not reproduce the
+    // rounding of the second one.
+    if (has_pending && increment == 0.f && pending.increment == 0.f && start == pending.start &&
+        (pending.flags & kCaptureChannelGains) == record_flags &&
+        segment_position == pending.position + pending.length &&
+        (project_time < 0 ? pending.project_time < 0
+                          : project_time == pending.project_time + pending.length) &&
+        pending.length + length <= max_length)
+    {
+        pending.length += length;
+        return;
+    }
+
+    push_pending(queue);
+    pending.position     = segment_position;
+    pending.project_time = project_time;
+    pending.length       = length;
+    pending.flags        = static_cast<std::uint32_t>(phase) << kCapturePhaseShift | record_flags;
+    pending.start        = start;
+    pending.increment    = increment;
+    has_pending          = true;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::add_samples(const float* gains,
+                                  int offset,
+                                  int num_samples,
+                                  capture_queue& queue)
+{
+    // Swing door: extend the segment as long as one slope stays within the
+    // tolerance of every sample since its start.
+    const int end = offset + num_samples;
+    int first     = offset;
+    while (first < end)
+    {
+        const double start = gains[first];
+        double lower       = -std::numeric_limits<double>::infinity();
+        double upper       = std::numeric_limits<double>::infinity();
+
+        int last = first + 1;
+        for (; last < end; ++last)
+        {
+            const double gain      = gains[last];
+            const double tolerance = std::abs(gain) * kCaptureTolerance;
+            const double steps     = last - first;
+            const double new_lower = std::max(lower, (gain - tolerance - start) / steps);
+            const double new_upper = std::min(upper, (gain + tolerance - start) / steps);
+            if (new_lower > new_upper)
+                break;
+
+            lower = new_lower;
+            upper = new_upper;
+        }
+
+        const int length      = last - first;
+        const float increment = length > 1 ? static_cast<float>(0.5 * (lower + upper)) : 0.f;
+        add_segment(first, length, gains[first], increment, 0, queue);
+        first = last;
+    }
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::push_pending(capture_queue& queue)
+{
+    if (!has_pending)
+        return;
+
+    if (has_gap)
+        pending.flags |= kCaptureGap;
+
+    has_gap     = !queue.push(pending);
+    has_pending = false;
+}
+
+//------------------------------------------------------------------------
+void capture_encoder::flush(capture_queue& queue)
+{
+    push_pending(queue);
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
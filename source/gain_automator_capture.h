@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_automation_delay.h"
+#include "gain_automator_gain_curve.h"
+#include "gain_automator_spsc_queue.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// capture_record
+//
+// One segment of the applied gain: gain[i] = start + increment *
+// (phase + i) for the 'length' samples from 'position', the same float
+// expression as the gain kernels. 'phase' (see gain_segment) is kept in
+// the upper bits of 'flags'. 'position' counts the output samples since
+// the capture started, 'project_time' is the project time of the audio
+// the first of them was processed from, or -1 while the transport was
+// stopped. The gain includes the output ceiling's gain reduction and is
+// aligned with the output.
+//
+// The gain is the one all channels share. Trims, balance and mid/side
+// (see channel_gains) come on top per channel and are not recorded, the
+// records of audio they were applied to are flagged kCaptureChannelGains.
+//------------------------------------------------------------------------
+// capture_record::flags
+enum capture_flags : std::uint32_t
+{
+    kCaptureGap          = 1 << 0, // records before this one were dropped, the queue was full
+    kCaptureChannelGains = 1 << 1, // trims, balance or mid/side were applied on top
+    kCapturePhaseShift   = 8       // bits 8 to 31: the phase
+};
+
+struct capture_record
+{
+    std::int64_t position     = 0;
+    std::int64_t project_time = -1;
+    std::int32_t length       = 0;
+    std::uint32_t flags       = 0;
+    float start               = 0.f;
+    float increment           = 0.f;
+
+    int get_phase() const { return static_cast<int>(flags >> kCapturePhaseShift); }
+    float get_gain(int i) const { return start + increment * static_cast<float>(get_phase() + i); }
+};
+
+static_assert(sizeof(capture_record) == 32, "capture_record is part of the file format");
+
+//------------------------------------------------------------------------
+// capture_file_header
+//
+// Start of a capture file, followed by capture_record entries up to the
+// end of the file. A file which was not closed properly ends in zeroed
+// records of length 0 instead. All values are little endian.
+//------------------------------------------------------------------------
+struct capture_file_header
+{
+    static constexpr std::uint32_t kMagic   = 0x6c634147; // 'GAcl'
+    static constexpr std::uint32_t kVersion = 1;
+
+    std::uint32_t magic       = kMagic;
+    std::uint32_t version     = kVersion;
+    std::uint32_t header_size = sizeof(capture_file_header);
+    std::uint32_t record_size = sizeof(capture_record);
+    double sample_rate        = 0.;
+    std::int64_t start_time   = 0; // seconds since 1970-01-01 UTC
+    std::uint8_t reserved[32] = {};
+};
+
+static_assert(sizeof(capture_file_header) == 64, "capture_file_header is part of the file format");
+
+// About 0.1 seconds of records at one record per sample.
+using capture_queue = spsc_queue<capture_record, 4096>;
+
+// Per sample curves are fitted by linear segments within this relative
+// deviation (about 0.0001 dB). Constant and linear segments are exact.
+static constexpr float kCaptureTolerance = 1e-5f;
+
+// Constant runs are cut after this many seconds, so a writer is never
+// further behind than that.
+static constexpr double kMaxCaptureRecordTime = 60.;
+
+//------------------------------------------------------------------------
+// capture_encoder
+//
+// Turns the gain curves of consecutive blocks into capture_records on the
+// audio thread. Constant runs are merged across blocks, so sparse
+// automation costs a few records per minute; linear ramps are taken over
+// as they are and per sample curves are fitted by linear segments
+// (swing door). Records which do not fit into the queue are dropped and
+// the next one is flagged kCaptureGap. Never blocks, never allocates.
+//
+// Behind a lookahead limiter the curve is delayed by its latency and
+// multiplied by its gains per sample, the composite is fitted like a per
+// sample curve unless it is constant.
+//------------------------------------------------------------------------
+class capture_encoder
+{
+public:
+    // Allocates the delay line. Not real-time safe.
+    void setup(double sample_rate, int max_samples_per_block, int max_delay);
+
+    // Starts over at position 0, nothing pending.
+    void reset();
+
+    // The latency of the limiter behind the gain stage, up to the maximum
+    // of setup(). A new delay starts from the latest gain.
+    void set_delay(int delay);
+
+    // Whether the channel stage is applied to the next block. Its records
+    // are flagged kCaptureChannelGains once they reach the output.
+    void set_channel_gains(bool is_applied);
+
+    // Adds the applied 'curve' of the next block. 'reduction' holds the
+    // limiter's gains of the block, null without. 'runs' are where the
+    // output block is on the host timeline, see position_delay.
+    void add(const gain_curve& curve,
+             const float* reduction,
+             const position_run* runs,
+             int num_runs,
+             capture_queue& queue);
+
+    // Pushes the record still open for merging, e.g. before stopping.
+    void flush(capture_queue& queue);
+
+private:
+    void add_curve(const gain_curve& curve, int offset, int length, capture_queue& queue);
+    void begin_run(const position_run& run);
+    std::uint32_t get_flags(std::int64_t output_position, std::int64_t& next_change) const;
+    void add_segment(
+        int offset, int length, float start, float increment, int phase, capture_queue& queue);
+    void add_samples(const float* gains, int offset, int num_samples, capture_queue& queue);
+    void push_pending(capture_queue& queue);
+
+    capture_record pending;
+    std::int64_t position         = 0;
+    std::int64_t run_project_time = -1; // of the sample at 'run_offset'
+    int run_offset                = 0;
+    std::int32_t max_length       = 48000 * 60;
+    bool has_pending              = false;
+    bool has_gap                  = false;
+
+    // The curve delayed for the limiter, max_delay + max_samples gains.
+    std::vector<float> line;
+    std::vector<float> block;
+    float latest_gain = 1.f; // of the curve
+    int delay         = 0;
+    int max_samples   = 0;
+    int write_index   = 0;
+
+    // Where the channel stage was switched, in samples added, oldest first.
+    struct flags_change
+    {
+        std::int64_t position = 0;
+        std::uint32_t flags   = 0;
+    };
+    static constexpr int kMaxFlagsChanges = 8;
+
+    std::array<flags_change, kMaxFlagsChanges> changes;
+    int num_changes            = 1;
+    std::uint32_t record_flags = 0; // of the records being added
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
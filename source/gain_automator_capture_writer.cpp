@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_capture_writer.h"
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// The file grows by this much, a few hours of sparse automation.
+constexpr std::size_t kChunkSize = 64 * 1024;
+
+// How often the writer thread looks into the queue. The queue holds far
+// more than the encoder produces in this time.
+constexpr auto kDrainInterval = std::chrono::milliseconds(20);
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// capture_writer::mapped_file
+//
+// An append-only memory mapped file: map() extends the file to 'size'
+// and maps all of it, unmap() truncates it to the bytes actually used.
+//------------------------------------------------------------------------
+struct capture_writer::mapped_file
+{
+#if defined(_WIN32)
+    HANDLE handle  = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+    std::uint8_t* data = nullptr;
+    std::size_t size   = 0;
+    std::size_t used   = 0;
+
+    ~mapped_file() { close(); }
+
+    bool create(const std::string& path)
+    {
+#if defined(_WIN32)
+        handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                             CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        return handle != INVALID_HANDLE_VALUE;
+#else
+        descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        return descriptor >= 0;
+#endif
+    }
+
+    bool map(std::size_t new_size)
+    {
+        unmap();
+#if defined(_WIN32)
+        const auto high = static_cast<DWORD>(static_cast<std::uint64_t>(new_size) >> 32);
+        const auto low  = static_cast<DWORD>(new_size & 0xffffffffu);
+        mapping         = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, high, low, nullptr);
+        if (!mapping)
+            return false;
+
+        data = static_cast<std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, new_size));
+#else
+        if (::ftruncate(descriptor, static_cast<off_t>(new_size)) != 0)
+            return false;
+
+        void* view = ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        data       = view == MAP_FAILED ? nullptr : static_cast<std::uint8_t*>(view);
+#endif
+        size = data ? new_size : 0;
+        return data != nullptr;
+    }
+
+    void unmap()
+    {
+#if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        if (data)
+            ::munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    void close()
+    {
+        unmap();
+#if defined(_WIN32)
+        if (handle == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(used);
+        SetFilePointerEx(handle, end, nullptr, FILE_BEGIN);
+        SetEndOfFile(handle);
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+#else
+        if (descriptor < 0)
+            return;
+
+        // The unused rest of the last chunk is cut off.
+        if (::ftruncate(descriptor, static_cast<off_t>(used)) != 0)
+        {
+            // Readers stop at the first zeroed record anyway.
+        }
+        ::close(descriptor);
+        descriptor = -1;
+#endif
+    }
+};
+
+//------------------------------------------------------------------------
+// capture_writer
+//------------------------------------------------------------------------
+capture_writer::capture_writer() = default;
+
+//------------------------------------------------------------------------
+capture_writer::~capture_writer()
+{
+    close();
+}
+
+//------------------------------------------------------------------------
+bool capture_writer::open(const std::string& path, double sample_rate)
+{
+    close();
+
+    auto new_file = std::make_unique<mapped_file>();
+    if (!new_file->create(path) || !new_file->map(kChunkSize))
+        return false;
+
+    file = std::move(new_file);
+
+    capture_file_header header;
+    header.sample_rate = sample_rate;
+    header.start_time  = static_cast<std::int64_t>(std::time(nullptr));
+    append(&header, sizeof(header));
+
+    // Leftovers of a previous capture
+    capture_record record;
+    while (queue.pop(record))
+        ;
+
+    is_running.store(true, std::memory_order_release);
+    thread = std::thread([this]() { run(); });
+    return true;
+}
+
+//------------------------------------------------------------------------
+void capture_writer::close()
+{
+    if (thread.joinable())
+    {
+        is_running.store(false, std::memory_order_release);
+        thread.join();
+    }
+
+    // Records pushed before is_open() turned false
+    if (file)
+        drain();
+
+    file = nullptr;
+}
+
+//------------------------------------------------------------------------
+void capture_writer::run()
+{
+    while (is_running.load(std::memory_order_acquire))
+    {
+        drain();
+        std::this_thread::sleep_for(kDrainInterval);
+    }
+}
+
+//------------------------------------------------------------------------
+void capture_writer::drain()
+{
+    capture_record record;
+    while (queue.pop(record))
+        append(&record, sizeof(record));
+}
+
+//------------------------------------------------------------------------
+bool capture_writer::append(const void* bytes, std::size_t num_bytes)
+{
+    if (file->used + num_bytes > file->size && !file->map(file->size + kChunkSize))
+        return false;
+
+    std::memcpy(file->data + file->used, bytes, num_bytes);
+    file->used += num_bytes;
+    return true;
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_capture.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// capture_writer
+//
+// Owns a capture file and the thread which appends the records of its
+// queue to it. The file is memory mapped and grows in chunks, appending a
+// record is a copy into the mapping; the operating system writes the
+// pages back. The audio thread only ever pushes to get_queue().
+//------------------------------------------------------------------------
+class capture_writer
+{
+public:
+    capture_writer();
+    ~capture_writer();
+
+    // Creates 'path', which must not exist yet, writes the header and
+    // starts the writer thread. Not real-time safe.
+    bool open(const std::string& path, double sample_rate);
+
+    // Stops the thread once all queued records are written and truncates
+    // the file to its records. Not real-time safe.
+    void close();
+
+    bool is_open() const { return is_running.load(std::memory_order_acquire); }
+    capture_queue& get_queue() { return queue; }
+
+private:
+    struct mapped_file;
+
+    void run();
+    void drain();
+    bool append(const void* data, std::size_t size);
+
+    capture_queue queue;
+    std::unique_ptr<mapped_file> file;
+    std::thread thread;
+    std::atomic<bool> is_running{false};
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,262 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_ceiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// The release ends here (-0.00001 dB), so the limiter becomes idle again.
+// It runs in double, in float it would get stuck below.
+constexpr double kUnityThreshold = 1. - 1e-6;
+
+// Counters saturate, only their comparison with the lookahead matters.
+constexpr int kMaxCount = 1 << 30;
+
+//------------------------------------------------------------------------
+int add_count(int count, int num_samples)
+{
+    return count < kMaxCount - num_samples ? count + num_samples : kMaxCount;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+float to_ceiling_decibel(double normalized)
+{
+    const double clamped = std::min(std::max(normalized, 0.), 1.);
+    return static_cast<float>((1. - clamped) * kMinCeilingDecibel);
+}
+
+//------------------------------------------------------------------------
+double to_normalized_ceiling(float decibel)
+{
+    return 1. - static_cast<double>(decibel) / kMinCeilingDecibel;
+}
+
+//------------------------------------------------------------------------
+int get_ceiling_latency(double sample_rate)
+{
+    const double samples = kCeilingLookahead * 0.001 * sample_rate;
+    return std::max(static_cast<int>(std::lround(samples)), 1);
+}
+
+//------------------------------------------------------------------------
+void output_ceiling::setup(double sample_rate,
+                           int num_channels,
+                           int max_samples_per_block,
+                           bool is_double)
+{
+    const double release_samples = kCeilingRelease * 0.001 * sample_rate;
+    lookahead                    = get_ceiling_latency(sample_rate);
+    max_channels                 = std::max(num_channels, 0);
+    max_samples                  = std::max(max_samples_per_block, 0);
+    line_size                    = lookahead + max_samples;
+    release                      = 1. - std::exp(-1. / release_samples);
+
+    // Only the lines of the sample type in use take memory.
+    const size_t lines_size = static_cast<size_t>(max_channels) * line_size;
+    lines32.assign(is_double ? 0 : lines_size, 0.f);
+    lines64.assign(is_double ? lines_size : 0, 0.);
+    inputs32.assign(is_double ? 0 : max_channels, nullptr);
+    inputs64.assign(is_double ? max_channels : 0, nullptr);
+    for (int channel = 0; channel < static_cast<int>(inputs32.size()); ++channel)
+        inputs32[channel] = get_line<float>(channel) + lookahead;
+    for (int channel = 0; channel < static_cast<int>(inputs64.size()); ++channel)
+        inputs64[channel] = get_line<double>(channel) + lookahead;
+
+    frame_peaks.assign(max_samples, 0.f);
+    gains.assign(max_samples, 1.f);
+    hold_gains.assign(lookahead + 1, 1.f);
+    hold_ends.assign(lookahead + 1, 0);
+    average_gains.assign(lookahead, 1.);
+
+    reset();
+}
+
+//------------------------------------------------------------------------
+void output_ceiling::reset()
+{
+    std::fill(lines32.begin(), lines32.end(), 0.f);
+    std::fill(lines64.begin(), lines64.end(), 0.);
+    std::fill(average_gains.begin(), average_gains.end(), 1.);
+
+    hold_front    = 0;
+    hold_count    = 0;
+    average_index = 0;
+    average_sum   = lookahead;
+    released      = 1.;
+    position      = 0;
+    num_unity     = lookahead;
+    num_silent    = lookahead;
+    has_gains     = false;
+}
+
+//------------------------------------------------------------------------
+void output_ceiling::set_ceiling(float decibel)
+{
+    ceiling = std::pow(10.f, decibel / 20.f);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType* const* output_ceiling::get_inputs(int num_channels, int num_samples) const
+{
+    if (num_channels > max_channels || num_samples > max_samples)
+        return nullptr;
+
+    if constexpr (std::is_same<SampleType, float>::value)
+        return inputs32.empty() ? nullptr : inputs32.data();
+    else
+        return inputs64.empty() ? nullptr : inputs64.data();
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType* output_ceiling::get_line(int channel)
+{
+    if constexpr (std::is_same<SampleType, float>::value)
+        return lines32.data() + channel * line_size;
+    else
+        return lines64.data() + channel * line_size;
+}
+
+//------------------------------------------------------------------------
+void output_ceiling::compute_gains(int num_samples, bool is_limiting)
+{
+    const int hold_size = lookahead + 1;
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const std::int64_t now = position + i;
+
+        // The gain that keeps this frame's peak at the ceiling ...
+        const float peak     = is_limiting ? frame_peaks[i] : 0.f;
+        const float required = peak > ceiling ? ceiling / peak : 1.f;
+
+        // ... held over the lookahead: the minimum of the queue's front.
+        if (hold_count > 0 && hold_ends[hold_front] < now)
+        {
+            hold_front = hold_front + 1 < hold_size ? hold_front + 1 : 0;
+            --hold_count;
+        }
+        if (required < 1.f)
+        {
+            while (hold_count > 0)
+            {
+                const int back = (hold_front + hold_count - 1) % hold_size;
+                if (hold_gains[back] < required)
+                    break;
+                --hold_count;
+            }
+            const int back   = (hold_front + hold_count) % hold_size;
+            hold_gains[back] = required;
+            hold_ends[back]  = now + lookahead;
+            ++hold_count;
+        }
+        const double held = hold_count > 0 ? hold_gains[hold_front] : 1.;
+
+        // Attack at once, release exponentially, never above the held gain.
+        if (held <= released)
+            released = held;
+        else
+            released = std::min(released + (held - released) * release, held);
+        if (held == 1. && released >= kUnityThreshold)
+            released = 1.;
+        num_unity = released == 1. ? add_count(num_unity, 1) : 0;
+
+        // The average over the lookahead reaches 'held' when the peak leaves the line.
+        average_sum += released - average_gains[average_index];
+        average_gains[average_index] = released;
+        average_index                = average_index + 1 < lookahead ? average_index + 1 : 0;
+        if (num_unity >= lookahead)
+            average_sum = lookahead; // no drift once all of them are 1
+
+        gains[i] = static_cast<float>(average_sum / lookahead);
+    }
+    position += num_samples;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+bool output_ceiling::process(SampleType* const* out,
+                             int num_channels,
+                             int num_samples,
+                             bool is_silent,
+                             bool is_limiting,
+                             level_meter& meter)
+{
+    // The output comes from the inputs 'lookahead' samples ago.
+    num_silent                  = is_silent ? add_count(num_silent, num_samples) : 0;
+    const bool is_output_silent = num_silent >= num_samples + lookahead;
+    const size_t block_size     = num_samples * sizeof(SampleType);
+    const size_t lookahead_size = lookahead * sizeof(SampleType);
+
+    // The gain stage's peak is the peak after the gain, nothing to limit.
+    if (is_idle() && (!is_limiting || meter.output_peak <= ceiling))
+    {
+        for (int channel = 0; channel < num_channels; ++channel)
+        {
+            SampleType* line = get_line<SampleType>(channel);
+            std::memcpy(out[channel], line, block_size);
+            std::memmove(line, line + num_samples, lookahead_size);
+        }
+        position += num_samples;
+        has_gains = false;
+        return is_output_silent;
+    }
+
+    if (is_limiting)
+    {
+        std::fill(frame_peaks.begin(), frame_peaks.begin() + num_samples, 0.f);
+        for (int channel = 0; channel < num_channels; ++channel)
+        {
+            const SampleType* input = get_line<SampleType>(channel) + lookahead;
+            for (int i = 0; i < num_samples; ++i)
+                frame_peaks[i] =
+                    std::max(frame_peaks[i], static_cast<float>(std::abs(input[i])));
+        }
+    }
+    compute_gains(num_samples, is_limiting);
+    has_gains = true;
+
+    // Rounding of the average may leave a sample a few ulp above the ceiling.
+    const auto limit = static_cast<SampleType>(is_limiting ? ceiling : HUGE_VALF);
+    SampleType peak  = 0;
+    double energy    = 0.;
+    for (int channel = 0; channel < num_channels; ++channel)
+    {
+        SampleType* line   = get_line<SampleType>(channel);
+        SampleType* output = out[channel];
+        for (int i = 0; i < num_samples; ++i)
+        {
+            const SampleType y = std::min(std::max(line[i] * gains[i], -limit), limit);
+            peak               = std::max(peak, std::abs(y));
+            energy += static_cast<double>(y) * y;
+            output[i] = y;
+        }
+        std::memmove(line, line + num_samples, lookahead_size);
+    }
+
+    meter.output_peak   = static_cast<float>(peak);
+    meter.output_energy = energy;
+    return is_output_silent;
+}
+
+//------------------------------------------------------------------------
+template float* const* output_ceiling::get_inputs<float>(int, int) const;
+template double* const* output_ceiling::get_inputs<double>(int, int) const;
+template bool output_ceiling::process<float>(float* const*, int, int, bool, bool, level_meter&);
+template bool output_ceiling::process<double>(double* const*, int, int, bool, bool, level_meter&);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
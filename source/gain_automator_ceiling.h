@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_kernel.h"
+#include <cstdint>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Output ceiling in dB, mapped linearly to [0, 1]. Lookahead and release
+// are fixed, in milliseconds.
+static constexpr float kMinCeilingDecibel     = -24.f;
+static constexpr float kDefaultCeilingDecibel = -1.f;
+static constexpr float kCeilingLookahead      = 1.5f;
+static constexpr float kCeilingRelease        = 50.f;
+
+float to_ceiling_decibel(double normalized);
+double to_normalized_ceiling(float decibel);
+
+// The lookahead in samples, which is the latency of the ceiling.
+int get_ceiling_latency(double sample_rate);
+
+//------------------------------------------------------------------------
+// output_ceiling
+//
+// A lookahead peak limiter behind the gain stage. The gain kernels write
+// straight into its delay lines (get_inputs), metered, so the peak of the
+// block after the gain comes with the multiplication. process() then
+// writes the delayed block to the output.
+//
+// While the block peak stays below the ceiling and no gain reduction is
+// pending, process() is a plain delay. Otherwise the peaks of all
+// channels per frame set the gain needed, which is held over the
+// lookahead, released exponentially and smoothed by a moving average over
+// the lookahead. The average reaches the held gain when the peak leaves
+// the delay line, so no sample exceeds the ceiling.
+//
+// Usage per block: get_inputs(), the gain stage into them, process().
+//------------------------------------------------------------------------
+class output_ceiling
+{
+public:
+    // Allocates the delay lines for one sample type. Not real-time safe.
+    void setup(double sample_rate, int num_channels, int max_samples_per_block, bool is_double);
+    // Clears the delay lines and any gain reduction.
+    void reset();
+
+    void set_ceiling(float decibel);
+    int get_latency() const { return lookahead; }
+
+    // The delay line inputs of 'num_channels', null if the block does not
+    // fit the setup.
+    template <typename SampleType>
+    SampleType* const* get_inputs(int num_channels, int num_samples) const;
+
+    // Writes the delayed block to 'out', limited if 'is_limiting'. With it
+    // off the gain reduction releases. 'is_silent' tells the inputs are
+    // silent, 'meter' holds the levels of the gain stage, its output levels
+    // are replaced while limiting. Returns true if the output is silent.
+    template <typename SampleType>
+    bool process(SampleType* const* out,
+                 int num_channels,
+                 int num_samples,
+                 bool is_silent,
+                 bool is_limiting,
+                 level_meter& meter);
+
+    // Nothing to release and the lookahead holds no peak.
+    bool is_idle() const { return num_unity >= lookahead; }
+
+    // The gains the last process() applied, null if it was a plain delay.
+    const float* get_gains() const { return has_gains ? gains.data() : nullptr; }
+
+private:
+    void compute_gains(int num_samples, bool is_limiting);
+
+    template <typename SampleType>
+    SampleType* get_line(int channel);
+
+    int lookahead    = 0;
+    int max_channels = 0;
+    int max_samples  = 0;
+    int line_size    = 0; // lookahead + max_samples
+    float ceiling    = 1.f;
+    double release   = 1.; // coefficient per sample
+
+    // Per channel delay lines, the gain stage writes behind the lookahead.
+    std::vector<float> lines32;
+    std::vector<double> lines64;
+    std::vector<float*> inputs32;
+    std::vector<double*> inputs64;
+
+    std::vector<float> frame_peaks;
+    std::vector<float> gains;
+
+    // Minimum of the required gains over the lookahead: a monotonic queue
+    // of gains below 1 and the position they expire after.
+    std::vector<float> hold_gains;
+    std::vector<std::int64_t> hold_ends;
+    int hold_front = 0;
+    int hold_count = 0;
+
+    // Moving average of the released gain over the lookahead.
+    std::vector<double> average_gains;
+    int average_index  = 0;
+    double average_sum = 0.;
+
+    double released       = 1.;
+    std::int64_t position = 0;
+    int num_unity         = 0; // consecutive released gains of 1
+    int num_silent        = 0; // consecutive silent input samples
+    bool has_gains        = false;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
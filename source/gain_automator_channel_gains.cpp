@@ -0,0 +1,488 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_channel_gains.h"
+#include "gain_automator_gain_law.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr float kLog2Of10Over20 = 0.166096404744368f; // log2(10) / 20
+
+//------------------------------------------------------------------------
+float clamp_normalized(float value)
+{
+    return std::min(std::max(value, 0.f), 1.f);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+struct levels
+{
+    T input_peak    = 0;
+    T output_peak   = 0;
+    T input_energy  = 0;
+    T output_energy = 0;
+
+    void add(T x, T y)
+    {
+        input_peak  = std::max(input_peak, std::abs(x));
+        output_peak = std::max(output_peak, std::abs(y));
+        input_energy += x * x;
+        output_energy += y * y;
+    }
+
+    void store(level_meter& meter, int num_samples) const
+    {
+        meter.input_peak  = std::max(meter.input_peak, static_cast<float>(input_peak));
+        meter.output_peak = std::max(meter.output_peak, static_cast<float>(output_peak));
+        meter.input_energy += input_energy;
+        meter.output_energy += output_energy;
+        meter.num_samples += num_samples;
+    }
+};
+
+//------------------------------------------------------------------------
+// A constant composite gain folded into the curve, as cheap as the curve.
+template <typename SampleType>
+void apply_scaled_curve(const gain_kernel<SampleType>& kernel,
+                        const gain_curve& curve,
+                        float scale,
+                        const SampleType* in,
+                        SampleType* out,
+                        float* scratch,
+                        level_meter* meter)
+{
+    const int num_samples = curve.get_num_samples();
+    switch (curve.get_shape())
+    {
+        case gain_curve::shape::constant:
+            kernel.apply_constant(in, out, num_samples, curve.get_constant() * scale, meter);
+            break;
+        case gain_curve::shape::segments:
+            for (const auto& segment : curve.get_segments())
+            {
+                const SampleType* src = in + segment.offset;
+                SampleType* dst       = out + segment.offset;
+                if (segment.is_constant())
+                    kernel.apply_constant(src, dst, segment.length, segment.start * scale, meter);
+                else
+                    kernel.apply_ramp(src, dst, segment.length, segment.start * scale,
+                                      segment.increment * scale, segment.phase, meter);
+            }
+            break;
+        case gain_curve::shape::samples:
+        {
+            const float* gains = curve.get_samples();
+            for (int i = 0; i < num_samples; ++i)
+                scratch[i] = gains[i] * scale;
+            kernel.apply_curve(in, out, num_samples, scratch, meter);
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Channels 0 and 1 through the mid/side matrix, then their gains. Plain
+// loops over contiguous arrays, left to the compiler's vectorizer.
+template <bool Metered, bool IsConstantMatrix, typename T>
+void apply_mid_side(const T* in_left,
+                    const T* in_right,
+                    T* out_left,
+                    T* out_right,
+                    int num_samples,
+                    const float* gains_left,
+                    const float* gains_right,
+                    const channel_gains& gains,
+                    level_meter* meter)
+{
+    const float* samples_a = gains.get_samples_a();
+    const float* samples_b = gains.get_samples_b();
+    const auto constant_a  = static_cast<T>(gains.get_constant_a());
+    const auto constant_b  = static_cast<T>(gains.get_constant_b());
+
+    levels<T> meter_levels;
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const T a     = IsConstantMatrix ? constant_a : static_cast<T>(samples_a[i]);
+        const T b     = IsConstantMatrix ? constant_b : static_cast<T>(samples_b[i]);
+        const T left  = in_left[i];
+        const T right = in_right[i];
+        out_left[i]   = static_cast<T>(gains_left[i]) * (a * left + b * right);
+        out_right[i]  = static_cast<T>(gains_right[i]) * (b * left + a * right);
+        if (Metered)
+        {
+            meter_levels.add(left, out_left[i]);
+            meter_levels.add(right, out_right[i]);
+        }
+    }
+    if (Metered)
+        meter_levels.store(*meter, 2 * num_samples);
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+float to_trim_decibel(float normalized)
+{
+    return (2.f * clamp_normalized(normalized) - 1.f) * kMaxTrimDecibel;
+}
+
+//------------------------------------------------------------------------
+float to_trim_gain(float normalized)
+{
+    // fast_exp2(0) is exactly 1, a centered trim is unity.
+    return fast_exp2(to_trim_decibel(normalized) * kLog2Of10Over20);
+}
+
+//------------------------------------------------------------------------
+double to_normalized_trim(float decibel)
+{
+    const float clamped = std::min(std::max(decibel, -kMaxTrimDecibel), kMaxTrimDecibel);
+    return 0.5 + 0.5 * clamped / kMaxTrimDecibel;
+}
+
+//------------------------------------------------------------------------
+float to_balance(float normalized)
+{
+    return 2.f * clamp_normalized(normalized) - 1.f;
+}
+
+//------------------------------------------------------------------------
+void to_balance_gains(float normalized, float& left, float& right)
+{
+    const float balance = to_balance(normalized);
+    left                = std::min(1.f - balance, 1.f);
+    right               = std::min(1.f + balance, 1.f);
+}
+
+//------------------------------------------------------------------------
+// channel_gains
+channel_gains::channel_gains()
+{
+    values.fill(0.5f);
+    update_constants();
+}
+
+//------------------------------------------------------------------------
+void channel_gains::setup(int max_samples_per_block)
+{
+    max_samples = std::max(max_samples_per_block, 0);
+    samples.assign(static_cast<std::size_t>(kNumBuffers) * max_samples, 0.f);
+    segments.reserve(max_samples);
+}
+
+//------------------------------------------------------------------------
+void channel_gains::set_value(int param, float normalized)
+{
+    values[param] = clamp_normalized(normalized);
+    update_constants();
+}
+
+//------------------------------------------------------------------------
+void channel_gains::build(const automation_point* const* points,
+                          const int* num_points,
+                          int new_num_samples)
+{
+    num_samples = new_num_samples;
+
+    // Oversized blocks (a host error) jump to the last values.
+    const bool is_oversized = num_samples > max_samples;
+    bool is_any_moving      = false;
+    for (int param = 0; param < kNumParams; ++param)
+    {
+        is_moving[param] = false;
+        if (num_points[param] <= 0)
+        {
+            ramps[param] = gain_ramp();
+            continue;
+        }
+
+        if (is_oversized)
+        {
+            ramps[param]  = gain_ramp();
+            values[param] = clamp_normalized(points[param][num_points[param] - 1].value);
+            continue;
+        }
+
+        // The normalized ramps go to the buffer the parameter maps into.
+        // The segments are shared, the ramp running into the next block is not.
+        segments.set_ramp(ramps[param]);
+        segments.assign(points[param], num_points[param], num_samples, values[param]);
+        ramps[param]     = segments.get_ramp();
+        values[param]    = clamp_normalized(segments.get_last_value());
+        is_moving[param] = !segments.is_constant();
+        if (is_moving[param])
+            segments.render(get_samples(get_buffer(param)));
+        is_any_moving |= is_moving[param];
+    }
+
+    update_constants();
+    is_constant_block = !is_any_moving;
+    if (is_constant_block)
+        return;
+
+    // Map the moving parameters, the others are held at their value.
+    for (int trim = 0; trim < kNumTrimChannels; ++trim)
+    {
+        float* gains = get_samples(kTrim + trim);
+        if (!is_moving[kTrim + trim])
+        {
+            std::fill_n(gains, num_samples, constants[trim]);
+            continue;
+        }
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] = to_trim_gain(gains[i]);
+    }
+
+    float* left  = get_samples(kBalanceLeft);
+    float* right = get_samples(kBalanceLeft + 1);
+    if (is_moving[kBalance])
+    {
+        for (int i = 0; i < num_samples; ++i)
+            to_balance_gains(left[i], left[i], right[i]);
+    }
+    else
+    {
+        std::fill_n(left, num_samples, constants[kBalanceLeft]);
+        std::fill_n(right, num_samples, constants[kBalanceLeft + 1]);
+    }
+
+    float* a = get_samples(kNumGains);
+    float* b = get_samples(kNumGains + 1);
+    if (is_moving[kMid] || is_moving[kSide])
+    {
+        const float held_mid  = to_trim_gain(values[kMid]);
+        const float held_side = to_trim_gain(values[kSide]);
+        for (int i = 0; i < num_samples; ++i)
+        {
+            const float mid  = is_moving[kMid] ? to_trim_gain(a[i]) : held_mid;
+            const float side = is_moving[kSide] ? to_trim_gain(b[i]) : held_side;
+            a[i]             = 0.5f * (mid + side);
+            b[i]             = 0.5f * (mid - side);
+        }
+        has_mid_side_block = true;
+    }
+    else
+    {
+        std::fill_n(a, num_samples, constants[kNumGains]);
+        std::fill_n(b, num_samples, constants[kNumGains + 1]);
+    }
+
+    is_unity_block = false;
+}
+
+//------------------------------------------------------------------------
+void channel_gains::mix_to_unity(const float* mix)
+{
+    if (is_unity_block || num_samples > max_samples)
+        return;
+
+    // Only runs during crossfades, a few milliseconds at a time.
+    expand_constants();
+    for (int index = 0; index < kNumGains; ++index)
+    {
+        float* gains = get_samples(index);
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] += (1.f - gains[i]) * mix[i];
+    }
+
+    float* a = get_samples(kNumGains);
+    float* b = get_samples(kNumGains + 1);
+    for (int i = 0; i < num_samples; ++i)
+    {
+        a[i] += (1.f - a[i]) * mix[i];
+        b[i] *= 1.f - mix[i];
+    }
+}
+
+//------------------------------------------------------------------------
+void channel_gains::mix_to_unity(float mix)
+{
+    if (is_unity_block)
+        return;
+
+    if (is_constant_block || num_samples > max_samples)
+    {
+        for (int index = 0; index < kNumGains + 1; ++index)
+            constants[index] += (1.f - constants[index]) * mix;
+        constants[kNumGains + 1] *= 1.f - mix;
+
+        is_unity_block = mix >= 1.f;
+        return;
+    }
+
+    for (int index = 0; index < kNumGains + 1; ++index)
+    {
+        float* gains = get_samples(index);
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] += (1.f - gains[i]) * mix;
+    }
+
+    float* b = get_samples(kNumGains + 1);
+    for (int i = 0; i < num_samples; ++i)
+        b[i] *= 1.f - mix;
+}
+
+//------------------------------------------------------------------------
+float channel_gains::get_constant_gain(int channel, int num_channels) const
+{
+    float gain = channel < kNumTrimChannels ? constants[channel] : 1.f;
+    if (num_channels >= 2 && channel < 2)
+        gain *= constants[kBalanceLeft + channel];
+    return gain;
+}
+
+//------------------------------------------------------------------------
+void channel_gains::render_gains(const gain_curve& curve,
+                                 int channel,
+                                 int num_channels,
+                                 float* gains) const
+{
+    curve.render(gains);
+    if (is_constant_block || num_samples > max_samples)
+    {
+        const float gain = get_constant_gain(channel, num_channels);
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] *= gain;
+        return;
+    }
+
+    if (channel < kNumTrimChannels)
+    {
+        const float* trims = get_samples(kTrim + channel);
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] *= trims[i];
+    }
+    if (num_channels >= 2 && channel < 2)
+    {
+        const float* balance = get_samples(kBalanceLeft + channel);
+        for (int i = 0; i < num_samples; ++i)
+            gains[i] *= balance[i];
+    }
+}
+
+//------------------------------------------------------------------------
+int channel_gains::get_buffer(int param)
+{
+    switch (param)
+    {
+        case kBalance: return kBalanceLeft;
+        case kMid: return kNumGains;
+        case kSide: return kNumGains + 1;
+        default: return kTrim + param;
+    }
+}
+
+//------------------------------------------------------------------------
+void channel_gains::update_constants()
+{
+    for (int trim = 0; trim < kNumTrimChannels; ++trim)
+        constants[trim] = to_trim_gain(values[kTrim + trim]);
+    to_balance_gains(values[kBalance], constants[kBalanceLeft], constants[kBalanceLeft + 1]);
+
+    const float mid          = to_trim_gain(values[kMid]);
+    const float side         = to_trim_gain(values[kSide]);
+    constants[kNumGains]     = 0.5f * (mid + side);
+    constants[kNumGains + 1] = 0.5f * (mid - side);
+
+    has_mid_side_block = constants[kNumGains] != 1.f || constants[kNumGains + 1] != 0.f;
+    is_unity_block     = !has_mid_side_block;
+    for (int index = 0; index < kNumGains; ++index)
+        is_unity_block = is_unity_block && constants[index] == 1.f;
+}
+
+//------------------------------------------------------------------------
+void channel_gains::expand_constants()
+{
+    if (!is_constant_block)
+        return;
+
+    for (int index = 0; index < kNumBuffers; ++index)
+        std::fill_n(get_samples(index), num_samples, constants[index]);
+
+    is_constant_block = false;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void apply_channel_gains(const gain_kernel<SampleType>& kernel,
+                         const gain_curve& curve,
+                         const channel_gains& gains,
+                         const SampleType* const* in,
+                         SampleType* const* out,
+                         int num_channels,
+                         float* scratch,
+                         level_meter* meter)
+{
+    const int num_samples = curve.get_num_samples();
+    const bool is_pair =
+        gains.has_mid_side() && num_channels >= 2 && in[0] && in[1] && out[0] && out[1];
+
+    for (int channel = is_pair ? 2 : 0; channel < num_channels; ++channel)
+    {
+        if (!in[channel] || !out[channel])
+            continue;
+
+        if (gains.is_constant())
+        {
+            apply_scaled_curve(kernel, curve, gains.get_constant_gain(channel, num_channels),
+                               in[channel], out[channel], scratch, meter);
+            continue;
+        }
+
+        gains.render_gains(curve, channel, num_channels, scratch);
+        kernel.apply_curve(in[channel], out[channel], num_samples, scratch, meter);
+    }
+
+    if (!is_pair)
+        return;
+
+    float* gains_left  = scratch;
+    float* gains_right = scratch + num_samples;
+    gains.render_gains(curve, 0, num_channels, gains_left);
+    gains.render_gains(curve, 1, num_channels, gains_right);
+
+    const bool is_constant_matrix = gains.is_constant();
+    if (meter && is_constant_matrix)
+        apply_mid_side<true, true>(in[0], in[1], out[0], out[1], num_samples, gains_left,
+                                   gains_right, gains, meter);
+    else if (meter)
+        apply_mid_side<true, false>(in[0], in[1], out[0], out[1], num_samples, gains_left,
+                                    gains_right, gains, meter);
+    else if (is_constant_matrix)
+        apply_mid_side<false, true>(in[0], in[1], out[0], out[1], num_samples, gains_left,
+                                    gains_right, gains, meter);
+    else
+        apply_mid_side<false, false>(in[0], in[1], out[0], out[1], num_samples, gains_left,
+                                     gains_right, gains, meter);
+}
+
+//------------------------------------------------------------------------
+template void apply_channel_gains<float>(const gain_kernel<float>&,
+                                         const gain_curve&,
+                                         const channel_gains&,
+                                         const float* const*,
+                                         float* const*,
+                                         int,
+                                         float*,
+                                         level_meter*);
+template void apply_channel_gains<double>(const gain_kernel<double>&,
+                                          const gain_curve&,
+                                          const channel_gains&,
+                                          const double* const*,
+                                          double* const*,
+                                          int,
+                                          float*,
+                                          level_meter*);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_gain_curve.h"
+#include "gain_automator_kernel.h"
+#include "gain_automator_segments.h"
+#include <array>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Trims of the first channels of a bus, the others have none. Trims, mid
+// and side gain share one range in dB, mapped linearly to [0, 1].
+static constexpr int kNumTrimChannels = 8;
+static constexpr float kMaxTrimDecibel = 24.f;
+
+float to_trim_decibel(float normalized);
+float to_trim_gain(float normalized);
+double to_normalized_trim(float decibel);
+
+// Balance of the first two channels, normalized 0 is left, 0.5 center and
+// 1 right. Towards one side the other one is attenuated linearly.
+float to_balance(float normalized);
+void to_balance_gains(float normalized, float& left, float& right);
+
+//------------------------------------------------------------------------
+// channel_gains
+//
+// The per channel stage behind the gain curve: a trim per channel, the
+// balance of channels 0 and 1 and the mid/side gain of the same pair.
+// Mid/side mixes the pair through the matrix
+//
+//     left'  = a * left + b * right,    a = (mid + side) / 2
+//     right' = b * left + a * right,    b = (mid - side) / 2
+//
+// Parameters are sample accurate, linear in their normalized values
+// between the automation points like the gain. While none of them moves,
+// the stage is a constant gain per channel (and a constant matrix).
+//
+// Usage per block: build() with the points of every parameter, then
+// mix_to_unity() if the bypass fades, then apply_channel_gains().
+//------------------------------------------------------------------------
+class channel_gains
+{
+public:
+    enum param
+    {
+        kTrim    = 0, // first of kNumTrimChannels
+        kBalance = kNumTrimChannels,
+        kMid,
+        kSide,
+        kNumParams
+    };
+
+    // All parameters centered: unity gains, no mid/side mix.
+    channel_gains();
+
+    // Allocates the per sample buffers. Not real-time safe.
+    void setup(int max_samples_per_block);
+
+    // The value a parameter holds until its next automation point.
+    void set_value(int param, float normalized);
+    float get_value(int param) const { return values[param]; }
+
+    // 'points[param]' holds 'num_points[param]' automation points of
+    // 'param' in this block.
+    void build(const automation_point* const* points, const int* num_points, int num_samples);
+
+    // Blends all gains towards unity like gain_curve::mix_to_unity. The
+    // mid/side matrix blends towards identity.
+    void mix_to_unity(const float* mix);
+    void mix_to_unity(float mix);
+
+    // Nothing to apply, every gain is 1 and there is no mid/side mix.
+    bool is_unity() const { return is_unity_block; }
+    // No parameter moves in this block, the get_constant_*() values hold.
+    bool is_constant() const { return is_constant_block; }
+    bool has_mid_side() const { return has_mid_side_block; }
+    int get_num_samples() const { return num_samples; }
+
+    // Gain of 'channel' of a bus of 'num_channels', trim and balance.
+    float get_constant_gain(int channel, int num_channels) const;
+    // Per sample gains of 'channel', written to 'gains' multiplied with
+    // 'curve' (the master gain) while the stage is not constant.
+    void render_gains(const gain_curve& curve, int channel, int num_channels, float* gains) const;
+
+    float get_constant_a() const { return constants[kNumGains]; }
+    float get_constant_b() const { return constants[kNumGains + 1]; }
+    const float* get_samples_a() const { return get_samples(kNumGains); }
+    const float* get_samples_b() const { return get_samples(kNumGains + 1); }
+
+private:
+    // Trims, balance left and right, then the matrix coefficients a and b.
+    static constexpr int kNumGains    = kNumTrimChannels + 2;
+    static constexpr int kNumBuffers  = kNumGains + 2;
+    static constexpr int kBalanceLeft = kNumTrimChannels;
+
+    static int get_buffer(int param);
+    float* get_samples(int index) { return samples.data() + index * max_samples; }
+    const float* get_samples(int index) const { return samples.data() + index * max_samples; }
+    void update_constants();
+    void expand_constants();
+
+    std::array<float, kNumParams> values{};
+    std::array<bool, kNumParams> is_moving{};
+    std::array<float, kNumBuffers> constants{};
+    std::vector<float> samples; // kNumBuffers * max_samples
+    gain_segments segments;
+    std::array<gain_ramp, kNumParams> ramps{};
+    int max_samples         = 0;
+    int num_samples         = 0;
+    bool is_unity_block     = true;
+    bool is_constant_block  = true;
+    bool has_mid_side_block = false;
+};
+
+//------------------------------------------------------------------------
+// Applies 'curve' and 'gains' to all channels in one pass over the audio.
+// While the stage is constant, the composite gain of a channel is folded
+// into the curve's constant or segments, so the gain kernels run as if
+// there was only the curve. Otherwise per sample composite gains are
+// computed first. With mid/side, channels 0 and 1 are mixed through the
+// matrix in the same pass.
+template <typename SampleType>
+void apply_channel_gains(const gain_kernel<SampleType>& kernel,
+                         const gain_curve& curve,
+                         const channel_gains& gains,
+                         const SampleType* const* in,
+                         SampleType* const* out,
+                         int num_channels,
+                         float* scratch,
+                         level_meter* meter);
+
+// Floats of the 'scratch' buffer apply_channel_gains() needs per sample.
+static constexpr int kChannelGainsScratch = 2;
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
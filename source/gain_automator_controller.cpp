@@ -3,20 +3,52 @@
 //------------------------------------------------------------------------
 
 #include "gain_automator_controller.h"
+#include "gain_automator_automation_delay.h"
+#include "gain_automator_ceiling.h"
+#include "gain_automator_channel_gains.h"
 #include "gain_automator_cids.h"
+#include "gain_automator_editor_description.h"
+#include "gain_automator_gain_bus.h"
+#include "gain_automator_gain_format.h"
+#include "gain_automator_gain_law.h"
+#include "gain_automator_loudness.h"
+#include "gain_automator_meter_link.h"
 #include "gain_automator_param_ids.h"
-#include "ha/param_tool_box/convert/dezibel.h"
+#include "gain_automator_smoother.h"
+#include "gain_automator_state.h"
 #include "pluginterfaces/base/ustring.h"
-#include "public.sdk/source/vst/utility/stringconvert.h"
 #include "vstgui/plugin-bindings/vst3editor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 using namespace Steinberg;
 
 namespace ha {
 
 //------------------------------------------------------------------------
-using fdezibel = ptb::convert::dezibel<float>;
-static const fdezibel dB_converter(-96, 0);
+static_assert(sizeof(Vst::TChar) == sizeof(char16_t), "VST 3 strings are UTF-16");
+
+// The editor polls the meter queue at about 30 Hz.
+static constexpr VSTGUI::uint32 kMeterTimerInterval = 33;
+
+// Override the edit thinning, the tolerance as normalized value, the interval in ms.
+static constexpr const char* kEditToleranceVariable = "HA_GAIN_EDIT_TOLERANCE";
+static constexpr const char* kEditIntervalVariable  = "HA_GAIN_EDIT_INTERVAL";
+
+//------------------------------------------------------------------------
+static double getEditTime()
+{
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+#if HA_PROFILING
+// Upper end of the process time parameters in microseconds.
+static constexpr double kMaxProfileTime = 10000.;
+#endif
 
 //------------------------------------------------------------------------
 // GainParameter
@@ -24,47 +56,63 @@ static const fdezibel dB_converter(-96, 0);
 class GainParameter : public Vst::Parameter
 {
 public:
-    GainParameter(int32 flags, int32 id);
+    GainParameter(const Vst::TChar* title,
+                  int32 flags,
+                  int32 id,
+                  Vst::ParamValue defaultNormalized = 1.);
 
     void toString(Vst::ParamValue normValue, Vst::String128 string) const SMTG_OVERRIDE;
     bool fromString(const Vst::TChar* string, Vst::ParamValue& normValue) const SMTG_OVERRIDE;
+
+    // The 'Gain' parameter shows the level of the selected law, the meters
+    // keep the decibel law.
+    bool setGainLaw(dsp::gain_law law);
+
+private:
+    dsp::gain_law gainLaw = dsp::gain_law::decibel;
 };
 
 //------------------------------------------------------------------------
 // GainParameter Implementation
 //------------------------------------------------------------------------
-GainParameter::GainParameter(int32 flags, int32 id)
+GainParameter::GainParameter(const Vst::TChar* title,
+                             int32 flags,
+                             int32 id,
+                             Vst::ParamValue defaultNormalized)
 {
-    Steinberg::UString(info.title, USTRINGSIZE(info.title)).assign(USTRING("Gain"));
+    Steinberg::UString(info.title, USTRINGSIZE(info.title)).assign(title);
     Steinberg::UString(info.units, USTRINGSIZE(info.units)).assign(USTRING("dB"));
 
     info.flags                  = flags;
     info.id                     = id;
     info.stepCount              = 0;
-    info.defaultNormalizedValue = 1.;
+    info.defaultNormalizedValue = defaultNormalized;
     info.unitId                 = Vst::kRootUnitId;
 
-    setNormalized(1.f);
+    setNormalized(defaultNormalized);
 }
 
 //------------------------------------------------------------------------
 void GainParameter::toString(Vst::ParamValue normValue, Vst::String128 string) const
 {
-    const auto physical    = dB_converter.to_physical(normValue);
-    const auto physicalStr = dB_converter.to_string(physical, [](fdezibel::value_type physical) {
-        return physical < fdezibel::value_type(-10.) ? 1 : 2;
-    });
-    Steinberg::UString(string, 128).fromAscii(physicalStr.data());
+    // Hosts ask for these strings constantly, they come from a precomputed table.
+    std::memcpy(string, dsp::to_decibel_string(gainLaw, normValue),
+                dsp::kMaxDecibelStringSize * sizeof(Vst::TChar));
 }
 
 //------------------------------------------------------------------------
 bool GainParameter::fromString(const Vst::TChar* string, Vst::ParamValue& normValue) const
 {
-    const auto utf8_str       = VST3::StringConvert::convert(string);
-    const auto physical_val   = dB_converter.from_string(utf8_str);
-    const auto normalized_val = dB_converter.to_normalized(physical_val);
-    normValue                 = normalized_val;
-    return true;
+    return dsp::from_decibel_string(gainLaw, reinterpret_cast<const char16_t*>(string),
+                                    normValue);
+}
+
+//------------------------------------------------------------------------
+bool GainParameter::setGainLaw(dsp::gain_law law)
+{
+    const bool isChanged = law != gainLaw;
+    gainLaw              = law;
+    return isChanged;
 }
 
 //------------------------------------------------------------------------
@@ -76,7 +124,177 @@ tresult PLUGIN_API GainAutomatorController::initialize(FUnknown* context)
     if (result != kResultOk)
         return result;
 
-    parameters.addParameter(new GainParameter(Vst::ParameterInfo::kCanAutomate, kParamGainId));
+    // Parsed on the first editor open of any instance.
+    EditorDescription::retain();
+
+    if (const char* tolerance = std::getenv(kEditToleranceVariable))
+        editTolerance = std::atof(tolerance);
+    if (const char* interval = std::getenv(kEditIntervalVariable))
+        editMinInterval = std::atof(interval) * 0.001;
+
+    parameters.addParameter(
+        new GainParameter(STR16("Gain"), Vst::ParameterInfo::kCanAutomate, kParamGainId));
+
+    // Entries in the order of dsp::gain_law
+    auto* gainLawParam = new Vst::StringListParameter(
+        STR16("Gain Law"), kParamGainLawId, nullptr,
+        Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList);
+    gainLawParam->appendString(STR16("Linear"));
+    gainLawParam->appendString(STR16("Decibel"));
+    gainLawParam->appendString(STR16("Equal Power"));
+    gainLawParam->getInfo().defaultNormalizedValue = dsp::to_normalized(dsp::gain_law::decibel);
+    gainLawParam->setNormalized(dsp::to_normalized(dsp::gain_law::decibel));
+    parameters.addParameter(gainLawParam);
+
+    // Entries in the order of dsp::smoothing_mode
+    auto* smoothingParam = new Vst::StringListParameter(
+        STR16("Smoothing"), kParamSmoothingModeId, nullptr,
+        Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList);
+    smoothingParam->appendString(STR16("Off"));
+    smoothingParam->appendString(STR16("One-Pole"));
+    smoothingParam->appendString(STR16("Linear"));
+    smoothingParam->appendString(STR16("Raised Cosine"));
+    smoothingParam->getInfo().defaultNormalizedValue =
+        ParamState::getDefault(kParamSmoothingModeId);
+    smoothingParam->setNormalized(ParamState::getDefault(kParamSmoothingModeId));
+    parameters.addParameter(smoothingParam);
+
+    auto* smoothingTimeParam = new Vst::RangeParameter(
+        STR16("Smoothing Time"), kParamSmoothingTimeId, STR16("ms"), dsp::kMinSmoothingTime,
+        dsp::kMaxSmoothingTime, dsp::kDefaultSmoothingTime, 0, Vst::ParameterInfo::kCanAutomate);
+    smoothingTimeParam->setPrecision(0);
+    parameters.addParameter(smoothingTimeParam);
+
+    // Sample accurate host bypass, crossfaded over the (not automatable) fade time
+    parameters.addParameter(STR16("Bypass"), nullptr, 1, 0.,
+                            Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsBypass,
+                            kParamBypassId);
+
+    auto* bypassFadeParam =
+        new Vst::RangeParameter(STR16("Bypass Fade"), kParamBypassFadeId, STR16("ms"), 0.,
+                                dsp::kMaxBypassFadeTime, dsp::kDefaultBypassFadeTime, 0, 0);
+    bypassFadeParam->setPrecision(0);
+    parameters.addParameter(bypassFadeParam);
+
+    // Gain groups are a setup decision, not automatable. Entries: 'Off', then one per group.
+    auto* gainGroupParam = new Vst::StringListParameter(STR16("Gain Group"), kParamGainGroupId,
+                                                        nullptr, Vst::ParameterInfo::kIsList);
+    gainGroupParam->appendString(STR16("Off"));
+    for (int group = 0; group < dsp::kNumGainGroups; ++group)
+    {
+        Vst::String128 groupName = {};
+        Steinberg::UString(groupName, USTRINGSIZE(groupName)).printInt(group + 1);
+        gainGroupParam->appendString(groupName);
+    }
+    parameters.addParameter(gainGroupParam);
+
+    // Entries in the order of dsp::group_role
+    auto* groupRoleParam = new Vst::StringListParameter(STR16("Group Role"), kParamGroupRoleId,
+                                                        nullptr, Vst::ParameterInfo::kIsList);
+    groupRoleParam->appendString(STR16("Leader"));
+    groupRoleParam->appendString(STR16("Follower"));
+    groupRoleParam->getInfo().defaultNormalizedValue = ParamState::getDefault(kParamGroupRoleId);
+    groupRoleParam->setNormalized(ParamState::getDefault(kParamGroupRoleId));
+    parameters.addParameter(groupRoleParam);
+
+    // Per channel trims, then balance and mid/side of the first channel pair
+    constexpr int32 trimFlags = Vst::ParameterInfo::kCanAutomate;
+    for (int channel = 0; channel < kNumTrims; ++channel)
+    {
+        Vst::String128 trimName = {};
+        Steinberg::UString(trimName, USTRINGSIZE(trimName)).assign(STR16("Trim "));
+        Steinberg::UString(trimName + 5, USTRINGSIZE(trimName) - 5).printInt(channel + 1);
+        auto* trimParam =
+            new Vst::RangeParameter(trimName, kParamTrimId + channel, STR16("dB"),
+                                    -dsp::kMaxTrimDecibel, dsp::kMaxTrimDecibel, 0., 0, trimFlags);
+        trimParam->setPrecision(1);
+        parameters.addParameter(trimParam);
+    }
+
+    auto* balanceParam = new Vst::RangeParameter(STR16("Balance"), kParamBalanceId, STR16("%"),
+                                                 -100., 100., 0., 0, trimFlags);
+    balanceParam->setPrecision(0);
+    parameters.addParameter(balanceParam);
+
+    auto* midGainParam =
+        new Vst::RangeParameter(STR16("Mid Gain"), kParamMidGainId, STR16("dB"),
+                                -dsp::kMaxTrimDecibel, dsp::kMaxTrimDecibel, 0., 0, trimFlags);
+    midGainParam->setPrecision(1);
+    parameters.addParameter(midGainParam);
+
+    auto* sideGainParam =
+        new Vst::RangeParameter(STR16("Side Gain"), kParamSideGainId, STR16("dB"),
+                                -dsp::kMaxTrimDecibel, dsp::kMaxTrimDecibel, 0., 0, trimFlags);
+    sideGainParam->setPrecision(1);
+    parameters.addParameter(sideGainParam);
+
+    // The ceiling's level is automatable, switching it on changes the latency.
+    auto* ceilingParam = new Vst::RangeParameter(
+        STR16("Ceiling"), kParamCeilingId, STR16("dB"), dsp::kMinCeilingDecibel, 0.,
+        dsp::kDefaultCeilingDecibel, 0, Vst::ParameterInfo::kCanAutomate);
+    ceilingParam->setPrecision(1);
+    parameters.addParameter(ceilingParam);
+    parameters.addParameter(STR16("Ceiling On"), nullptr, 1, 0., 0, kParamCeilingOnId);
+
+    // Rides the gain towards the loudness target, on top of the gain above.
+    parameters.addParameter(STR16("Auto Gain"), nullptr, 1, 0., Vst::ParameterInfo::kCanAutomate,
+                            kParamAutoGainId);
+    auto* loudnessTargetParam = new Vst::RangeParameter(
+        STR16("Loudness Target"), kParamLoudnessTargetId, STR16("LUFS"), dsp::kMinLoudnessTarget,
+        dsp::kMaxLoudnessTarget, dsp::kDefaultLoudnessTarget, 0, Vst::ParameterInfo::kCanAutomate);
+    loudnessTargetParam->setPrecision(1);
+    parameters.addParameter(loudnessTargetParam);
+    auto* autoGainSlewParam = new Vst::RangeParameter(
+        STR16("Auto Gain Slew"), kParamAutoGainSlewId, STR16("dB/s"), dsp::kMinAutoGainSlew,
+        dsp::kMaxAutoGainSlew, dsp::kDefaultAutoGainSlew, 0, Vst::ParameterInfo::kCanAutomate);
+    autoGainSlewParam->setPrecision(1);
+    parameters.addParameter(autoGainSlewParam);
+
+    // Moves the gain automation in time. Negative offsets need the lookahead,
+    // which adds latency, so only the offset is automatable.
+    auto* automationOffsetParam = new Vst::RangeParameter(
+        STR16("Automation Offset"), kParamAutomationOffsetId, STR16("ms"),
+        -dsp::kMaxAutomationOffset, dsp::kMaxAutomationOffset, 0., 0,
+        Vst::ParameterInfo::kCanAutomate);
+    automationOffsetParam->setPrecision(1);
+    parameters.addParameter(automationOffsetParam);
+    parameters.addParameter(STR16("Offset Lookahead"), nullptr, 1, 0., 0,
+                            kParamOffsetLookaheadId);
+
+    // Meters, shown in dB like the gain, silent until the first frame
+    constexpr int32 meterFlags = Vst::ParameterInfo::kIsReadOnly;
+    parameters.addParameter(
+        new GainParameter(STR16("Input Peak"), meterFlags, kMeterInputPeakId, 0.));
+    parameters.addParameter(
+        new GainParameter(STR16("Input RMS"), meterFlags, kMeterInputRmsId, 0.));
+    parameters.addParameter(
+        new GainParameter(STR16("Output Peak"), meterFlags, kMeterOutputPeakId, 0.));
+    parameters.addParameter(
+        new GainParameter(STR16("Output RMS"), meterFlags, kMeterOutputRmsId, 0.));
+    parameters.addParameter(
+        new GainParameter(STR16("Applied Gain"), meterFlags, kMeterGainId, 0.));
+
+    // Loudness of the output, at the absolute gate until measured
+    const Vst::TChar* loudnessNames[] = {STR16("Momentary"), STR16("Short-Term"),
+                                         STR16("Integrated")};
+    for (int32 index = 0; index <= kMeterIntegratedId - kMeterMomentaryId; ++index)
+    {
+        auto* loudnessParam = new Vst::RangeParameter(
+            loudnessNames[index], kMeterMomentaryId + index, STR16("LUFS"), dsp::kMinLoudness,
+            dsp::kMaxLoudness, dsp::kMinLoudness, 0, meterFlags);
+        loudnessParam->setPrecision(1);
+        parameters.addParameter(loudnessParam);
+    }
+
+#if HA_PROFILING
+    // Time per process() call since the last update and the worst since activation
+    parameters.addParameter(new Vst::RangeParameter(STR16("Process Time Avg"),
+                                                    kProfileAverageTimeId, STR16("us"), 0.,
+                                                    kMaxProfileTime, 0., 0, meterFlags));
+    parameters.addParameter(new Vst::RangeParameter(STR16("Process Time Max"),
+                                                    kProfileMaxTimeId, STR16("us"), 0.,
+                                                    kMaxProfileTime, 0., 0, meterFlags));
+#endif
 
     return result;
 }
@@ -84,15 +302,248 @@ tresult PLUGIN_API GainAutomatorController::initialize(FUnknown* context)
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorController::terminate()
 {
+    meterTimer = nullptr;
+    meterQueue = nullptr;
+#if HA_PROFILING
+    processProfile = nullptr;
+#endif
+    EditorDescription::release();
+    edits.clear();
     return EditControllerEx1::terminate();
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorController::disconnect(Vst::IConnectionPoint* other)
+{
+    meterQueue = nullptr;
+#if HA_PROFILING
+    processProfile = nullptr;
+#endif
+    return EditControllerEx1::disconnect(other);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorController::notify(Vst::IMessage* message)
+{
+    if (!message || !FIDStringsEqual(message->getMessageID(), MeterLink::kQueueMessageId))
+        return EditControllerEx1::notify(message);
+
+    meterQueue = MeterLink::read(*message->getAttributes());
+#if HA_PROFILING
+    processProfile = MeterLink::readProfile(*message->getAttributes());
+#endif
+    if (!meterQueue)
+        return kResultOk;
+
+    if (IPtr<Vst::IMessage> reply = owned(allocateMessage()))
+    {
+        reply->setMessageID(MeterLink::kAcceptedMessageId);
+        sendMessage(reply);
+    }
+    return kResultOk;
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::editorAttached(Vst::EditorView* editor)
+{
+    EditControllerEx1::editorAttached(editor);
+
+    // The timer only runs while at least one editor is open.
+    if (numEditors++ == 0)
+    {
+        if (meterQueue)
+            meterQueue->clear();
+
+        meterTimer = VSTGUI::makeOwned<VSTGUI::CVSTGUITimer>(
+            [this](VSTGUI::CVSTGUITimer*) {
+                updateMeters();
+                flushEdits();
+            },
+            kMeterTimerInterval);
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::editorRemoved(Vst::EditorView* editor)
+{
+    if (--numEditors == 0)
+        meterTimer = nullptr;
+
+    EditControllerEx1::editorRemoved(editor);
+}
+
+//------------------------------------------------------------------------
+tresult GainAutomatorController::beginEdit(Vst::ParamID tag)
+{
+    dsp::edit_thinner& thinner = edits[tag];
+    thinner.set_limits(editTolerance, editMinInterval);
+    thinner.begin();
+    return EditControllerEx1::beginEdit(tag);
+}
+
+//------------------------------------------------------------------------
+tresult GainAutomatorController::performEdit(Vst::ParamID tag, Vst::ParamValue valueNormalized)
+{
+    // Edits outside of begin and end go to the host as they are.
+    auto edit = edits.find(tag);
+    if (edit == edits.end())
+        return EditControllerEx1::performEdit(tag, valueNormalized);
+
+    dsp::edit_point points[2];
+    sendEdits(tag, points, edit->second.push({getEditTime(), valueNormalized}, points));
+    return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult GainAutomatorController::endEdit(Vst::ParamID tag)
+{
+    auto edit = edits.find(tag);
+    if (edit != edits.end())
+    {
+        dsp::edit_point points[2];
+        sendEdits(tag, points, edit->second.end(points));
+        edits.erase(edit);
+    }
+    return EditControllerEx1::endEdit(tag);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::flushEdits()
+{
+    // A knob held still after a fast move sends its merged value.
+    const double time = getEditTime();
+    for (auto& edit : edits)
+    {
+        dsp::edit_point points[2];
+        sendEdits(edit.first, points, edit.second.flush(time, points));
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::sendEdits(Vst::ParamID tag,
+                                        const dsp::edit_point* points,
+                                        int numPoints)
+{
+    for (int i = 0; i < numPoints; ++i)
+        EditControllerEx1::performEdit(tag, points[i].value);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::updateMeters()
+{
+#if HA_PROFILING
+    updateProfile();
+#endif
+
+    if (!meterQueue)
+        return;
+
+    // Peaks are held over all frames since the last update, RMS is the latest.
+    dsp::meter_frame frame;
+    dsp::meter_frame latest;
+    float inputPeak  = 0.f;
+    float outputPeak = 0.f;
+    bool hasFrames   = false;
+    while (meterQueue->pop(frame))
+    {
+        inputPeak  = std::max(inputPeak, frame.input_peak);
+        outputPeak = std::max(outputPeak, frame.output_peak);
+        latest     = frame;
+        hasFrames  = true;
+    }
+
+    if (!hasFrames)
+        return;
+
+    setMeterValue(kMeterInputPeakId, inputPeak);
+    setMeterValue(kMeterInputRmsId, latest.input_rms);
+    setMeterValue(kMeterOutputPeakId, outputPeak);
+    setMeterValue(kMeterOutputRmsId, latest.output_rms);
+    setMeterValue(kMeterGainId, latest.gain);
+    setLoudnessValue(kMeterMomentaryId, latest.loudness.momentary);
+    setLoudnessValue(kMeterShortTermId, latest.loudness.short_term);
+    setLoudnessValue(kMeterIntegratedId, latest.loudness.integrated);
+}
+
+#if HA_PROFILING
+//------------------------------------------------------------------------
+void GainAutomatorController::updateProfile()
+{
+    if (!processProfile)
+        return;
+
+    processProfile->read(profileSnapshot);
+    if (profileSnapshot.cycles_per_second <= 0.)
+        return;
+
+    // The profile restarts on every activation.
+    if (profileSnapshot.num_calls < lastNumCalls)
+    {
+        lastNumCalls    = 0;
+        lastTotalCycles = 0;
+    }
+
+    const double microsecondsPerCycle = 1e6 / profileSnapshot.cycles_per_second;
+    if (const uint64 numCalls = profileSnapshot.num_calls - lastNumCalls)
+    {
+        const uint64 cycles = profileSnapshot.total_cycles - lastTotalCycles;
+        const double averageTime =
+            static_cast<double>(cycles) / static_cast<double>(numCalls) * microsecondsPerCycle;
+        EditControllerEx1::setParamNormalized(kProfileAverageTimeId,
+                                              std::min(averageTime / kMaxProfileTime, 1.));
+    }
+
+    const double maxTime = profileSnapshot.worst.cycles * microsecondsPerCycle;
+    EditControllerEx1::setParamNormalized(kProfileMaxTimeId,
+                                          std::min(maxTime / kMaxProfileTime, 1.));
+
+    lastNumCalls    = profileSnapshot.num_calls;
+    lastTotalCycles = profileSnapshot.total_cycles;
+}
+#endif
+
+//------------------------------------------------------------------------
+void GainAutomatorController::setMeterValue(Vst::ParamID tag, float level)
+{
+    // Levels below the range (including silence) end at its bottom.
+    const float dB = level > 0.f ? 20.f * std::log10(level) : dsp::kMinDecibel;
+    EditControllerEx1::setParamNormalized(tag, dsp::decibel_to_normalized(dB));
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::setLoudnessValue(Vst::ParamID tag, float lufs)
+{
+    const double normalized = (lufs - dsp::kMinLoudness) / (dsp::kMaxLoudness - dsp::kMinLoudness);
+    EditControllerEx1::setParamNormalized(tag, std::min(std::max(normalized, 0.), 1.));
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorController::setComponentState(IBStream* state)
 {
     if (!state)
         return kResultFalse;
 
+    ParamState paramState;
+    const tresult result = paramState.read(state);
+    if (result != kResultOk)
+        return result;
+
+    const bool wasCeilingOn   = getParamNormalized(kParamCeilingOnId) >= 0.5;
+    const bool wasLookaheadOn = getParamNormalized(kParamOffsetLookaheadId) >= 0.5;
+    const bool wasFollower    = isFollower();
+    for (Vst::ParamID id = 0; id < kNumParams; ++id)
+        EditControllerEx1::setParamNormalized(id, paramState.values[id]);
+
+    const bool isCeilingOn = paramState.values[kParamCeilingOnId] >= 0.5;
+    if (isCeilingOn != wasCeilingOn)
+        switchCeiling(isCeilingOn);
+    const bool isLookaheadOn = paramState.values[kParamOffsetLookaheadId] >= 0.5;
+    if (isLookaheadOn != wasLookaheadOn)
+        switchLookahead(isLookaheadOn);
+    if (isFollower() != wasFollower)
+        switchFollower(isFollower());
+    updateGainLaw();
+
     return kResultOk;
 }
 
@@ -113,8 +564,12 @@ IPlugView* PLUGIN_API GainAutomatorController::createView(FIDString name)
 {
     if (FIDStringsEqual(name, Vst::ViewType::kEditor))
     {
-        auto* view = new VSTGUI::VST3Editor(this, "view", "gain_automator_editor.uidesc");
-        return view;
+        // The shared description spares parsing the XML and decoding the knob per open.
+        if (VSTGUI::UIDescription* description = EditorDescription::get())
+            return new VSTGUI::VST3Editor(description, this, EditorDescription::kViewName,
+                                          EditorDescription::kFileName);
+        return new VSTGUI::VST3Editor(this, EditorDescription::kViewName,
+                                      EditorDescription::kFileName);
     }
     return nullptr;
 }
@@ -123,10 +578,83 @@ IPlugView* PLUGIN_API GainAutomatorController::createView(FIDString name)
 tresult PLUGIN_API GainAutomatorController::setParamNormalized(Vst::ParamID tag,
                                                                Vst::ParamValue value)
 {
-    tresult result = EditControllerEx1::setParamNormalized(tag, value);
+    const bool wasCeilingOn   = getParamNormalized(kParamCeilingOnId) >= 0.5;
+    const bool wasLookaheadOn = getParamNormalized(kParamOffsetLookaheadId) >= 0.5;
+    const bool wasFollower    = isFollower();
+    tresult result            = EditControllerEx1::setParamNormalized(tag, value);
+    if (result == kResultOk && tag == kParamCeilingOnId && (value >= 0.5) != wasCeilingOn)
+        switchCeiling(value >= 0.5);
+    if (result == kResultOk && tag == kParamOffsetLookaheadId && (value >= 0.5) != wasLookaheadOn)
+        switchLookahead(value >= 0.5);
+    if (result == kResultOk && isFollower() != wasFollower)
+        switchFollower(isFollower());
+    if (result == kResultOk && tag == kParamGainLawId)
+        updateGainLaw();
     return result;
 }
 
+//------------------------------------------------------------------------
+void GainAutomatorController::switchCeiling(bool isOn)
+{
+    // The processor reports the new latency as soon as the host asks for it.
+    if (IPtr<Vst::IMessage> message = owned(allocateMessage()))
+    {
+        message->setMessageID(kCeilingMessageId);
+        message->getAttributes()->setInt(kCeilingOnAttr, isOn ? 1 : 0);
+        sendMessage(message);
+    }
+
+    if (componentHandler)
+        componentHandler->restartComponent(Vst::kLatencyChanged);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::switchLookahead(bool isOn)
+{
+    // The lookahead delays the audio, like switching the ceiling.
+    if (IPtr<Vst::IMessage> message = owned(allocateMessage()))
+    {
+        message->setMessageID(kLookaheadMessageId);
+        message->getAttributes()->setInt(kLookaheadOnAttr, isOn ? 1 : 0);
+        sendMessage(message);
+    }
+
+    if (componentHandler)
+        componentHandler->restartComponent(Vst::kLatencyChanged);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::switchFollower(bool isOn)
+{
+    // Followers delay the audio by one block, see GainAutomatorProcessor.
+    if (IPtr<Vst::IMessage> message = owned(allocateMessage()))
+    {
+        message->setMessageID(kFollowerMessageId);
+        message->getAttributes()->setInt(kFollowerOnAttr, isOn ? 1 : 0);
+        sendMessage(message);
+    }
+
+    if (componentHandler)
+        componentHandler->restartComponent(Vst::kLatencyChanged);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorController::updateGainLaw()
+{
+    // The same 'Gain' value reads differently under another law.
+    auto* gainParam         = static_cast<GainParameter*>(getParameterObject(kParamGainId));
+    const dsp::gain_law law = dsp::to_gain_law(getParamNormalized(kParamGainLawId));
+    if (gainParam && gainParam->setGainLaw(law) && componentHandler)
+        componentHandler->restartComponent(Vst::kParamValuesChanged);
+}
+
+//------------------------------------------------------------------------
+bool GainAutomatorController::isFollower()
+{
+    return dsp::to_gain_group(getParamNormalized(kParamGainGroupId)) >= 0 &&
+           dsp::to_group_role(getParamNormalized(kParamGroupRoleId)) == dsp::group_role::follower;
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorController::getParamStringByValue(Vst::ParamID tag,
                                                                   Vst::ParamValue valueNormalized,
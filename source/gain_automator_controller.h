@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include "gain_automator_edit_thinning.h"
+#include "gain_automator_meter.h"
+#include "gain_automator_profile.h"
 #include "public.sdk/source/vst/vsteditcontroller.h"
+#include "vstgui/lib/cvstguitimer.h"
+#include <map>
 
 namespace ha {
 
@@ -43,6 +48,17 @@ public:
                                                         Steinberg::Vst::TChar* string,
                                                         Steinberg::Vst::ParamValue& valueNormalized)
         SMTG_OVERRIDE;
+    void editorAttached(Steinberg::Vst::EditorView* editor) SMTG_OVERRIDE;
+    void editorRemoved(Steinberg::Vst::EditorView* editor) SMTG_OVERRIDE;
+    Steinberg::tresult beginEdit(Steinberg::Vst::ParamID tag) SMTG_OVERRIDE;
+    Steinberg::tresult performEdit(Steinberg::Vst::ParamID tag,
+                                   Steinberg::Vst::ParamValue valueNormalized) SMTG_OVERRIDE;
+    Steinberg::tresult endEdit(Steinberg::Vst::ParamID tag) SMTG_OVERRIDE;
+
+    // ComponentBase
+    Steinberg::tresult PLUGIN_API disconnect(Steinberg::Vst::IConnectionPoint* other)
+        SMTG_OVERRIDE;
+    Steinberg::tresult PLUGIN_API notify(Steinberg::Vst::IMessage* message) SMTG_OVERRIDE;
 
     //---Interface---------
     DEFINE_INTERFACES
@@ -53,6 +69,33 @@ public:
 
     //--------------------------------------------------------------------
 protected:
+    void switchCeiling(bool isOn);
+    void switchLookahead(bool isOn);
+    void switchFollower(bool isOn);
+    bool isFollower();
+    void updateGainLaw();
+    void updateMeters();
+    void setMeterValue(Steinberg::Vst::ParamID tag, float level);
+    void setLoudnessValue(Steinberg::Vst::ParamID tag, float lufs);
+    void flushEdits();
+    void sendEdits(Steinberg::Vst::ParamID tag, const dsp::edit_point* points, int numPoints);
+
+    dsp::meter_queue* meterQueue = nullptr;
+#if HA_PROFILING
+    void updateProfile();
+
+    const dsp::process_profile* processProfile = nullptr;
+    dsp::profile_snapshot profileSnapshot;
+    Steinberg::uint64 lastNumCalls    = 0;
+    Steinberg::uint64 lastTotalCycles = 0;
+#endif
+    VSTGUI::SharedPointer<VSTGUI::CVSTGUITimer> meterTimer;
+
+    // Edits in progress, thinned before they reach the host.
+    std::map<Steinberg::Vst::ParamID, dsp::edit_thinner> edits;
+    double editTolerance   = dsp::kDefaultEditTolerance;
+    double editMinInterval = dsp::kDefaultEditMinInterval;
+    Steinberg::int32 numEditors = 0;
 };
 
 //------------------------------------------------------------------------
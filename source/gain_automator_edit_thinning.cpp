@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_edit_thinning.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+void edit_thinner::set_limits(double tolerance, double min_interval)
+{
+    this->tolerance    = std::max(tolerance, 0.);
+    this->min_interval = std::max(min_interval, 0.);
+}
+
+//------------------------------------------------------------------------
+void edit_thinner::begin()
+{
+    has_last    = false;
+    has_pending = false;
+    has_hold    = false;
+}
+
+//------------------------------------------------------------------------
+int edit_thinner::push(const edit_point& point, edit_point* kept)
+{
+    if (!has_last)
+        return keep(point, kept);
+
+    const bool is_within = std::abs(point.value - last.value) <= tolerance;
+    if (is_within || point.time < last.time + min_interval)
+    {
+        if (is_within)
+        {
+            hold     = point;
+            has_hold = true;
+        }
+        pending     = point;
+        has_pending = true;
+        return 0;
+    }
+    return keep(point, kept);
+}
+
+//------------------------------------------------------------------------
+int edit_thinner::flush(double time, edit_point* kept)
+{
+    if (!has_pending || std::abs(pending.value - last.value) <= tolerance ||
+        time < last.time + min_interval)
+        return 0;
+
+    return keep({time, pending.value}, kept);
+}
+
+//------------------------------------------------------------------------
+int edit_thinner::end(edit_point* kept)
+{
+    int num_kept = 0;
+    if (has_pending && pending.value != last.value)
+        num_kept = keep(pending, kept);
+
+    begin();
+    return num_kept;
+}
+
+//------------------------------------------------------------------------
+int edit_thinner::keep(const edit_point& point, edit_point* kept)
+{
+    // Ends a hold where it ended, unless the line to 'point' passes it anyway.
+    int num_kept = 0;
+    if (has_hold && hold.time > last.time && hold.time < point.time)
+    {
+        const double position = (hold.time - last.time) / (point.time - last.time);
+        const double line     = last.value + (point.value - last.value) * position;
+        if (std::abs(hold.value - line) > tolerance)
+            kept[num_kept++] = hold;
+    }
+    kept[num_kept++] = point;
+
+    last        = point;
+    has_last    = true;
+    has_pending = false;
+    has_hold    = false;
+    return num_kept;
+}
+
+//------------------------------------------------------------------------
+std::vector<edit_point>
+thin_edit_points(const std::vector<edit_point>& points, double tolerance, double min_interval)
+{
+    edit_thinner thinner;
+    thinner.set_limits(tolerance, min_interval);
+    thinner.begin();
+
+    std::vector<edit_point> thinned;
+    edit_point kept[2];
+    for (const edit_point& point : points)
+    {
+        const int num_kept = thinner.push(point, kept);
+        thinned.insert(thinned.end(), kept, kept + num_kept);
+    }
+    const int num_kept = thinner.end(kept);
+    thinned.insert(thinned.end(), kept, kept + num_kept);
+    return thinned;
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
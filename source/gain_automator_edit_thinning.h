@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Defaults of the edit thinning: tolerance as normalized value, interval
+// in seconds.
+static constexpr double kDefaultEditTolerance   = 0.001;
+static constexpr double kDefaultEditMinInterval = 0.01;
+
+//------------------------------------------------------------------------
+struct edit_point
+{
+    double time  = 0.; // seconds
+    double value = 0.; // normalized
+};
+
+//------------------------------------------------------------------------
+// edit_thinner
+//
+// Thins the points of one parameter edit (a knob drag) or lane. A point is
+// dropped while it stays within the tolerance of the last kept point, and
+// merged into the next one while it is closer than the minimum interval
+// to it. When a point is kept after dropped ones within the tolerance,
+// the last of those is kept as well if the line to the new point misses
+// it, so a hold stays a hold and does not turn into a ramp towards the
+// next point. The first and the last value are always kept exactly.
+//
+// Usage: begin(), push() per point, optionally flush() when no points
+// arrive for a while, end().
+//------------------------------------------------------------------------
+class edit_thinner
+{
+public:
+    // A tolerance and interval of 0 drop repeated values only.
+    void set_limits(double tolerance, double min_interval);
+
+    void begin();
+    // Returns the number of points to keep now, at most two, in 'kept'.
+    int push(const edit_point& point, edit_point* kept);
+    // Keeps the last merged point at 'time', once the interval has passed.
+    int flush(double time, edit_point* kept);
+    // Keeps the last point, unless its value was kept already.
+    int end(edit_point* kept);
+
+private:
+    int keep(const edit_point& point, edit_point* kept);
+
+    double tolerance    = kDefaultEditTolerance;
+    double min_interval = kDefaultEditMinInterval;
+
+    edit_point last;    // kept
+    edit_point pending; // the latest dropped or merged
+    edit_point hold;    // the latest dropped within the tolerance
+    bool has_last    = false;
+    bool has_pending = false;
+    bool has_hold    = false;
+};
+
+//------------------------------------------------------------------------
+// Thins a lane sorted by time with an edit_thinner, as one edit.
+std::vector<edit_point>
+thin_edit_points(const std::vector<edit_point>& points, double tolerance, double min_interval);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
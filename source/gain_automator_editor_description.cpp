@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_editor_description.h"
+
+#include <list>
+#include <string>
+
+namespace ha {
+namespace EditorDescription {
+namespace {
+
+//------------------------------------------------------------------------
+struct Shared
+{
+    VSTGUI::SharedPointer<VSTGUI::UIDescription> description;
+    int numUsers  = 0;
+    bool isFailed = false; // not parsed again for every open
+};
+
+//------------------------------------------------------------------------
+Shared& getShared()
+{
+    static Shared shared;
+    return shared;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+void retain()
+{
+    ++getShared().numUsers;
+}
+
+//------------------------------------------------------------------------
+void release()
+{
+    Shared& shared = getShared();
+    if (shared.numUsers == 0 || --shared.numUsers > 0)
+        return;
+
+    // Freed while VSTGUI is still initialised, not at static destruction.
+    shared.description = nullptr;
+    shared.isFailed    = false;
+}
+
+//------------------------------------------------------------------------
+VSTGUI::UIDescription* get()
+{
+    Shared& shared = getShared();
+    if (shared.description || shared.isFailed)
+        return shared.description;
+
+    auto description =
+        VSTGUI::makeOwned<VSTGUI::UIDescription>(VSTGUI::CResourceDescription(kFileName));
+    if (!description->parse())
+    {
+        shared.isFailed = true;
+        return nullptr;
+    }
+
+    // Bitmaps are decoded on first access, do it now for all editors.
+    std::list<const std::string*> bitmapNames;
+    description->collectBitmapNames(bitmapNames);
+    for (const std::string* name : bitmapNames)
+        description->getBitmap(name->c_str());
+
+    shared.description = description;
+    return shared.description;
+}
+
+//------------------------------------------------------------------------
+} // namespace EditorDescription
+} // namespace ha
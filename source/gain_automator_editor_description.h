@@ -0,0 +1,36 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "vstgui/uidescription/uidescription.h"
+
+namespace ha {
+
+//------------------------------------------------------------------------
+//  EditorDescription
+//
+//  The editor's UI description, shared by all controllers of the process.
+//  It is parsed and its bitmaps (the knob filmstrip) are decoded on the
+//  first editor open, every further editor of any instance reuses them.
+//  Controllers retain it from initialize() to terminate(), it is freed
+//  with the last one. An open editor keeps its own reference.
+//
+//  UI thread only, like the edit controllers.
+//------------------------------------------------------------------------
+namespace EditorDescription {
+
+static constexpr const char* kFileName = "gain_automator_editor.uidesc";
+static constexpr const char* kViewName = "view";
+
+void retain();
+void release();
+
+// Parses on first use. Returns null if the description cannot be parsed.
+VSTGUI::UIDescription* get();
+
+} // namespace EditorDescription
+
+//------------------------------------------------------------------------
+} // namespace ha
@@ -0,0 +1,250 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_gain_bus.h"
+
+#include <algorithm>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+bool is_valid_group(int group)
+{
+    return group >= 0 && group < kNumGainGroups;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int to_gain_group(double normalized)
+{
+    // Entry 0 is 'Off', then one entry per group.
+    const int index = static_cast<int>(normalized * kNumGainGroups + 0.5);
+    return std::min(std::max(index, 0), kNumGainGroups) - 1;
+}
+
+//------------------------------------------------------------------------
+double to_normalized_gain_group(int group)
+{
+    const int index = std::min(std::max(group + 1, 0), kNumGainGroups);
+    return static_cast<double>(index) / kNumGainGroups;
+}
+
+//------------------------------------------------------------------------
+group_role to_group_role(double normalized)
+{
+    const int count = static_cast<int>(group_role::count);
+    const int index = static_cast<int>(normalized * (count - 1) + 0.5);
+    return static_cast<group_role>(std::min(std::max(index, 0), count - 1));
+}
+
+//------------------------------------------------------------------------
+double to_normalized(group_role role)
+{
+    const int count = static_cast<int>(group_role::count);
+    return static_cast<double>(role) / (count - 1);
+}
+
+//------------------------------------------------------------------------
+// gain_bus
+//------------------------------------------------------------------------
+gain_bus& gain_bus::get_instance()
+{
+    // Constant initialized, no guard on first use from the audio thread.
+    static gain_bus instance;
+    return instance;
+}
+
+//------------------------------------------------------------------------
+void gain_bus::publish(int group,
+                       std::int64_t position,
+                       const gain_curve& curve,
+                       int offset,
+                       int num_samples)
+{
+    if (!is_valid_group(group))
+        return;
+
+    group_slot& slot = slots[group];
+    slot.latest.store(curve.get_last_gain(), std::memory_order_relaxed);
+    if (position < 0 || num_samples <= 0 || offset < 0 ||
+        offset + num_samples > curve.get_num_samples())
+        return;
+
+    if (slot.is_publishing.exchange(true, std::memory_order_acquire))
+        return;
+
+    const std::int64_t sequence   = slot.end.load(std::memory_order_relaxed);
+    const std::uint32_t num_runs  = slot.num_runs.load(std::memory_order_relaxed);
+    const run& latest_run         = slot.runs[(num_runs + kMaxRuns - 1) % kMaxRuns];
+    const std::int64_t continuing = latest_run.position.load(std::memory_order_relaxed) +
+                                    sequence - latest_run.sequence.load(std::memory_order_relaxed);
+    if (num_runs == 0 || position != continuing)
+    {
+        // Locate, loop or the first block: a new run. The oldest one is
+        // replaced, readers of it notice by the epoch.
+        const std::uint32_t epoch = slot.epoch.load(std::memory_order_relaxed);
+        slot.epoch.store(epoch + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        run& new_run = slot.runs[num_runs % kMaxRuns];
+        new_run.position.store(position, std::memory_order_relaxed);
+        new_run.sequence.store(sequence, std::memory_order_relaxed);
+        slot.num_runs.store(num_runs + 1, std::memory_order_relaxed);
+        slot.epoch.store(epoch + 2, std::memory_order_release);
+    }
+
+    // Announcing the limit first lets readers detect that the ring wrapped
+    // onto their range while they copied.
+    const std::int64_t new_end = sequence + num_samples;
+    slot.limit.store(new_end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    write_curve(slot, sequence, curve, offset, num_samples);
+    slot.end.store(new_end, std::memory_order_release);
+
+    slot.is_publishing.store(false, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void gain_bus::write_curve(group_slot& slot,
+                           std::int64_t sequence,
+                           const gain_curve& curve,
+                           int offset,
+                           int num_samples)
+{
+    // The same float expressions as the gain kernels, a follower at unity
+    // gain reproduces the leader's output bit for bit.
+    switch (curve.get_shape())
+    {
+        case gain_curve::shape::constant:
+        {
+            const float gain = curve.get_constant();
+            for (int i = 0; i < num_samples; ++i)
+                slot.gains[(sequence + i) & kHistoryMask].store(gain, std::memory_order_relaxed);
+            break;
+        }
+        case gain_curve::shape::segments:
+        {
+            const int end = offset + num_samples;
+            for (const auto& segment : curve.get_segments())
+            {
+                const int first = std::max(segment.offset, offset);
+                const int last  = std::min(segment.offset + segment.length, end);
+                for (int i = first; i < last; ++i)
+                {
+                    const float gain = segment.get_gain(i - segment.offset);
+                    slot.gains[(sequence + i - offset) & kHistoryMask].store(
+                        gain, std::memory_order_relaxed);
+                }
+            }
+            break;
+        }
+        case gain_curve::shape::samples:
+        {
+            const float* gains = curve.get_samples() + offset;
+            for (int i = 0; i < num_samples; ++i)
+                slot.gains[(sequence + i) & kHistoryMask].store(gains[i],
+                                                                std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+gain_bus::block gain_bus::read(int group,
+                               std::int64_t position,
+                               int num_samples,
+                               float* out,
+                               cursor& at) const
+{
+    const bool is_continued = at.position == position;
+    at.position             = kNoPosition;
+    if (!is_valid_group(group))
+    {
+        out[0] = 1.f;
+        return {};
+    }
+
+    const group_slot& slot = slots[group];
+    if (position < 0 || num_samples <= 0 || num_samples > kHistorySize)
+    {
+        out[0] = slot.latest.load(std::memory_order_relaxed);
+        return {};
+    }
+
+    // A run started by the leader meanwhile only means another try.
+    for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt)
+    {
+        const std::uint32_t epoch    = slot.epoch.load(std::memory_order_acquire);
+        const std::int64_t end       = slot.end.load(std::memory_order_acquire);
+        const std::uint32_t num_runs = slot.num_runs.load(std::memory_order_relaxed);
+        if (epoch & 1)
+            continue;
+
+        // The run the cursor is in if it holds the whole range, otherwise
+        // the latest which does. A loop may have published the same
+        // positions before.
+        const std::uint32_t num_known = std::min<std::uint32_t>(num_runs, kMaxRuns);
+        std::int64_t sequence         = -1;
+        std::int64_t run_end          = end;
+        for (std::uint32_t index = 0; index < num_known && run_end > end - kHistorySize; ++index)
+        {
+            const run& candidate            = slot.runs[(num_runs - 1 - index) % kMaxRuns];
+            const std::int64_t run_position = candidate.position.load(std::memory_order_relaxed);
+            const std::int64_t run_sequence = candidate.sequence.load(std::memory_order_relaxed);
+            if (position >= run_position &&
+                position + num_samples <= run_position + run_end - run_sequence)
+            {
+                const std::int64_t held = run_sequence + position - run_position;
+                if (sequence < 0 || (is_continued && held == at.sequence))
+                    sequence = held;
+                if (!is_continued || held == at.sequence)
+                    break;
+            }
+            run_end = run_sequence;
+        }
+
+        const bool is_held = sequence >= 0 && sequence >= end - kHistorySize;
+        bool is_constant   = true;
+        for (int i = 0; is_held && i < num_samples; ++i)
+        {
+            out[i] = slot.gains[(sequence + i) & kHistoryMask].load(std::memory_order_relaxed);
+            is_constant &= out[i] == out[0];
+        }
+
+        // Valid unless a run was started or the ring wrapped onto the range
+        // in the meantime.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.epoch.load(std::memory_order_relaxed) != epoch)
+            continue;
+        if (is_held && slot.limit.load(std::memory_order_relaxed) <= sequence + kHistorySize)
+        {
+            at = {position + num_samples, sequence + num_samples};
+            return {true, is_constant};
+        }
+        break;
+    }
+
+    slot.num_misses.fetch_add(1, std::memory_order_relaxed);
+    out[0] = slot.latest.load(std::memory_order_relaxed);
+    return {};
+}
+
+//------------------------------------------------------------------------
+float gain_bus::get_latest(int group) const
+{
+    return is_valid_group(group) ? slots[group].latest.load(std::memory_order_relaxed) : 1.f;
+}
+
+//------------------------------------------------------------------------
+std::uint64_t gain_bus::get_num_misses(int group) const
+{
+    return is_valid_group(group) ? slots[group].num_misses.load(std::memory_order_relaxed) : 0;
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
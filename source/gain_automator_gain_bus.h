@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_gain_curve.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+static constexpr int kNumGainGroups = 8;
+
+//------------------------------------------------------------------------
+// group_role
+//
+// The order matches the entries of the 'Group Role' list parameter.
+//------------------------------------------------------------------------
+enum class group_role
+{
+    leader,   // publishes its gain curve to the group
+    follower, // applies the leader's curve on top of its own gain
+    count
+};
+
+//------------------------------------------------------------------------
+// Gain group of a normalized 'Gain Group' value: -1 for none, otherwise
+// 0 to kNumGainGroups - 1.
+int to_gain_group(double normalized);
+double to_normalized_gain_group(int group);
+
+group_role to_group_role(double normalized);
+double to_normalized(group_role role);
+
+//------------------------------------------------------------------------
+// gain_bus
+//
+// Process wide exchange of linear gain curves between the instances of a
+// gain group. The leader publishes every block it processes, keyed by the
+// project time of the audio it applies the block to, into a history of
+// the last kHistorySize gains per group. A locate or loop starts a new run
+// of positions, the runs before it stay readable while their gains are in
+// the history. Followers read the range of the audio they apply the gains
+// to, which is only published in time if they run after the leader in
+// the same host cycle. Followers therefore delay their audio by one block,
+// see GainAutomatorProcessor::getAudioDelay.
+//
+// Both sides are wait-free and never allocate. A reader that overlaps with
+// the leader overwriting its range, or asks for a range which has not been
+// published (yet), gets the leader's latest gain instead and is told so.
+// Only one leader per group is supported: while a leader publishes, a
+// second one's block is dropped rather than waited for.
+//------------------------------------------------------------------------
+class gain_bus
+{
+public:
+    static constexpr std::int64_t kNoPosition = -1;
+    static constexpr int kHistorySize         = 1 << 16;
+
+    struct block
+    {
+        bool is_exact    = false; // the leader's curve for the requested range
+        bool is_constant = true;  // only out[0] has been written
+    };
+
+    // Where a follower's last read ended. A read right after it continues
+    // in the same run, even if a newer one holds the positions as well,
+    // e.g. when the leader looped back a little.
+    struct cursor
+    {
+        std::int64_t position = kNoPosition;
+        std::int64_t sequence = 0;
+    };
+
+    // The bus shared by all instances of the plug-in module.
+    static gain_bus& get_instance();
+
+    // Leader side. Publishes 'num_samples' of 'curve' from 'offset'.
+    // 'position' is the project time of the first of them or kNoPosition
+    // without a running transport, then only the latest gain is updated.
+    void publish(int group,
+                 std::int64_t position,
+                 const gain_curve& curve,
+                 int offset,
+                 int num_samples);
+
+    // Follower side. Writes the gains of the 'num_samples' from 'position'
+    // to 'out', or just out[0] if they are all equal, and moves 'at' on.
+    block read(int group, std::int64_t position, int num_samples, float* out, cursor& at) const;
+
+    // The leader's gain at the end of its last block, unity without one.
+    float get_latest(int group) const;
+
+    // Reads with a position which got the latest gain instead, e.g. for
+    // tests of the host's order.
+    std::uint64_t get_num_misses(int group) const;
+
+private:
+    static constexpr std::int64_t kHistoryMask = kHistorySize - 1;
+    static constexpr int kMaxRuns              = 16;
+    static constexpr int kMaxReadAttempts      = 4;
+
+    // Gains are numbered in the order of publishing, the history holds the
+    // last kHistorySize of them. A run maps positions onto these numbers.
+    struct run
+    {
+        std::atomic<std::int64_t> position{0};
+        std::atomic<std::int64_t> sequence{0}; // of the gain at 'position'
+    };
+
+    struct alignas(64) group_slot
+    {
+        std::atomic<bool> is_publishing{false};
+        std::atomic<std::uint32_t> epoch{0};    // odd while a run is started
+        std::atomic<std::uint32_t> num_runs{0}; // started, the latest is the last
+        std::atomic<std::int64_t> end{0};       // sequence one past the last published gain
+        std::atomic<std::int64_t> limit{0};     // sequence one past the last gain being written
+        std::atomic<float> latest{1.f};
+        mutable std::atomic<std::uint64_t> num_misses{0};
+        std::array<run, kMaxRuns> runs{};
+        std::array<std::atomic<float>, kHistorySize> gains{};
+    };
+
+    static void write_curve(group_slot& slot,
+                            std::int64_t sequence,
+                            const gain_curve& curve,
+                            int offset,
+                            int num_samples);
+
+    std::array<group_slot, kNumGainGroups> slots;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,438 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_gain_curve.h"
+#include "gain_automator_worker_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Below this average segment length the block is rendered into samples,
+// which avoids paying the per segment overhead once per channel.
+constexpr int kMinSegmentLength = 16;
+
+// Blocks with fewer samples (all channels) are not worth waking the workers.
+constexpr int kMinParallelSamples = 1 << 16;
+// Time chunks shorter than this do not pay for their task.
+constexpr int kMinChunkSamples = 1 << 13;
+// Tasks per thread, so threads finishing early find some work left.
+constexpr int kTasksPerThread   = 4;
+constexpr int kMaxParallelTasks = 256;
+
+//------------------------------------------------------------------------
+// parallel_job
+//
+// Task 'chunk * num_groups + group' applies the curve to the channels of
+// 'group' and the samples of 'chunk'. With a segments curve, chunks are
+// runs of whole segments.
+//------------------------------------------------------------------------
+template <typename SampleType>
+struct parallel_job
+{
+    const gain_kernel<SampleType>* kernel = nullptr;
+    const gain_curve* curve               = nullptr;
+    const SampleType* const* in           = nullptr;
+    SampleType* const* out                = nullptr;
+    int num_channels                      = 0;
+    int num_groups                        = 0;
+    int num_chunks                        = 0;
+    bool is_metered                       = false;
+
+    std::array<int, kMaxParallelTasks + 1> chunk_offsets{};  // first sample
+    std::array<int, kMaxParallelTasks + 1> chunk_segments{}; // first segment
+    std::array<level_meter, kMaxParallelTasks> meters;
+
+    void plan(int max_chunks);
+    static void run_task(void* context, int task);
+};
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void parallel_job<SampleType>::plan(int max_chunks)
+{
+    const int num_samples = curve->get_num_samples();
+    if (curve->get_shape() != gain_curve::shape::segments)
+    {
+        num_chunks = max_chunks;
+        for (int chunk = 0; chunk <= num_chunks; ++chunk)
+            chunk_offsets[chunk] =
+                static_cast<int>(static_cast<long long>(num_samples) * chunk / num_chunks);
+        return;
+    }
+
+    // Cut at the first segment at or behind every even split point.
+    const gain_segments& segments = curve->get_segments();
+    num_chunks                     = 0;
+    chunk_offsets[0]               = 0;
+    chunk_segments[0]              = 0;
+    for (int index = 0; index < segments.size(); ++index)
+    {
+        const int offset = segments.begin()[index].offset;
+        const auto split = static_cast<long long>(num_samples) * (num_chunks + 1) / max_chunks;
+        if (num_chunks + 1 < max_chunks && offset >= split && offset > chunk_offsets[num_chunks])
+        {
+            ++num_chunks;
+            chunk_offsets[num_chunks]  = offset;
+            chunk_segments[num_chunks] = index;
+        }
+    }
+    ++num_chunks;
+    chunk_offsets[num_chunks]  = num_samples;
+    chunk_segments[num_chunks] = segments.size();
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void parallel_job<SampleType>::run_task(void* context, int task)
+{
+    auto& job          = *static_cast<parallel_job*>(context);
+    const auto& kernel = *job.kernel;
+    const auto& curve  = *job.curve;
+    const int chunk    = task / job.num_groups;
+    const int group    = task % job.num_groups;
+    const int first    = group * job.num_channels / job.num_groups;
+    const int last     = (group + 1) * job.num_channels / job.num_groups;
+    const int begin    = job.chunk_offsets[chunk];
+    const int length   = job.chunk_offsets[chunk + 1] - begin;
+    level_meter* meter = job.is_metered ? &job.meters[task] : nullptr;
+
+    switch (curve.get_shape())
+    {
+        case gain_curve::shape::constant:
+        {
+            for (int channel = first; channel < last; ++channel)
+            {
+                if (job.in[channel] && job.out[channel])
+                    kernel.apply_constant(job.in[channel] + begin, job.out[channel] + begin,
+                                          length, curve.get_constant(), meter);
+            }
+            break;
+        }
+        case gain_curve::shape::samples:
+        {
+            for (int channel = first; channel < last; ++channel)
+            {
+                if (job.in[channel] && job.out[channel])
+                    kernel.apply_curve(job.in[channel] + begin, job.out[channel] + begin, length,
+                                       curve.get_samples() + begin, meter);
+            }
+            break;
+        }
+        case gain_curve::shape::segments:
+        {
+            const auto segments = curve.get_segments().begin();
+            for (int index = job.chunk_segments[chunk]; index < job.chunk_segments[chunk + 1];
+                 ++index)
+            {
+                const gain_segment& segment = segments[index];
+                for (int channel = first; channel < last; ++channel)
+                {
+                    if (!job.in[channel] || !job.out[channel])
+                        continue;
+
+                    const SampleType* src = job.in[channel] + segment.offset;
+                    SampleType* dst       = job.out[channel] + segment.offset;
+                    if (segment.is_constant())
+                        kernel.apply_constant(src, dst, segment.length, segment.start, meter);
+                    else
+                        kernel.apply_ramp(src, dst, segment.length, segment.start,
+                                          segment.increment, segment.phase, meter);
+                }
+            }
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// gain_curve
+//------------------------------------------------------------------------
+void gain_curve::reserve(int max_samples_per_block)
+{
+    samples.resize(std::max(max_samples_per_block, 0));
+}
+
+//------------------------------------------------------------------------
+void gain_curve::build(const gain_segments& normalized, gain_law law, simd_level level)
+{
+    segments    = &normalized;
+    num_samples = normalized.get_num_samples();
+
+    // A host exceeding maxSamplesPerBlock gets the block's final gain.
+    const bool is_oversized = num_samples > static_cast<int>(samples.size());
+    if (normalized.empty() || normalized.is_constant() || is_oversized)
+    {
+        const float value = normalized.empty() || is_oversized ? normalized.get_last_value()
+                                                               : normalized.begin()->start;
+        curve_shape = shape::constant;
+        constant    = to_gain(law, value);
+        return;
+    }
+
+    const bool is_dense = normalized.size() * kMinSegmentLength > num_samples;
+    if (law == gain_law::linear && !is_dense)
+    {
+        curve_shape = shape::segments;
+        return;
+    }
+
+    curve_shape = shape::samples;
+    normalized.render(samples.data());
+    apply_gain_law(level, law, samples.data(), num_samples);
+}
+
+//------------------------------------------------------------------------
+void gain_curve::build(const float* normalized, int new_num_samples, gain_law law, simd_level level)
+{
+    segments    = nullptr;
+    num_samples = std::min(new_num_samples, static_cast<int>(samples.size()));
+    curve_shape = shape::samples;
+    std::memcpy(samples.data(), normalized, num_samples * sizeof(float));
+    apply_gain_law(level, law, samples.data(), num_samples);
+}
+
+//------------------------------------------------------------------------
+void gain_curve::build_constant(float gain, int new_num_samples)
+{
+    segments    = nullptr;
+    num_samples = new_num_samples;
+    curve_shape = shape::constant;
+    constant    = gain;
+}
+
+//------------------------------------------------------------------------
+void gain_curve::render_samples()
+{
+    switch (curve_shape)
+    {
+        case shape::constant:
+            std::fill(samples.begin(), samples.begin() + num_samples, constant);
+            break;
+        case shape::segments: segments->render(samples.data()); break;
+        default: break;
+    }
+    curve_shape = shape::samples;
+}
+
+//------------------------------------------------------------------------
+void gain_curve::mix_to_unity(const float* mix)
+{
+    // Only runs during crossfades, a few milliseconds at a time.
+    if (num_samples > static_cast<int>(samples.size()))
+        return;
+
+    render_samples();
+    for (int i = 0; i < num_samples; ++i)
+        samples[i] += (1.f - samples[i]) * mix[i];
+}
+
+//------------------------------------------------------------------------
+void gain_curve::mix_to_unity(float mix)
+{
+    if (curve_shape == shape::constant || num_samples > static_cast<int>(samples.size()))
+    {
+        constant += (1.f - constant) * mix;
+        return;
+    }
+
+    render_samples();
+    for (int i = 0; i < num_samples; ++i)
+        samples[i] += (1.f - samples[i]) * mix;
+}
+
+//------------------------------------------------------------------------
+void gain_curve::multiply(const float* gains)
+{
+    if (num_samples > static_cast<int>(samples.size()))
+        return;
+
+    render_samples();
+    for (int i = 0; i < num_samples; ++i)
+        samples[i] *= gains[i];
+}
+
+//------------------------------------------------------------------------
+void gain_curve::multiply(float gain)
+{
+    if (curve_shape == shape::constant || num_samples > static_cast<int>(samples.size()))
+    {
+        constant *= gain;
+        return;
+    }
+
+    render_samples();
+    for (int i = 0; i < num_samples; ++i)
+        samples[i] *= gain;
+}
+
+//------------------------------------------------------------------------
+void gain_curve::render(float* gains) const
+{
+    switch (curve_shape)
+    {
+        case shape::constant: std::fill_n(gains, num_samples, constant); break;
+        case shape::segments: segments->render(gains); break;
+        case shape::samples: std::copy_n(samples.data(), num_samples, gains); break;
+    }
+}
+
+//------------------------------------------------------------------------
+float gain_curve::get_last_gain() const
+{
+    if (num_samples <= 0)
+        return constant;
+
+    switch (curve_shape)
+    {
+        case shape::segments:
+        {
+            const gain_segment& last = *std::prev(segments->end());
+            return last.get_gain(last.length - 1);
+        }
+        case shape::samples: return samples[num_samples - 1];
+        default: return constant;
+    }
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void apply_gain_curve(const gain_kernel<SampleType>& kernel,
+                      const gain_curve& curve,
+                      const SampleType* const* in,
+                      SampleType* const* out,
+                      int num_channels,
+                      level_meter* meter)
+{
+    const int num_samples = curve.get_num_samples();
+    switch (curve.get_shape())
+    {
+        case gain_curve::shape::constant:
+        {
+            for (int channel = 0; channel < num_channels; ++channel)
+            {
+                if (in[channel] && out[channel])
+                    kernel.apply_constant(in[channel], out[channel], num_samples,
+                                          curve.get_constant(), meter);
+            }
+            break;
+        }
+        case gain_curve::shape::samples:
+        {
+            for (int channel = 0; channel < num_channels; ++channel)
+            {
+                if (in[channel] && out[channel])
+                    kernel.apply_curve(in[channel], out[channel], num_samples,
+                                       curve.get_samples(), meter);
+            }
+            break;
+        }
+        case gain_curve::shape::segments:
+        {
+            for (const auto& segment : curve.get_segments())
+            {
+                for (int channel = 0; channel < num_channels; ++channel)
+                {
+                    if (!in[channel] || !out[channel])
+                        continue;
+
+                    const SampleType* src = in[channel] + segment.offset;
+                    SampleType* dst       = out[channel] + segment.offset;
+                    if (segment.is_constant())
+                        kernel.apply_constant(src, dst, segment.length, segment.start, meter);
+                    else
+                        kernel.apply_ramp(src, dst, segment.length, segment.start,
+                                          segment.increment, segment.phase, meter);
+                }
+            }
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void apply_gain_curve_parallel(const gain_kernel<SampleType>& kernel,
+                               const gain_curve& curve,
+                               const SampleType* const* in,
+                               SampleType* const* out,
+                               int num_channels,
+                               level_meter* meter,
+                               worker_pool& pool)
+{
+    const int num_samples = curve.get_num_samples();
+    if (!pool.is_running() ||
+        static_cast<long long>(num_samples) * num_channels < kMinParallelSamples)
+    {
+        apply_gain_curve(kernel, curve, in, out, num_channels, meter);
+        return;
+    }
+
+    const int num_tasks  = std::min(kTasksPerThread * (pool.get_num_threads() + 1),
+                                    kMaxParallelTasks);
+    const int num_groups = std::min(num_channels, num_tasks);
+    const int max_chunks = std::max(std::min(num_tasks / num_groups,
+                                             num_samples / kMinChunkSamples),
+                                    1);
+
+    // Several KB, but offline processing runs on a host thread with a large stack.
+    parallel_job<SampleType> job;
+    job.kernel       = &kernel;
+    job.curve        = &curve;
+    job.in           = in;
+    job.out          = out;
+    job.num_channels = num_channels;
+    job.num_groups   = num_groups;
+    job.is_metered   = meter != nullptr;
+    job.plan(max_chunks);
+
+    pool.run(&parallel_job<SampleType>::run_task, &job, job.num_chunks * num_groups);
+
+    if (meter)
+    {
+        for (int task = 0; task < job.num_chunks * num_groups; ++task)
+            meter->add(job.meters[task]);
+    }
+}
+
+//------------------------------------------------------------------------
+template void apply_gain_curve<float>(const gain_kernel<float>&,
+                                      const gain_curve&,
+                                      const float* const*,
+                                      float* const*,
+                                      int,
+                                      level_meter*);
+template void apply_gain_curve<double>(const gain_kernel<double>&,
+                                       const gain_curve&,
+                                       const double* const*,
+                                       double* const*,
+                                       int,
+                                       level_meter*);
+template void apply_gain_curve_parallel<float>(const gain_kernel<float>&,
+                                               const gain_curve&,
+                                               const float* const*,
+                                               float* const*,
+                                               int,
+                                               level_meter*,
+                                               worker_pool&);
+template void apply_gain_curve_parallel<double>(const gain_kernel<double>&,
+                                                const gain_curve&,
+                                                const double* const*,
+                                                double* const*,
+                                                int,
+                                                level_meter*,
+                                                worker_pool&);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
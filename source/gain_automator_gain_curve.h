@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_gain_law.h"
+#include "gain_automator_kernel.h"
+#include "gain_automator_segments.h"
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+class worker_pool;
+
+//------------------------------------------------------------------------
+// gain_curve
+//
+// The linear gain of one block in the cheapest form that represents it:
+//
+// - constant: one gain for the whole block
+// - segments: constant and linear ramp segments (linear gain law only)
+// - samples:  one gain per sample, for non-linear laws during ramps and
+//             for densely automated blocks
+//
+// build() is called once per block and the result is shared by all
+// buses and channels.
+//------------------------------------------------------------------------
+class gain_curve
+{
+public:
+    enum class shape
+    {
+        constant,
+        segments,
+        samples
+    };
+
+    // Allocates the per sample buffer. Not real-time safe.
+    void reserve(int max_samples_per_block);
+
+    // 'normalized' holds the parameter values of the block, which are
+    // mapped through 'law'. 'normalized' must outlive the curve's use.
+    void build(const gain_segments& normalized, gain_law law, simd_level level);
+
+    // Builds a per sample curve from 'num_samples' normalized values, e.g.
+    // of the gain_smoother. 'num_samples' must not exceed the reserved size.
+    void build(const float* normalized, int num_samples, gain_law law, simd_level level);
+
+    // A constant linear 'gain' for the block, no law applied.
+    void build_constant(float gain, int num_samples);
+
+    // Blends the built curve towards unity gain: g + (1 - g) * mix. With
+    // mix 1 the input passes unchanged, which makes this a crossfade
+    // between the processed and the dry signal without a second pass.
+    // The per sample version turns the curve into per sample gains.
+    void mix_to_unity(const float* mix);
+    void mix_to_unity(float mix);
+
+    // Multiplies the built curve by per sample 'gains' or by one 'gain',
+    // e.g. the curve of a gain group's leader.
+    void multiply(const float* gains);
+    void multiply(float gain);
+
+    shape get_shape() const { return curve_shape; }
+    bool is_constant() const { return curve_shape == shape::constant; }
+    float get_constant() const { return constant; }
+    const gain_segments& get_segments() const { return *segments; }
+    const float* get_samples() const { return samples.data(); }
+    int get_num_samples() const { return num_samples; }
+
+    // The gain of the block's last sample.
+    float get_last_gain() const;
+
+    // Writes the gain of every sample to 'gains', exactly as the kernels
+    // apply it, whatever the shape.
+    void render(float* gains) const;
+
+private:
+    void render_samples();
+
+    shape curve_shape             = shape::constant;
+    float constant                = 1.f;
+    const gain_segments* segments = nullptr;
+    std::vector<float> samples;
+    int num_samples = 0;
+};
+
+//------------------------------------------------------------------------
+// Applies 'curve' to all channels. The curve is walked once, each segment
+// is applied to every channel while its parameters are at hand. Null
+// channel pointers are skipped. 'in' and 'out' may be the same buffers.
+// The levels of all channels are accumulated into 'meter', if not null.
+template <typename SampleType>
+void apply_gain_curve(const gain_kernel<SampleType>& kernel,
+                      const gain_curve& curve,
+                      const SampleType* const* in,
+                      SampleType* const* out,
+                      int num_channels,
+                      level_meter* meter);
+
+//------------------------------------------------------------------------
+// Like apply_gain_curve(), split into tasks over channels and time which
+// run on 'pool'. Time chunks only end at segment boundaries, a ramp is
+// never split, so the output is bit identical to apply_gain_curve(). Each
+// task meters on its own, the levels are summed into 'meter' afterwards.
+// Small blocks are processed on the calling thread.
+template <typename SampleType>
+void apply_gain_curve_parallel(const gain_kernel<SampleType>& kernel,
+                               const gain_curve& curve,
+                               const SampleType* const* in,
+                               SampleType* const* out,
+                               int num_channels,
+                               level_meter* meter,
+                               worker_pool& pool);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_gain_format.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Below this the display has one decimal, from here on two.
+constexpr int kFineThreshold = -10;
+
+// Table entries of the coarse (-150.0..-10.0) and fine (-10.00..0.00) part
+constexpr int kMinDisplay = static_cast<int>(kMinDisplayDecibel);
+constexpr int kNumCoarse  = (kFineThreshold - kMinDisplay) * 10 + 1;
+constexpr int kNumFine    = (static_cast<int>(kMaxDecibel) - kFineThreshold) * 100 + 1;
+
+constexpr double kSilence = -std::numeric_limits<double>::infinity();
+
+using entry = std::array<char16_t, kMaxDecibelStringSize>;
+
+//------------------------------------------------------------------------
+// Writes 'units' (a fixed point value in 1 / 10^decimals dB) as text.
+entry make_entry(int units, int decimals)
+{
+    entry text{};
+    char digits[kMaxDecibelStringSize] = {};
+    int num_digits                     = 0;
+
+    int value = units < 0 ? -units : units;
+    for (int i = 0; i < decimals || value > 0 || num_digits <= decimals; ++i)
+    {
+        digits[num_digits++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+
+    int length = 0;
+    if (units < 0)
+        text[length++] = u'-';
+
+    for (int i = num_digits - 1; i >= 0; --i)
+    {
+        text[length++] = static_cast<char16_t>(digits[i]);
+        if (i == decimals && decimals > 0)
+            text[length++] = u'.';
+    }
+    return text;
+}
+
+//------------------------------------------------------------------------
+struct string_table
+{
+    std::array<entry, kNumCoarse> coarse;
+    std::array<entry, kNumFine> fine;
+    entry silence{u'-', u'i', u'n', u'f'};
+
+    string_table()
+    {
+        const int coarse_offset = kMinDisplay * 10;
+        for (int i = 0; i < kNumCoarse; ++i)
+            coarse[i] = make_entry(coarse_offset + i, 1);
+
+        const int fine_offset = kFineThreshold * 100;
+        for (int i = 0; i < kNumFine; ++i)
+            fine[i] = make_entry(fine_offset + i, 2);
+    }
+};
+
+//------------------------------------------------------------------------
+const string_table& get_string_table()
+{
+    static const string_table table;
+    return table;
+}
+
+//------------------------------------------------------------------------
+bool is_digit(char16_t c)
+{
+    return c >= u'0' && c <= u'9';
+}
+
+//------------------------------------------------------------------------
+bool is_space(char16_t c)
+{
+    return c == u' ' || c == u'\t';
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+double decibel_to_normalized(double dB)
+{
+    const double normalized = (dB - kMinDecibel) / (kMaxDecibel - kMinDecibel);
+    return std::min(std::max(normalized, 0.), 1.);
+}
+
+//------------------------------------------------------------------------
+double normalized_to_decibel(double normalized)
+{
+    const double value = std::min(std::max(normalized, 0.), 1.);
+    return kMinDecibel + value * (kMaxDecibel - kMinDecibel);
+}
+
+//------------------------------------------------------------------------
+double normalized_to_decibel(gain_law law, double normalized)
+{
+    const double value = std::min(std::max(normalized, 0.), 1.);
+    if (value == 0.)
+        return kSilence;
+
+    switch (law)
+    {
+        case gain_law::linear: return 20. * std::log10(value);
+        case gain_law::equal_power: return 10. * std::log10(value);
+        default: return normalized_to_decibel(value);
+    }
+}
+
+//------------------------------------------------------------------------
+double decibel_to_normalized(gain_law law, double dB)
+{
+    double normalized = 0.;
+    switch (law)
+    {
+        case gain_law::linear: normalized = std::pow(10., dB / 20.); break;
+        case gain_law::equal_power: normalized = std::pow(10., dB / 10.); break;
+        default: normalized = decibel_to_normalized(dB); break;
+    }
+    return std::min(std::max(normalized, 0.), 1.);
+}
+
+//------------------------------------------------------------------------
+const char16_t* to_decibel_string(gain_law law, double normalized)
+{
+    const string_table& table = get_string_table();
+    const double dB           = normalized_to_decibel(law, normalized);
+    if (dB < kMinDisplayDecibel - 0.05)
+        return table.silence.data();
+
+    if (dB < kFineThreshold)
+    {
+        const long index = std::lround((dB - kMinDisplayDecibel) * 10.);
+        return table.coarse[std::min(std::max(index, 0l), long(kNumCoarse - 1))].data();
+    }
+
+    const long index = std::lround((dB - kFineThreshold) * 100.);
+    return table.fine[std::min(std::max(index, 0l), long(kNumFine - 1))].data();
+}
+
+//------------------------------------------------------------------------
+bool from_decibel_string(gain_law law, const char16_t* string, double& normalized)
+{
+    if (!string)
+        return false;
+
+    const char16_t* c = string;
+    while (is_space(*c))
+        ++c;
+
+    bool is_negative = false;
+    if (*c == u'-' || *c == u'+')
+        is_negative = *c++ == u'-';
+
+    // "-inf", "-oo" or the infinity sign
+    if (*c == u'i' || *c == u'I' || *c == u'o' || *c == u'\u221E')
+    {
+        normalized = is_negative ? 0. : 1.;
+        return true;
+    }
+
+    // Fixed point parsing, no locale and no allocation. Both '.' and ',' separate decimals.
+    double value     = 0.;
+    double scale     = 1.;
+    bool has_digits  = false;
+    bool is_fraction = false;
+    for (;; ++c)
+    {
+        if (is_digit(*c))
+        {
+            value = value * 10. + (*c - u'0');
+            if (is_fraction)
+                scale *= 10.;
+            has_digits = true;
+        }
+        else if ((*c == u'.' || *c == u',') && !is_fraction)
+        {
+            is_fraction = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (!has_digits)
+        return false;
+
+    const double dB = (is_negative ? -value : value) / scale;
+    normalized      = decibel_to_normalized(law, dB);
+    return true;
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,49 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_gain_law.h"
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Display strings of the gain parameter, without allocations.
+//
+// The parameter is shown as the level of the gain its law maps it to.
+// Levels below -10 dB are shown with one decimal, above with two, down to
+// kMinDisplayDecibel, below which (and for silence) "-inf" is shown. That
+// makes 2403 distinct strings, all precomputed as UTF-16 on first use, so
+// formatting is a level, a quantization and a table lookup.
+//------------------------------------------------------------------------
+
+// Longest display string including the terminating zero, e.g. "-150.0".
+static constexpr int kMaxDecibelStringSize = 8;
+static constexpr double kMinDisplayDecibel = -150.;
+
+// Null terminated display string of 'normalized' (clamped to [0, 1])
+// under 'law', e.g. u"-12.3". The pointer stays valid for the lifetime of
+// the module.
+const char16_t* to_decibel_string(gain_law law, double normalized);
+
+// Parses strings like "-12.3", "-12.3 dB", "+0,5" or "-inf" into the
+// value 'law' maps to that level. Values out of range are clamped.
+// Returns false if 'string' holds no number.
+bool from_decibel_string(gain_law law, const char16_t* string, double& normalized);
+
+// Level in dB of the gain 'law' maps 'normalized' to, exact and in double
+// precision: 20 * log10(to_gain(law, normalized)), -infinity for silence.
+double normalized_to_decibel(gain_law law, double normalized);
+// The inverse, clamped. Levels at or below the law's silence give 0.
+double decibel_to_normalized(gain_law law, double dB);
+
+// Linear mapping of kMinDecibel..kMaxDecibel, clamped: the decibel law
+// without its silence at 0, as used by the meters.
+double decibel_to_normalized(double dB);
+double normalized_to_decibel(double normalized);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
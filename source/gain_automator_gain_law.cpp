@@ -0,0 +1,330 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_gain_law.h"
+#include "gain_automator_simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Minimax coefficients of 2^f - 1 = f * (c1 + f * (c2 + ...)) on [0, 1)
+constexpr float kExp2C1 = 0.693151291165968f;
+constexpr float kExp2C2 = 0.2401645398315491f;
+constexpr float kExp2C3 = 0.05579984498106853f;
+constexpr float kExp2C4 = 0.009016946730355642f;
+constexpr float kExp2C5 = 0.0018672138128564759f;
+
+// normalized -> log2(gain) for the decibel law
+constexpr double kLog2Of10Over20 = 0.16609640474436813;
+constexpr float kDecibelScale    = float((kMaxDecibel - kMinDecibel) * kLog2Of10Over20);
+constexpr float kDecibelOffset   = float(kMinDecibel * kLog2Of10Over20);
+
+//------------------------------------------------------------------------
+float clamp_normalized(float value)
+{
+    return std::min(std::max(value, 0.f), 1.f);
+}
+
+//------------------------------------------------------------------------
+float decibel_to_gain(float normalized)
+{
+    const float value = clamp_normalized(normalized);
+    const float gain  = fast_exp2(value * kDecibelScale + kDecibelOffset);
+    return value > 0.f ? gain : 0.f;
+}
+
+//------------------------------------------------------------------------
+float equal_power_to_gain(float normalized)
+{
+    return std::sqrt(clamp_normalized(normalized));
+}
+
+//------------------------------------------------------------------------
+void apply_decibel_scalar(float* values, int num_values)
+{
+    for (int i = 0; i < num_values; ++i)
+        values[i] = decibel_to_gain(values[i]);
+}
+
+//------------------------------------------------------------------------
+void apply_equal_power_scalar(float* values, int num_values)
+{
+    for (int i = 0; i < num_values; ++i)
+        values[i] = equal_power_to_gain(values[i]);
+}
+
+#if HA_ARCH_X86
+//------------------------------------------------------------------------
+// SSE2
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 __m128 fast_exp2_sse2(__m128 x)
+{
+    // floor() by truncation, corrected for negative non-integers
+    __m128 fl = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    fl        = _mm_sub_ps(fl, _mm_and_ps(_mm_cmpgt_ps(fl, x), _mm_set1_ps(1.f)));
+    const __m128 f = _mm_sub_ps(x, fl);
+
+    __m128 p = _mm_set1_ps(kExp2C5);
+    p        = _mm_add_ps(_mm_set1_ps(kExp2C4), _mm_mul_ps(f, p));
+    p        = _mm_add_ps(_mm_set1_ps(kExp2C3), _mm_mul_ps(f, p));
+    p        = _mm_add_ps(_mm_set1_ps(kExp2C2), _mm_mul_ps(f, p));
+    p        = _mm_add_ps(_mm_set1_ps(kExp2C1), _mm_mul_ps(f, p));
+    p        = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(f, p));
+
+    const __m128i exponent = _mm_slli_epi32(_mm_cvttps_epi32(fl), 23);
+    return _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(p), exponent));
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 void apply_decibel_sse2(float* values, int num_values)
+{
+    const __m128 zero   = _mm_setzero_ps();
+    const __m128 one    = _mm_set1_ps(1.f);
+    const __m128 scale  = _mm_set1_ps(kDecibelScale);
+    const __m128 offset = _mm_set1_ps(kDecibelOffset);
+
+    int i = 0;
+    for (; i + 4 <= num_values; i += 4)
+    {
+        const __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), zero), one);
+        const __m128 gain  = fast_exp2_sse2(_mm_add_ps(_mm_mul_ps(value, scale), offset));
+        _mm_storeu_ps(values + i, _mm_and_ps(gain, _mm_cmpgt_ps(value, zero)));
+    }
+
+    apply_decibel_scalar(values + i, num_values - i);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 void apply_equal_power_sse2(float* values, int num_values)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.f);
+
+    int i = 0;
+    for (; i + 4 <= num_values; i += 4)
+    {
+        const __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), zero), one);
+        _mm_storeu_ps(values + i, _mm_sqrt_ps(value));
+    }
+
+    apply_equal_power_scalar(values + i, num_values - i);
+}
+
+//------------------------------------------------------------------------
+// AVX2
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 __m256 fast_exp2_avx2(__m256 x)
+{
+    const __m256 fl = _mm256_floor_ps(x);
+    const __m256 f  = _mm256_sub_ps(x, fl);
+
+    __m256 p = _mm256_set1_ps(kExp2C5);
+    p        = _mm256_add_ps(_mm256_set1_ps(kExp2C4), _mm256_mul_ps(f, p));
+    p        = _mm256_add_ps(_mm256_set1_ps(kExp2C3), _mm256_mul_ps(f, p));
+    p        = _mm256_add_ps(_mm256_set1_ps(kExp2C2), _mm256_mul_ps(f, p));
+    p        = _mm256_add_ps(_mm256_set1_ps(kExp2C1), _mm256_mul_ps(f, p));
+    p        = _mm256_add_ps(_mm256_set1_ps(1.f), _mm256_mul_ps(f, p));
+
+    const __m256i exponent = _mm256_slli_epi32(_mm256_cvttps_epi32(fl), 23);
+    return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), exponent));
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 void apply_decibel_avx2(float* values, int num_values)
+{
+    const __m256 zero   = _mm256_setzero_ps();
+    const __m256 one    = _mm256_set1_ps(1.f);
+    const __m256 scale  = _mm256_set1_ps(kDecibelScale);
+    const __m256 offset = _mm256_set1_ps(kDecibelOffset);
+
+    int i = 0;
+    for (; i + 8 <= num_values; i += 8)
+    {
+        const __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(values + i), zero), one);
+        const __m256 gain  = fast_exp2_avx2(_mm256_add_ps(_mm256_mul_ps(value, scale), offset));
+        _mm256_storeu_ps(values + i,
+                         _mm256_and_ps(gain, _mm256_cmp_ps(value, zero, _CMP_GT_OQ)));
+    }
+
+    apply_decibel_scalar(values + i, num_values - i);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 void apply_equal_power_avx2(float* values, int num_values)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one  = _mm256_set1_ps(1.f);
+
+    int i = 0;
+    for (; i + 8 <= num_values; i += 8)
+    {
+        const __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(values + i), zero), one);
+        _mm256_storeu_ps(values + i, _mm256_sqrt_ps(value));
+    }
+
+    apply_equal_power_scalar(values + i, num_values - i);
+}
+#endif // HA_ARCH_X86
+
+#if HA_ARCH_NEON
+//------------------------------------------------------------------------
+// NEON
+//------------------------------------------------------------------------
+float32x4_t fast_exp2_neon(float32x4_t x)
+{
+    // floor() by truncation, corrected for negative non-integers
+    float32x4_t fl = vcvtq_f32_s32(vcvtq_s32_f32(x));
+    fl             = vsubq_f32(fl, vreinterpretq_f32_u32(vandq_u32(
+                           vcgtq_f32(fl, x), vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+    const float32x4_t f = vsubq_f32(x, fl);
+
+    float32x4_t p = vdupq_n_f32(kExp2C5);
+    p             = vaddq_f32(vdupq_n_f32(kExp2C4), vmulq_f32(f, p));
+    p             = vaddq_f32(vdupq_n_f32(kExp2C3), vmulq_f32(f, p));
+    p             = vaddq_f32(vdupq_n_f32(kExp2C2), vmulq_f32(f, p));
+    p             = vaddq_f32(vdupq_n_f32(kExp2C1), vmulq_f32(f, p));
+    p             = vaddq_f32(vdupq_n_f32(1.f), vmulq_f32(f, p));
+
+    const int32x4_t exponent = vshlq_n_s32(vcvtq_s32_f32(fl), 23);
+    return vreinterpretq_f32_s32(vaddq_s32(vreinterpretq_s32_f32(p), exponent));
+}
+
+//------------------------------------------------------------------------
+void apply_decibel_neon(float* values, int num_values)
+{
+    const float32x4_t zero   = vdupq_n_f32(0.f);
+    const float32x4_t one    = vdupq_n_f32(1.f);
+    const float32x4_t scale  = vdupq_n_f32(kDecibelScale);
+    const float32x4_t offset = vdupq_n_f32(kDecibelOffset);
+
+    int i = 0;
+    for (; i + 4 <= num_values; i += 4)
+    {
+        const float32x4_t value = vminq_f32(vmaxq_f32(vld1q_f32(values + i), zero), one);
+        const float32x4_t gain  = fast_exp2_neon(vaddq_f32(vmulq_f32(value, scale), offset));
+        const uint32x4_t audible = vcgtq_f32(value, zero);
+        vst1q_f32(values + i,
+                  vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(gain), audible)));
+    }
+
+    apply_decibel_scalar(values + i, num_values - i);
+}
+
+//------------------------------------------------------------------------
+void apply_equal_power_neon(float* values, int num_values)
+{
+#if HA_ARCH_NEON_F64
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    const float32x4_t one  = vdupq_n_f32(1.f);
+
+    int i = 0;
+    for (; i + 4 <= num_values; i += 4)
+    {
+        const float32x4_t value = vminq_f32(vmaxq_f32(vld1q_f32(values + i), zero), one);
+        vst1q_f32(values + i, vsqrtq_f32(value));
+    }
+
+    apply_equal_power_scalar(values + i, num_values - i);
+#else
+    // ARMv7 NEON has no exact square root.
+    apply_equal_power_scalar(values, num_values);
+#endif
+}
+#endif // HA_ARCH_NEON
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+gain_law to_gain_law(double normalized)
+{
+    const int count = static_cast<int>(gain_law::count);
+    const int index = static_cast<int>(normalized * (count - 1) + 0.5);
+    return static_cast<gain_law>(std::min(std::max(index, 0), count - 1));
+}
+
+//------------------------------------------------------------------------
+double to_normalized(gain_law law)
+{
+    const int count = static_cast<int>(gain_law::count);
+    return static_cast<double>(law) / (count - 1);
+}
+
+//------------------------------------------------------------------------
+float fast_exp2(float x)
+{
+    const float fl = std::floor(x);
+    const float f  = x - fl;
+
+    float p = kExp2C5;
+    p       = kExp2C4 + f * p;
+    p       = kExp2C3 + f * p;
+    p       = kExp2C2 + f * p;
+    p       = kExp2C1 + f * p;
+    p       = 1.f + f * p;
+
+    std::int32_t bits = 0;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += static_cast<std::int32_t>(fl) * (1 << 23);
+    std::memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+//------------------------------------------------------------------------
+float to_gain(gain_law law, float normalized)
+{
+    switch (law)
+    {
+        case gain_law::decibel: return decibel_to_gain(normalized);
+        case gain_law::equal_power: return equal_power_to_gain(normalized);
+        default: return normalized;
+    }
+}
+
+//------------------------------------------------------------------------
+void apply_gain_law(simd_level level, gain_law law, float* values, int num_values)
+{
+    using func = void (*)(float*, int);
+
+    func decibel     = apply_decibel_scalar;
+    func equal_power = apply_equal_power_scalar;
+    switch (level)
+    {
+#if HA_ARCH_X86
+        case simd_level::avx2:
+            decibel     = apply_decibel_avx2;
+            equal_power = apply_equal_power_avx2;
+            break;
+        case simd_level::sse2:
+            decibel     = apply_decibel_sse2;
+            equal_power = apply_equal_power_sse2;
+            break;
+#endif
+#if HA_ARCH_NEON
+        case simd_level::neon:
+            decibel     = apply_decibel_neon;
+            equal_power = apply_equal_power_neon;
+            break;
+#endif
+        default: break;
+    }
+
+    switch (law)
+    {
+        case gain_law::decibel: decibel(values, num_values); break;
+        case gain_law::equal_power: equal_power(values, num_values); break;
+        default: break;
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_kernel.h"
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Range of the gain parameter in dB, shared by the controller's display
+// and the decibel gain law.
+static constexpr float kMinDecibel = -96.f;
+static constexpr float kMaxDecibel = 0.f;
+
+//------------------------------------------------------------------------
+// gain_law
+//
+// Maps the normalized gain parameter [0, 1] to a linear gain factor.
+// The order matches the entries of the 'Gain Law' list parameter.
+//------------------------------------------------------------------------
+enum class gain_law
+{
+    linear,      // gain = normalized
+    decibel,     // kMinDecibel..kMaxDecibel mapped linearly, 0 is silence
+    equal_power, // gain = sqrt(normalized), power is linear in the parameter
+    count
+};
+
+//------------------------------------------------------------------------
+gain_law to_gain_law(double normalized);
+double to_normalized(gain_law law);
+
+// Fast 2^x for x in [-126, 0]. A degree 5 minimax polynomial of 2^f on
+// [0, 1) is scaled by 2^floor(x) through the exponent bits. The maximum
+// relative error is 1.6e-7 (about 1.4e-6 dB), measured exhaustively
+// against double precision exp2 over one octave.
+float fast_exp2(float x);
+
+// Scalar mapping of one normalized value.
+float to_gain(gain_law law, float normalized);
+
+// Maps 'num_values' normalized values to gains in place. Vectorized for
+// 'level'; the results are bit identical to to_gain() for each value.
+// Including the rounding of the dB to exponent scaling, the decibel law
+// stays within 1e-6 relative (< 1e-5 dB) of std::pow(10, dB / 20).
+void apply_gain_law(simd_level level, gain_law law, float* values, int num_values);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,1248 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_kernel.h"
+#include "gain_automator_simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Levels
+//
+// Each instruction set keeps per lane accumulators in registers during
+// the loop and reduces them into the level_meter once per call.
+//------------------------------------------------------------------------
+template <typename T>
+void accumulate_lanes(level_meter& meter,
+                      const T* input_peak,
+                      const T* output_peak,
+                      const T* input_energy,
+                      const T* output_energy,
+                      int num_lanes,
+                      int num_samples)
+{
+    for (int lane = 0; lane < num_lanes; ++lane)
+    {
+        meter.input_peak  = std::max(meter.input_peak, static_cast<float>(input_peak[lane]));
+        meter.output_peak = std::max(meter.output_peak, static_cast<float>(output_peak[lane]));
+        meter.input_energy += input_energy[lane];
+        meter.output_energy += output_energy[lane];
+    }
+    meter.num_samples += num_samples;
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+struct levels_scalar
+{
+    T input_peak    = 0;
+    T output_peak   = 0;
+    T input_energy  = 0;
+    T output_energy = 0;
+
+    void add(T x, T y)
+    {
+        input_peak  = std::max(input_peak, std::abs(x));
+        output_peak = std::max(output_peak, std::abs(y));
+        input_energy += x * x;
+        output_energy += y * y;
+    }
+
+    void store(level_meter& meter, int num_samples) const
+    {
+        accumulate_lanes(meter, &input_peak, &output_peak, &input_energy, &output_energy, 1,
+                         num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+// Scalar
+//------------------------------------------------------------------------
+template <bool Metered, typename T>
+void constant_scalar(const T* in, T* out, int num_samples, float gain, level_meter* meter)
+{
+    const auto g = static_cast<T>(gain);
+    levels_scalar<T> levels;
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const T x = in[i];
+        out[i]    = x * g;
+        if (Metered)
+            levels.add(x, out[i]);
+    }
+    if (Metered)
+        levels.store(*meter, num_samples);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered, typename T>
+void ramp_tail(const T* in,
+               T* out,
+               int i,
+               int num_samples,
+               float start,
+               float increment,
+               int phase,
+               level_meter* meter)
+{
+    levels_scalar<T> levels;
+    const int first = i;
+    for (; i < num_samples; ++i)
+    {
+        const T x = in[i];
+        out[i]    = x * static_cast<T>(start + increment * static_cast<float>(phase + i));
+        if (Metered)
+            levels.add(x, out[i]);
+    }
+    if (Metered)
+        levels.store(*meter, num_samples - first);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered, typename T>
+void ramp_scalar(const T* in,
+                 T* out,
+                 int num_samples,
+                 float start,
+                 float increment,
+                 int phase,
+                 level_meter* meter)
+{
+    ramp_tail<Metered>(in, out, 0, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered, typename T>
+void curve_scalar(const T* in, T* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_scalar<T> levels;
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const T x = in[i];
+        out[i]    = x * static_cast<T>(gains[i]);
+        if (Metered)
+            levels.add(x, out[i]);
+    }
+    if (Metered)
+        levels.store(*meter, num_samples);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void measure_tail(const T* in, int num_samples, float gain, level_meter& meter)
+{
+    const auto g = static_cast<T>(gain);
+    levels_scalar<T> levels;
+    for (int i = 0; i < num_samples; ++i)
+        levels.add(in[i], in[i] * g);
+    levels.store(meter, num_samples);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void measure_scalar(const T* in, int num_samples, float gain, level_meter& meter)
+{
+    measure_tail(in, num_samples, gain, meter);
+}
+
+//------------------------------------------------------------------------
+// Entry points of the kernel tables, the decision for or against metering
+// is taken once per call.
+//------------------------------------------------------------------------
+template <typename T>
+void apply_constant_scalar(const T* in, T* out, int num_samples, float gain, level_meter* meter)
+{
+    if (meter)
+        constant_scalar<true>(in, out, num_samples, gain, meter);
+    else
+        constant_scalar<false>(in, out, num_samples, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_ramp_scalar(const T* in,
+                       T* out,
+                       int num_samples,
+                       float start,
+                       float increment,
+                       int phase,
+                       level_meter* meter)
+{
+    if (meter)
+        ramp_scalar<true>(in, out, num_samples, start, increment, phase, meter);
+    else
+        ramp_scalar<false>(in, out, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_curve_scalar(const T* in, T* out, int num_samples, const float* gains, level_meter* meter)
+{
+    if (meter)
+        curve_scalar<true>(in, out, num_samples, gains, meter);
+    else
+        curve_scalar<false>(in, out, num_samples, gains, meter);
+}
+
+#if HA_ARCH_X86
+//------------------------------------------------------------------------
+// SSE2
+//------------------------------------------------------------------------
+struct levels_sse2_ps
+{
+    __m128 input_peak;
+    __m128 output_peak;
+    __m128 input_energy;
+    __m128 output_energy;
+
+    HA_TARGET_SSE2 levels_sse2_ps()
+    : input_peak(_mm_setzero_ps())
+    , output_peak(_mm_setzero_ps())
+    , input_energy(_mm_setzero_ps())
+    , output_energy(_mm_setzero_ps())
+    {
+    }
+
+    HA_TARGET_SSE2 void add(__m128 x, __m128 y)
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+        input_peak        = _mm_max_ps(input_peak, _mm_andnot_ps(sign, x));
+        output_peak       = _mm_max_ps(output_peak, _mm_andnot_ps(sign, y));
+        input_energy      = _mm_add_ps(input_energy, _mm_mul_ps(x, x));
+        output_energy     = _mm_add_ps(output_energy, _mm_mul_ps(y, y));
+    }
+
+    HA_TARGET_SSE2 void store(level_meter& meter, int num_samples) const
+    {
+        float lanes[4][4];
+        _mm_storeu_ps(lanes[0], input_peak);
+        _mm_storeu_ps(lanes[1], output_peak);
+        _mm_storeu_ps(lanes[2], input_energy);
+        _mm_storeu_ps(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 4, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+struct levels_sse2_pd
+{
+    __m128d input_peak;
+    __m128d output_peak;
+    __m128d input_energy;
+    __m128d output_energy;
+
+    HA_TARGET_SSE2 levels_sse2_pd()
+    : input_peak(_mm_setzero_pd())
+    , output_peak(_mm_setzero_pd())
+    , input_energy(_mm_setzero_pd())
+    , output_energy(_mm_setzero_pd())
+    {
+    }
+
+    HA_TARGET_SSE2 void add(__m128d x, __m128d y)
+    {
+        const __m128d sign = _mm_set1_pd(-0.);
+        input_peak         = _mm_max_pd(input_peak, _mm_andnot_pd(sign, x));
+        output_peak        = _mm_max_pd(output_peak, _mm_andnot_pd(sign, y));
+        input_energy       = _mm_add_pd(input_energy, _mm_mul_pd(x, x));
+        output_energy      = _mm_add_pd(output_energy, _mm_mul_pd(y, y));
+    }
+
+    HA_TARGET_SSE2 void store(level_meter& meter, int num_samples) const
+    {
+        double lanes[4][2];
+        _mm_storeu_pd(lanes[0], input_peak);
+        _mm_storeu_pd(lanes[1], output_peak);
+        _mm_storeu_pd(lanes[2], input_energy);
+        _mm_storeu_pd(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 2, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void
+constant_sse2(const float* in, float* out, int num_samples, float gain, level_meter* meter)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    levels_sse2_ps levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(in + i);
+        const __m128 y = _mm_mul_ps(x, g);
+        _mm_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void
+constant_sse2(const double* in, double* out, int num_samples, float gain, level_meter* meter)
+{
+    const __m128d g = _mm_set1_pd(gain);
+    levels_sse2_pd levels;
+
+    int i = 0;
+    for (; i + 2 <= num_samples; i += 2)
+    {
+        const __m128d x = _mm_loadu_pd(in + i);
+        const __m128d y = _mm_mul_pd(x, g);
+        _mm_storeu_pd(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void ramp_sse2(const float* in,
+                              float* out,
+                              int num_samples,
+                              float start,
+                              float increment,
+                              int phase,
+                              level_meter* meter)
+{
+    const __m128 s    = _mm_set1_ps(start);
+    const __m128 inc  = _mm_set1_ps(increment);
+    const __m128 step = _mm_set1_ps(4.f);
+    __m128 index      = _mm_add_ps(_mm_set1_ps(static_cast<float>(phase)),
+                                   _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    levels_sse2_ps levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 g = _mm_add_ps(s, _mm_mul_ps(inc, index));
+        const __m128 x = _mm_loadu_ps(in + i);
+        const __m128 y = _mm_mul_ps(x, g);
+        _mm_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+        index = _mm_add_ps(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void ramp_sse2(const double* in,
+                              double* out,
+                              int num_samples,
+                              float start,
+                              float increment,
+                              int phase,
+                              level_meter* meter)
+{
+    const __m128 s    = _mm_set1_ps(start);
+    const __m128 inc  = _mm_set1_ps(increment);
+    const __m128 step = _mm_set1_ps(4.f);
+    __m128 index      = _mm_add_ps(_mm_set1_ps(static_cast<float>(phase)),
+                                   _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    levels_sse2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 g    = _mm_add_ps(s, _mm_mul_ps(inc, index));
+        const __m128d x01 = _mm_loadu_pd(in + i);
+        const __m128d x23 = _mm_loadu_pd(in + i + 2);
+        const __m128d y01 = _mm_mul_pd(x01, _mm_cvtps_pd(g));
+        const __m128d y23 = _mm_mul_pd(x23, _mm_cvtps_pd(_mm_movehl_ps(g, g)));
+        _mm_storeu_pd(out + i, y01);
+        _mm_storeu_pd(out + i + 2, y23);
+        if (Metered)
+        {
+            levels.add(x01, y01);
+            levels.add(x23, y23);
+        }
+        index = _mm_add_ps(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void
+curve_sse2(const float* in, float* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_sse2_ps levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(in + i);
+        const __m128 y = _mm_mul_ps(x, _mm_loadu_ps(gains + i));
+        _mm_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_SSE2 void
+curve_sse2(const double* in, double* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_sse2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 g    = _mm_loadu_ps(gains + i);
+        const __m128d x01 = _mm_loadu_pd(in + i);
+        const __m128d x23 = _mm_loadu_pd(in + i + 2);
+        const __m128d y01 = _mm_mul_pd(x01, _mm_cvtps_pd(g));
+        const __m128d y23 = _mm_mul_pd(x23, _mm_cvtps_pd(_mm_movehl_ps(g, g)));
+        _mm_storeu_pd(out + i, y01);
+        _mm_storeu_pd(out + i + 2, y23);
+        if (Metered)
+        {
+            levels.add(x01, y01);
+            levels.add(x23, y23);
+        }
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 void measure_sse2(const float* in, int num_samples, float gain, level_meter& meter)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    levels_sse2_ps levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(in + i);
+        levels.add(x, _mm_mul_ps(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 void measure_sse2(const double* in, int num_samples, float gain, level_meter& meter)
+{
+    const __m128d g = _mm_set1_pd(gain);
+    levels_sse2_pd levels;
+
+    int i = 0;
+    for (; i + 2 <= num_samples; i += 2)
+    {
+        const __m128d x = _mm_loadu_pd(in + i);
+        levels.add(x, _mm_mul_pd(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_constant_sse2(const T* in, T* out, int num_samples, float gain, level_meter* meter)
+{
+    if (meter)
+        constant_sse2<true>(in, out, num_samples, gain, meter);
+    else
+        constant_sse2<false>(in, out, num_samples, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_ramp_sse2(const T* in,
+                     T* out,
+                     int num_samples,
+                     float start,
+                     float increment,
+                     int phase,
+                     level_meter* meter)
+{
+    if (meter)
+        ramp_sse2<true>(in, out, num_samples, start, increment, phase, meter);
+    else
+        ramp_sse2<false>(in, out, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_curve_sse2(const T* in, T* out, int num_samples, const float* gains, level_meter* meter)
+{
+    if (meter)
+        curve_sse2<true>(in, out, num_samples, gains, meter);
+    else
+        curve_sse2<false>(in, out, num_samples, gains, meter);
+}
+
+//------------------------------------------------------------------------
+// AVX2
+//------------------------------------------------------------------------
+struct levels_avx2_ps
+{
+    __m256 input_peak;
+    __m256 output_peak;
+    __m256 input_energy;
+    __m256 output_energy;
+
+    HA_TARGET_AVX2 levels_avx2_ps()
+    : input_peak(_mm256_setzero_ps())
+    , output_peak(_mm256_setzero_ps())
+    , input_energy(_mm256_setzero_ps())
+    , output_energy(_mm256_setzero_ps())
+    {
+    }
+
+    HA_TARGET_AVX2 void add(__m256 x, __m256 y)
+    {
+        const __m256 sign = _mm256_set1_ps(-0.f);
+        input_peak        = _mm256_max_ps(input_peak, _mm256_andnot_ps(sign, x));
+        output_peak       = _mm256_max_ps(output_peak, _mm256_andnot_ps(sign, y));
+        input_energy      = _mm256_add_ps(input_energy, _mm256_mul_ps(x, x));
+        output_energy     = _mm256_add_ps(output_energy, _mm256_mul_ps(y, y));
+    }
+
+    HA_TARGET_AVX2 void store(level_meter& meter, int num_samples) const
+    {
+        float lanes[4][8];
+        _mm256_storeu_ps(lanes[0], input_peak);
+        _mm256_storeu_ps(lanes[1], output_peak);
+        _mm256_storeu_ps(lanes[2], input_energy);
+        _mm256_storeu_ps(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 8, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+struct levels_avx2_pd
+{
+    __m256d input_peak;
+    __m256d output_peak;
+    __m256d input_energy;
+    __m256d output_energy;
+
+    HA_TARGET_AVX2 levels_avx2_pd()
+    : input_peak(_mm256_setzero_pd())
+    , output_peak(_mm256_setzero_pd())
+    , input_energy(_mm256_setzero_pd())
+    , output_energy(_mm256_setzero_pd())
+    {
+    }
+
+    HA_TARGET_AVX2 void add(__m256d x, __m256d y)
+    {
+        const __m256d sign = _mm256_set1_pd(-0.);
+        input_peak         = _mm256_max_pd(input_peak, _mm256_andnot_pd(sign, x));
+        output_peak        = _mm256_max_pd(output_peak, _mm256_andnot_pd(sign, y));
+        input_energy       = _mm256_add_pd(input_energy, _mm256_mul_pd(x, x));
+        output_energy      = _mm256_add_pd(output_energy, _mm256_mul_pd(y, y));
+    }
+
+    HA_TARGET_AVX2 void store(level_meter& meter, int num_samples) const
+    {
+        double lanes[4][4];
+        _mm256_storeu_pd(lanes[0], input_peak);
+        _mm256_storeu_pd(lanes[1], output_peak);
+        _mm256_storeu_pd(lanes[2], input_energy);
+        _mm256_storeu_pd(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 4, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void
+constant_avx2(const float* in, float* out, int num_samples, float gain, level_meter* meter)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    levels_avx2_ps levels;
+
+    int i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(in + i);
+        const __m256 y = _mm256_mul_ps(x, g);
+        _mm256_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void
+constant_avx2(const double* in, double* out, int num_samples, float gain, level_meter* meter)
+{
+    const __m256d g = _mm256_set1_pd(gain);
+    levels_avx2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        const __m256d y = _mm256_mul_pd(x, g);
+        _mm256_storeu_pd(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void ramp_avx2(const float* in,
+                              float* out,
+                              int num_samples,
+                              float start,
+                              float increment,
+                              int phase,
+                              level_meter* meter)
+{
+    const __m256 s    = _mm256_set1_ps(start);
+    const __m256 inc  = _mm256_set1_ps(increment);
+    const __m256 step = _mm256_set1_ps(8.f);
+    __m256 index      = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(phase)),
+                                      _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+    levels_avx2_ps levels;
+
+    int i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+    {
+        const __m256 g = _mm256_add_ps(s, _mm256_mul_ps(inc, index));
+        const __m256 x = _mm256_loadu_ps(in + i);
+        const __m256 y = _mm256_mul_ps(x, g);
+        _mm256_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+        index = _mm256_add_ps(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void ramp_avx2(const double* in,
+                              double* out,
+                              int num_samples,
+                              float start,
+                              float increment,
+                              int phase,
+                              level_meter* meter)
+{
+    const __m128 s    = _mm_set1_ps(start);
+    const __m128 inc  = _mm_set1_ps(increment);
+    const __m128 step = _mm_set1_ps(4.f);
+    __m128 index      = _mm_add_ps(_mm_set1_ps(static_cast<float>(phase)),
+                                   _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    levels_avx2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m256d g = _mm256_cvtps_pd(_mm_add_ps(s, _mm_mul_ps(inc, index)));
+        const __m256d x = _mm256_loadu_pd(in + i);
+        const __m256d y = _mm256_mul_pd(x, g);
+        _mm256_storeu_pd(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+        index = _mm_add_ps(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void
+curve_avx2(const float* in, float* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_avx2_ps levels;
+
+    int i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(in + i);
+        const __m256 y = _mm256_mul_ps(x, _mm256_loadu_ps(gains + i));
+        _mm256_storeu_ps(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+HA_TARGET_AVX2 void
+curve_avx2(const double* in, double* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_avx2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        const __m256d y = _mm256_mul_pd(x, _mm256_cvtps_pd(_mm_loadu_ps(gains + i)));
+        _mm256_storeu_pd(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 void measure_avx2(const float* in, int num_samples, float gain, level_meter& meter)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    levels_avx2_ps levels;
+
+    int i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(in + i);
+        levels.add(x, _mm256_mul_ps(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 void measure_avx2(const double* in, int num_samples, float gain, level_meter& meter)
+{
+    const __m256d g = _mm256_set1_pd(gain);
+    levels_avx2_pd levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        levels.add(x, _mm256_mul_pd(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_constant_avx2(const T* in, T* out, int num_samples, float gain, level_meter* meter)
+{
+    if (meter)
+        constant_avx2<true>(in, out, num_samples, gain, meter);
+    else
+        constant_avx2<false>(in, out, num_samples, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_ramp_avx2(const T* in,
+                     T* out,
+                     int num_samples,
+                     float start,
+                     float increment,
+                     int phase,
+                     level_meter* meter)
+{
+    if (meter)
+        ramp_avx2<true>(in, out, num_samples, start, increment, phase, meter);
+    else
+        ramp_avx2<false>(in, out, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_curve_avx2(const T* in, T* out, int num_samples, const float* gains, level_meter* meter)
+{
+    if (meter)
+        curve_avx2<true>(in, out, num_samples, gains, meter);
+    else
+        curve_avx2<false>(in, out, num_samples, gains, meter);
+}
+
+//------------------------------------------------------------------------
+bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    const bool os_xsave = (info[2] & (1 << 27)) != 0;
+    if (!os_xsave || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+//------------------------------------------------------------------------
+bool cpu_supports_sse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif // HA_ARCH_X86
+
+#if HA_ARCH_NEON
+//------------------------------------------------------------------------
+// NEON
+//------------------------------------------------------------------------
+struct levels_neon_f32
+{
+    float32x4_t input_peak    = vdupq_n_f32(0.f);
+    float32x4_t output_peak   = vdupq_n_f32(0.f);
+    float32x4_t input_energy  = vdupq_n_f32(0.f);
+    float32x4_t output_energy = vdupq_n_f32(0.f);
+
+    void add(float32x4_t x, float32x4_t y)
+    {
+        input_peak    = vmaxq_f32(input_peak, vabsq_f32(x));
+        output_peak   = vmaxq_f32(output_peak, vabsq_f32(y));
+        input_energy  = vaddq_f32(input_energy, vmulq_f32(x, x));
+        output_energy = vaddq_f32(output_energy, vmulq_f32(y, y));
+    }
+
+    void store(level_meter& meter, int num_samples) const
+    {
+        float lanes[4][4];
+        vst1q_f32(lanes[0], input_peak);
+        vst1q_f32(lanes[1], output_peak);
+        vst1q_f32(lanes[2], input_energy);
+        vst1q_f32(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 4, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void constant_neon(const float* in, float* out, int num_samples, float gain, level_meter* meter)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+    levels_neon_f32 levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(in + i);
+        const float32x4_t y = vmulq_f32(x, g);
+        vst1q_f32(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+float32x4_t ramp_index_neon(int phase)
+{
+    static const float init[4] = {0.f, 1.f, 2.f, 3.f};
+    return vaddq_f32(vdupq_n_f32(static_cast<float>(phase)), vld1q_f32(init));
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void ramp_neon(const float* in,
+               float* out,
+               int num_samples,
+               float start,
+               float increment,
+               int phase,
+               level_meter* meter)
+{
+    const float32x4_t s    = vdupq_n_f32(start);
+    const float32x4_t inc  = vdupq_n_f32(increment);
+    const float32x4_t step = vdupq_n_f32(4.f);
+    float32x4_t index      = ramp_index_neon(phase);
+    levels_neon_f32 levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        // vmulq + vaddq instead of vmlaq, which may be fused on AArch64.
+        const float32x4_t g = vaddq_f32(s, vmulq_f32(inc, index));
+        const float32x4_t x = vld1q_f32(in + i);
+        const float32x4_t y = vmulq_f32(x, g);
+        vst1q_f32(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+        index = vaddq_f32(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void curve_neon(const float* in, float* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_neon_f32 levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(in + i);
+        const float32x4_t y = vmulq_f32(x, vld1q_f32(gains + i));
+        vst1q_f32(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+void measure_neon(const float* in, int num_samples, float gain, level_meter& meter)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+    levels_neon_f32 levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(in + i);
+        levels.add(x, vmulq_f32(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+
+#if HA_ARCH_NEON_F64
+//------------------------------------------------------------------------
+struct levels_neon_f64
+{
+    float64x2_t input_peak    = vdupq_n_f64(0.);
+    float64x2_t output_peak   = vdupq_n_f64(0.);
+    float64x2_t input_energy  = vdupq_n_f64(0.);
+    float64x2_t output_energy = vdupq_n_f64(0.);
+
+    void add(float64x2_t x, float64x2_t y)
+    {
+        input_peak    = vmaxq_f64(input_peak, vabsq_f64(x));
+        output_peak   = vmaxq_f64(output_peak, vabsq_f64(y));
+        input_energy  = vaddq_f64(input_energy, vmulq_f64(x, x));
+        output_energy = vaddq_f64(output_energy, vmulq_f64(y, y));
+    }
+
+    void store(level_meter& meter, int num_samples) const
+    {
+        double lanes[4][2];
+        vst1q_f64(lanes[0], input_peak);
+        vst1q_f64(lanes[1], output_peak);
+        vst1q_f64(lanes[2], input_energy);
+        vst1q_f64(lanes[3], output_energy);
+        accumulate_lanes(meter, lanes[0], lanes[1], lanes[2], lanes[3], 2, num_samples);
+    }
+};
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void constant_neon(const double* in, double* out, int num_samples, float gain, level_meter* meter)
+{
+    const float64x2_t g = vdupq_n_f64(gain);
+    levels_neon_f64 levels;
+
+    int i = 0;
+    for (; i + 2 <= num_samples; i += 2)
+    {
+        const float64x2_t x = vld1q_f64(in + i);
+        const float64x2_t y = vmulq_f64(x, g);
+        vst1q_f64(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    constant_scalar<Metered>(in + i, out + i, num_samples - i, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void ramp_neon(const double* in,
+               double* out,
+               int num_samples,
+               float start,
+               float increment,
+               int phase,
+               level_meter* meter)
+{
+    const float32x4_t s    = vdupq_n_f32(start);
+    const float32x4_t inc  = vdupq_n_f32(increment);
+    const float32x4_t step = vdupq_n_f32(4.f);
+    float32x4_t index      = ramp_index_neon(phase);
+    levels_neon_f64 levels;
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        const float32x4_t g   = vaddq_f32(s, vmulq_f32(inc, index));
+        const float64x2_t x01 = vld1q_f64(in + i);
+        const float64x2_t x23 = vld1q_f64(in + i + 2);
+        const float64x2_t y01 = vmulq_f64(x01, vcvt_f64_f32(vget_low_f32(g)));
+        const float64x2_t y23 = vmulq_f64(x23, vcvt_high_f64_f32(g));
+        vst1q_f64(out + i, y01);
+        vst1q_f64(out + i + 2, y23);
+        if (Metered)
+        {
+            levels.add(x01, y01);
+            levels.add(x23, y23);
+        }
+        index = vaddq_f32(index, step);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    ramp_tail<Metered>(in, out, i, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <bool Metered>
+void curve_neon(
+    const double* in, double* out, int num_samples, const float* gains, level_meter* meter)
+{
+    levels_neon_f64 levels;
+
+    int i = 0;
+    for (; i + 2 <= num_samples; i += 2)
+    {
+        const float64x2_t x = vld1q_f64(in + i);
+        const float64x2_t y = vmulq_f64(x, vcvt_f64_f32(vld1_f32(gains + i)));
+        vst1q_f64(out + i, y);
+        if (Metered)
+            levels.add(x, y);
+    }
+
+    if (Metered)
+        levels.store(*meter, i);
+    curve_scalar<Metered>(in + i, out + i, num_samples - i, gains + i, meter);
+}
+
+//------------------------------------------------------------------------
+void measure_neon(const double* in, int num_samples, float gain, level_meter& meter)
+{
+    const float64x2_t g = vdupq_n_f64(gain);
+    levels_neon_f64 levels;
+
+    int i = 0;
+    for (; i + 2 <= num_samples; i += 2)
+    {
+        const float64x2_t x = vld1q_f64(in + i);
+        levels.add(x, vmulq_f64(x, g));
+    }
+
+    levels.store(meter, i);
+    measure_tail(in + i, num_samples - i, gain, meter);
+}
+#endif // HA_ARCH_NEON_F64
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_constant_neon(const T* in, T* out, int num_samples, float gain, level_meter* meter)
+{
+    if (meter)
+        constant_neon<true>(in, out, num_samples, gain, meter);
+    else
+        constant_neon<false>(in, out, num_samples, gain, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_ramp_neon(const T* in,
+                     T* out,
+                     int num_samples,
+                     float start,
+                     float increment,
+                     int phase,
+                     level_meter* meter)
+{
+    if (meter)
+        ramp_neon<true>(in, out, num_samples, start, increment, phase, meter);
+    else
+        ramp_neon<false>(in, out, num_samples, start, increment, phase, meter);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+void apply_curve_neon(const T* in, T* out, int num_samples, const float* gains, level_meter* meter)
+{
+    if (meter)
+        curve_neon<true>(in, out, num_samples, gains, meter);
+    else
+        curve_neon<false>(in, out, num_samples, gains, meter);
+}
+#endif // HA_ARCH_NEON
+
+//------------------------------------------------------------------------
+template <typename T>
+const gain_kernel<T> kernel_scalar = {simd_level::scalar, apply_constant_scalar<T>,
+                                      apply_ramp_scalar<T>, apply_curve_scalar<T>,
+                                      measure_scalar<T>};
+#if HA_ARCH_X86
+template <typename T>
+const gain_kernel<T> kernel_sse2 = {simd_level::sse2, apply_constant_sse2<T>, apply_ramp_sse2<T>,
+                                    apply_curve_sse2<T>, measure_sse2};
+template <typename T>
+const gain_kernel<T> kernel_avx2 = {simd_level::avx2, apply_constant_avx2<T>, apply_ramp_avx2<T>,
+                                    apply_curve_avx2<T>, measure_avx2};
+#endif
+#if HA_ARCH_NEON
+template <typename T>
+const gain_kernel<T> kernel_neon = {simd_level::neon, apply_constant_neon<T>, apply_ramp_neon<T>,
+                                    apply_curve_neon<T>, measure_neon};
+#endif
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// level_meter
+//------------------------------------------------------------------------
+void level_meter::add(const level_meter& other)
+{
+    input_peak  = std::max(input_peak, other.input_peak);
+    output_peak = std::max(output_peak, other.output_peak);
+    input_energy += other.input_energy;
+    output_energy += other.output_energy;
+    num_samples += other.num_samples;
+}
+
+//------------------------------------------------------------------------
+float level_meter::get_input_rms() const
+{
+    return num_samples > 0 ? static_cast<float>(std::sqrt(input_energy / num_samples)) : 0.f;
+}
+
+//------------------------------------------------------------------------
+float level_meter::get_output_rms() const
+{
+    return num_samples > 0 ? static_cast<float>(std::sqrt(output_energy / num_samples)) : 0.f;
+}
+
+//------------------------------------------------------------------------
+simd_level detect_simd_level()
+{
+#if HA_ARCH_X86
+    if (cpu_supports_avx2())
+        return simd_level::avx2;
+    if (cpu_supports_sse2())
+        return simd_level::sse2;
+#elif HA_ARCH_NEON
+    return simd_level::neon;
+#endif
+    return simd_level::scalar;
+}
+
+//------------------------------------------------------------------------
+const char* to_string(simd_level level)
+{
+    switch (level)
+    {
+        case simd_level::sse2: return "sse2";
+        case simd_level::avx2: return "avx2";
+        case simd_level::neon: return "neon";
+        default: return "scalar";
+    }
+}
+
+//------------------------------------------------------------------------
+template <>
+const gain_kernel<float>& get_gain_kernel<float>(simd_level level)
+{
+    switch (level)
+    {
+#if HA_ARCH_X86
+        case simd_level::avx2: return kernel_avx2<float>;
+        case simd_level::sse2: return kernel_sse2<float>;
+#endif
+#if HA_ARCH_NEON
+        case simd_level::neon: return kernel_neon<float>;
+#endif
+        default: return kernel_scalar<float>;
+    }
+}
+
+//------------------------------------------------------------------------
+template <>
+const gain_kernel<double>& get_gain_kernel<double>(simd_level level)
+{
+    switch (level)
+    {
+#if HA_ARCH_X86
+        case simd_level::avx2: return kernel_avx2<double>;
+        case simd_level::sse2: return kernel_sse2<double>;
+#endif
+#if HA_ARCH_NEON_F64
+        case simd_level::neon: return kernel_neon<double>;
+#endif
+        default: return kernel_scalar<double>;
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
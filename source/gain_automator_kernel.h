@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+enum class simd_level
+{
+    scalar,
+    sse2,
+    avx2,
+    neon
+};
+
+//------------------------------------------------------------------------
+// level_meter
+//
+// Peak and energy (sum of squares) before and after the gain, accumulated
+// over all channels and calls of a block by the metered kernel functions.
+//------------------------------------------------------------------------
+struct level_meter
+{
+    float input_peak     = 0.f;
+    float output_peak    = 0.f;
+    double input_energy  = 0.;
+    double output_energy = 0.;
+    int num_samples      = 0;
+
+    void reset() { *this = level_meter(); }
+    void add(const level_meter& other);
+    float get_input_rms() const;
+    float get_output_rms() const;
+};
+
+//------------------------------------------------------------------------
+// gain_kernel
+//
+// Table of vectorized gain functions for one instruction set and sample
+// type (float or double). The table is selected once (e.g. in
+// setupProcessing) and used in process without any further branching on
+// the CPU features.
+//
+// Gains are always single precision, independent of the sample type. All
+// variants compute a ramp as 'start + increment * (phase + i)' in float
+// per sample, so their results are bit identical regardless of the vector
+// width, to a ramp rendered into a gain curve and to the same ramp cut
+// into pieces (see gain_segment). 'in' and 'out' may point to the
+// same buffer.
+//
+// With a non-null 'meter' the levels are accumulated in the same pass as
+// the multiplication. A null 'meter' selects code without any metering.
+// 'measure' only reads 'in', for gains applied without a multiplication
+// (unity, silence); the output levels are derived from 'gain'.
+//------------------------------------------------------------------------
+template <typename SampleType>
+struct gain_kernel
+{
+    using sample_type   = SampleType;
+    using func_constant = void (*)(
+        const SampleType* in, SampleType* out, int num_samples, float gain, level_meter* meter);
+    using func_ramp  = void (*)(const SampleType* in,
+                               SampleType* out,
+                               int num_samples,
+                               float start,
+                               float increment,
+                               int phase,
+                               level_meter* meter);
+    using func_curve = void (*)(const SampleType* in,
+                                SampleType* out,
+                                int num_samples,
+                                const float* gains,
+                                level_meter* meter);
+    using func_measure =
+        void (*)(const SampleType* in, int num_samples, float gain, level_meter& meter);
+
+    simd_level level             = simd_level::scalar;
+    func_constant apply_constant = nullptr;
+    func_ramp apply_ramp         = nullptr;
+    func_curve apply_curve       = nullptr;
+    func_measure measure         = nullptr;
+};
+
+//------------------------------------------------------------------------
+simd_level detect_simd_level();
+const char* to_string(simd_level level);
+
+// Returns the kernel for 'level' or the scalar one, if 'level' has not
+// been compiled in for the target architecture and sample type.
+template <typename SampleType>
+const gain_kernel<SampleType>& get_gain_kernel(simd_level level);
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
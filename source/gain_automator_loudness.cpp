@@ -0,0 +1,525 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_loudness.h"
+#include "gain_automator_simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr double kPi                  = 3.14159265358979323846;
+constexpr double kBlockSeconds        = 0.1;
+constexpr double kRelativeGate        = -10.;
+constexpr double kBinsPerLoudnessUnit = 10.;
+
+// States below this are flushed after every 100 ms block, the filters
+// would run into denormals in silence otherwise.
+constexpr double kMinState = 1e-30;
+
+// The auto gain holds while the short-term loudness is below this.
+constexpr float kAutoGainGate = -50.f;
+
+//------------------------------------------------------------------------
+double to_loudness(double power)
+{
+    return power > 0. ? -0.691 + 10. * std::log10(power) : -HUGE_VAL;
+}
+
+//------------------------------------------------------------------------
+float to_reported_loudness(double power)
+{
+    return static_cast<float>(std::max(to_loudness(power), static_cast<double>(kMinLoudness)));
+}
+
+//------------------------------------------------------------------------
+double flush(double state)
+{
+    return std::abs(state) < kMinState ? 0. : state;
+}
+
+//------------------------------------------------------------------------
+// One channel through both filters, returns the sum of squares.
+//------------------------------------------------------------------------
+template <typename SampleType>
+double filter_scalar(const k_weighting& k,
+                     k_weighting_state& state,
+                     const SampleType* in,
+                     int num_samples)
+{
+    double s1     = state.s1;
+    double s2     = state.s2;
+    double s3     = state.s3;
+    double s4     = state.s4;
+    double energy = 0.;
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const double x = static_cast<double>(in[i]);
+        const double y = k.b0 * x + s1;
+        s1             = k.b1 * x - k.a1 * y + s2;
+        s2             = k.b2 * x - k.a2 * y;
+        const double z = y + s3;
+        s3             = -2. * y - k.c1 * z + s4;
+        s4             = y - k.c2 * z;
+        energy += z * z;
+    }
+    state = {s1, s2, s3, s4};
+    return energy;
+}
+
+#if HA_ARCH_X86
+//------------------------------------------------------------------------
+// Two channels in the lanes of a double vector, same operations in the
+// same order as filter_scalar().
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 inline __m128d load_pair(const float* left, const float* right, int i)
+{
+    return _mm_set_pd(static_cast<double>(right[i]), static_cast<double>(left[i]));
+}
+
+HA_TARGET_SSE2 inline __m128d load_pair(const double* left, const double* right, int i)
+{
+    return _mm_set_pd(right[i], left[i]);
+}
+
+HA_TARGET_SSE2 inline void store_pair(__m128d pair, double& left, double& right)
+{
+    double values[2];
+    _mm_storeu_pd(values, pair);
+    left  = values[0];
+    right = values[1];
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+HA_TARGET_SSE2 void filter_pair_sse2(const k_weighting& k,
+                                     k_weighting_state& left_state,
+                                     k_weighting_state& right_state,
+                                     const SampleType* left,
+                                     const SampleType* right,
+                                     int num_samples,
+                                     double& left_energy,
+                                     double& right_energy)
+{
+    const __m128d b0    = _mm_set1_pd(k.b0);
+    const __m128d b1    = _mm_set1_pd(k.b1);
+    const __m128d b2    = _mm_set1_pd(k.b2);
+    const __m128d a1    = _mm_set1_pd(k.a1);
+    const __m128d a2    = _mm_set1_pd(k.a2);
+    const __m128d c1    = _mm_set1_pd(k.c1);
+    const __m128d c2    = _mm_set1_pd(k.c2);
+    const __m128d minus = _mm_set1_pd(-2.);
+
+    __m128d s1     = _mm_set_pd(right_state.s1, left_state.s1);
+    __m128d s2     = _mm_set_pd(right_state.s2, left_state.s2);
+    __m128d s3     = _mm_set_pd(right_state.s3, left_state.s3);
+    __m128d s4     = _mm_set_pd(right_state.s4, left_state.s4);
+    __m128d energy = _mm_setzero_pd();
+    for (int i = 0; i < num_samples; ++i)
+    {
+        const __m128d x = load_pair(left, right, i);
+        const __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), s1);
+        s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), s2);
+        s2 = _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y));
+        const __m128d z = _mm_add_pd(y, s3);
+        s3 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(minus, y), _mm_mul_pd(c1, z)), s4);
+        s4 = _mm_sub_pd(y, _mm_mul_pd(c2, z));
+        energy = _mm_add_pd(energy, _mm_mul_pd(z, z));
+    }
+
+    store_pair(s1, left_state.s1, right_state.s1);
+    store_pair(s2, left_state.s2, right_state.s2);
+    store_pair(s3, left_state.s3, right_state.s3);
+    store_pair(s4, left_state.s4, right_state.s4);
+    store_pair(energy, left_energy, right_energy);
+}
+#endif // HA_ARCH_X86
+
+#if HA_ARCH_NEON_F64
+//------------------------------------------------------------------------
+inline float64x2_t load_pair(const float* left, const float* right, int i)
+{
+    const double values[2] = {static_cast<double>(left[i]), static_cast<double>(right[i])};
+    return vld1q_f64(values);
+}
+
+inline float64x2_t load_pair(const double* left, const double* right, int i)
+{
+    const double values[2] = {left[i], right[i]};
+    return vld1q_f64(values);
+}
+
+//------------------------------------------------------------------------
+inline float64x2_t make_pair(double left, double right)
+{
+    const double values[2] = {left, right};
+    return vld1q_f64(values);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void filter_pair_neon(const k_weighting& k,
+                      k_weighting_state& left_state,
+                      k_weighting_state& right_state,
+                      const SampleType* left,
+                      const SampleType* right,
+                      int num_samples,
+                      double& left_energy,
+                      double& right_energy)
+{
+    const float64x2_t b0    = vdupq_n_f64(k.b0);
+    const float64x2_t b1    = vdupq_n_f64(k.b1);
+    const float64x2_t b2    = vdupq_n_f64(k.b2);
+    const float64x2_t a1    = vdupq_n_f64(k.a1);
+    const float64x2_t a2    = vdupq_n_f64(k.a2);
+    const float64x2_t c1    = vdupq_n_f64(k.c1);
+    const float64x2_t c2    = vdupq_n_f64(k.c2);
+    const float64x2_t minus = vdupq_n_f64(-2.);
+
+    float64x2_t s1     = make_pair(left_state.s1, right_state.s1);
+    float64x2_t s2     = make_pair(left_state.s2, right_state.s2);
+    float64x2_t s3     = make_pair(left_state.s3, right_state.s3);
+    float64x2_t s4     = make_pair(left_state.s4, right_state.s4);
+    float64x2_t energy = vdupq_n_f64(0.);
+    for (int i = 0; i < num_samples; ++i)
+    {
+        // Separate multiply and add, no fused instructions, like the scalar code.
+        const float64x2_t x = load_pair(left, right, i);
+        const float64x2_t y = vaddq_f64(vmulq_f64(b0, x), s1);
+        s1 = vaddq_f64(vsubq_f64(vmulq_f64(b1, x), vmulq_f64(a1, y)), s2);
+        s2 = vsubq_f64(vmulq_f64(b2, x), vmulq_f64(a2, y));
+        const float64x2_t z = vaddq_f64(y, s3);
+        s3 = vaddq_f64(vsubq_f64(vmulq_f64(minus, y), vmulq_f64(c1, z)), s4);
+        s4 = vsubq_f64(y, vmulq_f64(c2, z));
+        energy = vaddq_f64(energy, vmulq_f64(z, z));
+    }
+
+    left_state   = {vgetq_lane_f64(s1, 0), vgetq_lane_f64(s2, 0), vgetq_lane_f64(s3, 0),
+                    vgetq_lane_f64(s4, 0)};
+    right_state  = {vgetq_lane_f64(s1, 1), vgetq_lane_f64(s2, 1), vgetq_lane_f64(s3, 1),
+                    vgetq_lane_f64(s4, 1)};
+    left_energy  = vgetq_lane_f64(energy, 0);
+    right_energy = vgetq_lane_f64(energy, 1);
+}
+#endif // HA_ARCH_NEON_F64
+
+//------------------------------------------------------------------------
+// Returns false if 'level' has no pair filter on this architecture.
+template <typename SampleType>
+bool filter_pair(simd_level level,
+                 const k_weighting& k,
+                 k_weighting_state& left_state,
+                 k_weighting_state& right_state,
+                 const SampleType* left,
+                 const SampleType* right,
+                 int num_samples,
+                 double& left_energy,
+                 double& right_energy)
+{
+    switch (level)
+    {
+#if HA_ARCH_X86
+        case simd_level::sse2:
+        case simd_level::avx2:
+            filter_pair_sse2(k, left_state, right_state, left, right, num_samples, left_energy,
+                             right_energy);
+            return true;
+#endif
+#if HA_ARCH_NEON_F64
+        case simd_level::neon:
+            filter_pair_neon(k, left_state, right_state, left, right, num_samples, left_energy,
+                             right_energy);
+            return true;
+#endif
+        default: return false;
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+k_weighting make_k_weighting(double sample_rate)
+{
+    // BS.1770 specifies the filters at 48 kHz, these are their analog
+    // prototypes mapped to any rate by the bilinear transform.
+    k_weighting k;
+
+    const double shelf_frequency = 1681.974450955533;
+    const double shelf_gain      = 3.999843853973347;
+    const double shelf_q         = 0.7071752369554196;
+    const double kh              = std::tan(kPi * shelf_frequency / sample_rate);
+    const double vh              = std::pow(10., shelf_gain / 20.);
+    const double vb              = std::pow(vh, 0.4996667741545416);
+    const double shelf_a0        = 1. + kh / shelf_q + kh * kh;
+    k.b0                         = (vh + vb * kh / shelf_q + kh * kh) / shelf_a0;
+    k.b1                         = 2. * (kh * kh - vh) / shelf_a0;
+    k.b2                         = (vh - vb * kh / shelf_q + kh * kh) / shelf_a0;
+    k.a1                         = 2. * (kh * kh - 1.) / shelf_a0;
+    k.a2                         = (1. - kh / shelf_q + kh * kh) / shelf_a0;
+
+    const double pass_frequency = 38.13547087602444;
+    const double pass_q         = 0.5003270373238773;
+    const double kp             = std::tan(kPi * pass_frequency / sample_rate);
+    const double pass_a0        = 1. + kp / pass_q + kp * kp;
+    k.c1                        = 2. * (kp * kp - 1.) / pass_a0;
+    k.c2                        = (1. - kp / pass_q + kp * kp) / pass_a0;
+
+    return k;
+}
+
+//------------------------------------------------------------------------
+// loudness_meter
+//------------------------------------------------------------------------
+void loudness_meter::setup(double sample_rate, int max_channels, simd_level level)
+{
+    simd          = level;
+    block_samples = std::max(static_cast<int>(std::lround(sample_rate * kBlockSeconds)), 1);
+    coefficients  = make_k_weighting(sample_rate);
+
+    states.assign(std::max(max_channels, 0), k_weighting_state());
+    weights.assign(states.size(), 1.f);
+    energies.assign(states.size(), 0.);
+
+    reset();
+}
+
+//------------------------------------------------------------------------
+void loudness_meter::reset()
+{
+    std::fill(states.begin(), states.end(), k_weighting_state());
+    std::fill(energies.begin(), energies.end(), 0.);
+    block_powers.fill(0.);
+    bin_counts.fill(0);
+    bin_powers.fill(0.);
+
+    num_pending = 0;
+    block_index = 0;
+    num_blocks  = 0;
+    levels      = loudness_levels();
+}
+
+//------------------------------------------------------------------------
+void loudness_meter::set_channel_weight(int channel, float weight)
+{
+    if (channel >= 0 && channel < static_cast<int>(weights.size()))
+        weights[channel] = weight;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void loudness_meter::process(const SampleType* const* channels, int num_channels, int num_samples)
+{
+    num_channels = std::min(num_channels, static_cast<int>(states.size()));
+
+    // Blocks of the host are cut at the 100 ms boundaries.
+    int offset = 0;
+    while (offset < num_samples)
+    {
+        const int chunk = std::min(num_samples - offset, block_samples - num_pending);
+        filter(channels, num_channels, offset, chunk);
+        offset += chunk;
+        num_pending += chunk;
+        if (num_pending == block_samples)
+            end_block();
+    }
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void loudness_meter::filter(const SampleType* const* channels,
+                            int num_channels,
+                            int offset,
+                            int num_samples)
+{
+    int channel = 0;
+    while (channel < num_channels)
+    {
+        const SampleType* left  = channels[channel];
+        const SampleType* right = channel + 1 < num_channels ? channels[channel + 1] : nullptr;
+        double left_energy      = 0.;
+        double right_energy     = 0.;
+        if (left && right &&
+            filter_pair(simd, coefficients, states[channel], states[channel + 1], left + offset,
+                        right + offset, num_samples, left_energy, right_energy))
+        {
+            energies[channel] += left_energy;
+            energies[channel + 1] += right_energy;
+            channel += 2;
+            continue;
+        }
+
+        if (left)
+            energies[channel] +=
+                filter_scalar(coefficients, states[channel], left + offset, num_samples);
+        ++channel;
+    }
+}
+
+//------------------------------------------------------------------------
+void loudness_meter::end_block()
+{
+    double power = 0.;
+    for (size_t channel = 0; channel < states.size(); ++channel)
+    {
+        power += weights[channel] * energies[channel];
+        energies[channel] = 0.;
+
+        auto& state = states[channel];
+        state       = {flush(state.s1), flush(state.s2), flush(state.s3), flush(state.s4)};
+    }
+
+    block_powers[block_index] = power / block_samples;
+    block_index               = block_index + 1 < kNumShortTermBlocks ? block_index + 1 : 0;
+    num_blocks                = std::min(num_blocks + 1, kNumShortTermBlocks);
+    num_pending               = 0;
+
+    // The windows are the last blocks, fewer at the start.
+    double short_term_power = 0.;
+    double momentary_power  = 0.;
+    for (int block = 0; block < num_blocks; ++block)
+    {
+        const int index    = (block_index + kNumShortTermBlocks - 1 - block) % kNumShortTermBlocks;
+        short_term_power += block_powers[index];
+        if (block < kNumMomentaryBlocks)
+            momentary_power += block_powers[index];
+    }
+    momentary_power /= std::min(num_blocks, kNumMomentaryBlocks);
+    short_term_power /= num_blocks;
+
+    levels.momentary  = to_reported_loudness(momentary_power);
+    levels.short_term = to_reported_loudness(short_term_power);
+
+    // Gating blocks are complete momentary blocks above the absolute gate.
+    const double loudness = to_loudness(momentary_power);
+    if (num_blocks < kNumMomentaryBlocks || loudness <= kMinLoudness)
+        return;
+
+    const double position = (loudness - kMinLoudness) * kBinsPerLoudnessUnit;
+    const int bin         = std::min(static_cast<int>(position), kNumBins - 1);
+    ++bin_counts[bin];
+    bin_powers[bin] += momentary_power;
+    update_integrated();
+}
+
+//------------------------------------------------------------------------
+void loudness_meter::update_integrated()
+{
+    double total_power = 0.;
+    double total_count = 0.;
+    for (int bin = 0; bin < kNumBins; ++bin)
+    {
+        total_power += bin_powers[bin];
+        total_count += bin_counts[bin];
+    }
+
+    // The relative gate falls into a bin, which is kept as a whole.
+    const double gate     = to_loudness(total_power / total_count) + kRelativeGate;
+    const double position = (gate - kMinLoudness) * kBinsPerLoudnessUnit;
+    const int first_bin   = std::min(std::max(static_cast<int>(position), 0), kNumBins - 1);
+
+    double gated_power = 0.;
+    double gated_count = 0.;
+    for (int bin = first_bin; bin < kNumBins; ++bin)
+    {
+        gated_power += bin_powers[bin];
+        gated_count += bin_counts[bin];
+    }
+    levels.integrated = to_reported_loudness(gated_count > 0. ? gated_power / gated_count : 0.);
+}
+
+//------------------------------------------------------------------------
+template void loudness_meter::process<float>(const float* const*, int, int);
+template void loudness_meter::process<double>(const double* const*, int, int);
+
+//------------------------------------------------------------------------
+float to_loudness_target(double normalized)
+{
+    const double clamped = std::min(std::max(normalized, 0.), 1.);
+    return static_cast<float>(kMinLoudnessTarget +
+                              clamped * (kMaxLoudnessTarget - kMinLoudnessTarget));
+}
+
+//------------------------------------------------------------------------
+double to_normalized_loudness_target(float lufs)
+{
+    return (lufs - kMinLoudnessTarget) / (kMaxLoudnessTarget - kMinLoudnessTarget);
+}
+
+//------------------------------------------------------------------------
+float to_auto_gain_slew(double normalized)
+{
+    const double clamped = std::min(std::max(normalized, 0.), 1.);
+    return static_cast<float>(kMinAutoGainSlew + clamped * (kMaxAutoGainSlew - kMinAutoGainSlew));
+}
+
+//------------------------------------------------------------------------
+double to_normalized_auto_gain_slew(float decibel_per_second)
+{
+    return (decibel_per_second - kMinAutoGainSlew) / (kMaxAutoGainSlew - kMinAutoGainSlew);
+}
+
+//------------------------------------------------------------------------
+// auto_gain
+//------------------------------------------------------------------------
+void auto_gain::setup(double rate)
+{
+    sample_rate = rate;
+}
+
+//------------------------------------------------------------------------
+void auto_gain::reset(float start_decibel)
+{
+    decibel    = start_decibel;
+    start_gain = std::pow(10.f, decibel / 20.f);
+    end_gain   = start_gain;
+}
+
+//------------------------------------------------------------------------
+void auto_gain::process(float loudness, float target, float slew, int num_samples)
+{
+    start_gain = end_gain;
+    if (loudness <= kAutoGainGate)
+        return;
+
+    const float wanted = std::min(std::max(target - loudness, kMinAutoGainDecibel),
+                                  kMaxAutoGainDecibel);
+    move_to(wanted, slew, num_samples);
+}
+
+//------------------------------------------------------------------------
+void auto_gain::release(float slew, int num_samples)
+{
+    start_gain = end_gain;
+    move_to(0.f, slew, num_samples);
+}
+
+//------------------------------------------------------------------------
+void auto_gain::move_to(float wanted, float slew, int num_samples)
+{
+    const float step  = static_cast<float>(slew * num_samples / sample_rate);
+    const float delta = std::min(std::max(wanted - decibel, -step), step);
+    if (delta == 0.f)
+        return;
+
+    decibel += delta;
+    end_gain = decibel == 0.f ? 1.f : std::pow(10.f, decibel / 20.f);
+}
+
+//------------------------------------------------------------------------
+void auto_gain::render(float* gains, int num_samples) const
+{
+    // Ends at 'end_gain' on the block's last sample.
+    const float increment = (end_gain - start_gain) / static_cast<float>(num_samples);
+    for (int i = 0; i < num_samples; ++i)
+        gains[i] = start_gain + increment * static_cast<float>(i + 1);
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
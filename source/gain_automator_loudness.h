@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_kernel.h"
+#include <array>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Loudness in LUFS. kMinLoudness is the absolute gate of ITU-R BS.1770,
+// reported for silence and before the first measurement.
+static constexpr float kMinLoudness = -70.f;
+static constexpr float kMaxLoudness = 0.f;
+
+//------------------------------------------------------------------------
+// Latest loudness of a loudness_meter in LUFS.
+struct loudness_levels
+{
+    float momentary  = kMinLoudness; // 400 ms
+    float short_term = kMinLoudness; // 3 s
+    float integrated = kMinLoudness; // gated, since the last reset
+};
+
+//------------------------------------------------------------------------
+// Coefficients of the K-weighting filters for one sample rate: a high
+// shelf (b0..a2) and a high pass (numerator 1, -2, 1 and c1, c2).
+struct k_weighting
+{
+    double b0 = 1.;
+    double b1 = 0.;
+    double b2 = 0.;
+    double a1 = 0.;
+    double a2 = 0.;
+    double c1 = 0.;
+    double c2 = 0.;
+};
+
+// Transposed direct form II states of both filters of one channel.
+struct k_weighting_state
+{
+    double s1 = 0.;
+    double s2 = 0.;
+    double s3 = 0.;
+    double s4 = 0.;
+};
+
+k_weighting make_k_weighting(double sample_rate);
+
+//------------------------------------------------------------------------
+// loudness_meter
+//
+// Streaming loudness of ITU-R BS.1770 / EBU R 128. The channels are
+// K-weighted by two biquads (high shelf and high pass) and their mean
+// squares are summed with the channel weights in blocks of 100 ms. The
+// momentary and short-term loudness average the last 4 and 30 of them.
+// Every 100 ms the momentary block (400 ms, 75 % overlap) is a gating
+// block for the integrated loudness: kept in a histogram of 0.1 LU bins
+// with the energy per bin, so memory stays fixed however long it runs,
+// and gated absolutely at -70 LUFS and relatively 10 LU below the
+// loudness of the blocks above the absolute gate.
+//
+// With a simd_level other than scalar, pairs of channels are filtered
+// together in the two lanes of a double vector, bit identical to the
+// scalar filters.
+//------------------------------------------------------------------------
+class loudness_meter
+{
+public:
+    // Allocates the filter states. Not real-time safe.
+    void setup(double sample_rate, int max_channels, simd_level level);
+    // Clears the filters, windows and the integrated loudness.
+    void reset();
+
+    // 1 for front channels, 1.41 for surrounds, 0 for the LFE.
+    void set_channel_weight(int channel, float weight);
+
+    // Channels beyond the setup's are ignored.
+    template <typename SampleType>
+    void process(const SampleType* const* channels, int num_channels, int num_samples);
+
+    const loudness_levels& get_levels() const { return levels; }
+
+private:
+    static constexpr int kNumShortTermBlocks = 30;
+    static constexpr int kNumMomentaryBlocks = 4;
+    static constexpr int kNumBins            = 750; // 0.1 LU from kMinLoudness to +5 LUFS
+
+    template <typename SampleType>
+    void filter(const SampleType* const* channels, int num_channels, int offset, int num_samples);
+    void end_block();
+    void update_integrated();
+
+    simd_level simd   = simd_level::scalar;
+    int block_samples = 4800;
+    int num_pending   = 0; // samples of the current 100 ms block
+
+    k_weighting coefficients;
+    std::vector<k_weighting_state> states;
+    std::vector<float> weights;
+    std::vector<double> energies; // filtered energy per channel of the current block
+
+    // Weighted mean squares of the last blocks, a ring
+    std::array<double, kNumShortTermBlocks> block_powers{};
+    int block_index = 0;
+    int num_blocks  = 0;
+
+    // Gating blocks per 0.1 LU bin, their number and summed power
+    std::array<unsigned, kNumBins> bin_counts{};
+    std::array<double, kNumBins> bin_powers{};
+
+    loudness_levels levels;
+};
+
+//------------------------------------------------------------------------
+// Loudness target and the auto gain's bounds. Target and slew map
+// linearly to [0, 1].
+static constexpr float kMinLoudnessTarget     = -36.f;
+static constexpr float kMaxLoudnessTarget     = -6.f;
+static constexpr float kDefaultLoudnessTarget = -23.f;
+static constexpr float kMinAutoGainSlew       = 0.1f; // dB per second
+static constexpr float kMaxAutoGainSlew       = 6.f;
+static constexpr float kDefaultAutoGainSlew   = 1.f;
+static constexpr float kMinAutoGainDecibel    = -24.f;
+static constexpr float kMaxAutoGainDecibel    = 24.f;
+
+float to_loudness_target(double normalized);
+double to_normalized_loudness_target(float lufs);
+float to_auto_gain_slew(double normalized);
+double to_normalized_auto_gain_slew(float decibel_per_second);
+
+//------------------------------------------------------------------------
+// auto_gain
+//
+// Rides a gain towards the loudness target: the gain that brings the
+// measured short-term loudness to the target, approached with a bounded
+// slew in dB per second. Below the gate (pauses, silence) it holds.
+// One linear ramp per block, rendered on request.
+//------------------------------------------------------------------------
+class auto_gain
+{
+public:
+    void setup(double sample_rate);
+    void reset(float start_decibel = 0.f);
+
+    // 'loudness' is the measured short-term loudness without the gain.
+    void process(float loudness, float target, float slew, int num_samples);
+    // Returns to 0 dB with 'slew', e.g. after the auto gain was switched off.
+    void release(float slew, int num_samples);
+
+    bool is_moving() const { return start_gain != end_gain; }
+    float get_gain() const { return end_gain; }
+    float get_decibel() const { return decibel; }
+
+    // The ramp of the last block from its start to its end gain.
+    void render(float* gains, int num_samples) const;
+
+private:
+    void move_to(float wanted, float slew, int num_samples);
+
+    double sample_rate = 48000.;
+    float decibel      = 0.f;
+    float start_gain   = 1.f;
+    float end_gain     = 1.f;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,54 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_meter.h"
+
+#include <algorithm>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr double kMeterIntervalSeconds = 0.01;
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// meter_collector
+//------------------------------------------------------------------------
+void meter_collector::setup(double sample_rate)
+{
+    interval_samples = std::max(static_cast<int>(sample_rate * kMeterIntervalSeconds), 1);
+    pending_samples  = 0;
+    meter.reset();
+}
+
+//------------------------------------------------------------------------
+void meter_collector::end_block(int num_samples,
+                                float gain,
+                                const loudness_levels& loudness,
+                                meter_queue& queue)
+{
+    pending_samples += num_samples;
+    if (pending_samples < interval_samples)
+        return;
+
+    meter_frame frame;
+    frame.input_peak  = meter.input_peak;
+    frame.output_peak = meter.output_peak;
+    frame.input_rms   = meter.get_input_rms();
+    frame.output_rms  = meter.get_output_rms();
+    frame.gain        = gain;
+    frame.loudness    = loudness;
+    queue.push(frame);
+
+    pending_samples = 0;
+    meter.reset();
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
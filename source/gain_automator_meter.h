@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_kernel.h"
+#include "gain_automator_loudness.h"
+#include "gain_automator_spsc_queue.h"
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// meter_frame
+//
+// Levels of one metering interval as linear values, sent from the audio
+// thread to the controller. 'gain' is the linear gain applied at the end
+// of the interval, 'loudness' the latest of the output.
+//------------------------------------------------------------------------
+struct meter_frame
+{
+    float input_peak  = 0.f;
+    float output_peak = 0.f;
+    float input_rms   = 0.f;
+    float output_rms  = 0.f;
+    float gain        = 0.f;
+    loudness_levels loudness;
+};
+
+// About one second of 10 ms frames. When the consumer stalls, new frames
+// are dropped.
+using meter_queue = spsc_queue<meter_frame, 128>;
+
+//------------------------------------------------------------------------
+// meter_collector
+//
+// Accumulates level_meter results over blocks until an interval of
+// 'interval_samples' is complete and then pushes one meter_frame.
+//------------------------------------------------------------------------
+class meter_collector
+{
+public:
+    void setup(double sample_rate);
+
+    // The meter to pass to the kernels of the current block.
+    level_meter& get_meter() { return meter; }
+
+    // Call once per block, after all channels have been metered.
+    void end_block(int num_samples,
+                   float gain,
+                   const loudness_levels& loudness,
+                   meter_queue& queue);
+
+private:
+    level_meter meter;
+    int interval_samples = 480;
+    int pending_samples  = 0;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
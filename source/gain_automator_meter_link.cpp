@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_meter_link.h"
+
+#include <cstring>
+
+using namespace Steinberg;
+
+namespace ha {
+namespace MeterLink {
+namespace {
+
+//------------------------------------------------------------------------
+// Its address identifies this module in this process.
+const char kModuleToken = 0;
+
+constexpr Vst::IAttributeList::AttrID kQueueAttr   = "Queue";
+constexpr Vst::IAttributeList::AttrID kProfileAttr = "Profile";
+
+//------------------------------------------------------------------------
+template <typename T>
+struct Payload
+{
+    const void* token;
+    T* pointer;
+};
+
+//------------------------------------------------------------------------
+template <typename T>
+void writePointer(Vst::IAttributeList& attributes, Vst::IAttributeList::AttrID id, T* pointer)
+{
+    const Payload<T> payload = {&kModuleToken, pointer};
+    attributes.setBinary(id, &payload, sizeof(payload));
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+T* readPointer(Vst::IAttributeList& attributes, Vst::IAttributeList::AttrID id)
+{
+    const void* data = nullptr;
+    uint32 size      = 0;
+    if (attributes.getBinary(id, data, size) != kResultOk || size != sizeof(Payload<T>))
+        return nullptr;
+
+    Payload<T> payload;
+    std::memcpy(&payload, data, sizeof(payload));
+    return payload.token == &kModuleToken ? payload.pointer : nullptr;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+void write(Vst::IAttributeList& attributes, dsp::meter_queue* queue)
+{
+    writePointer(attributes, kQueueAttr, queue);
+}
+
+//------------------------------------------------------------------------
+dsp::meter_queue* read(Vst::IAttributeList& attributes)
+{
+    return readPointer<dsp::meter_queue>(attributes, kQueueAttr);
+}
+
+//------------------------------------------------------------------------
+void writeProfile(Vst::IAttributeList& attributes, const dsp::process_profile* profile)
+{
+    writePointer(attributes, kProfileAttr, profile);
+}
+
+//------------------------------------------------------------------------
+const dsp::process_profile* readProfile(Vst::IAttributeList& attributes)
+{
+    return readPointer<const dsp::process_profile>(attributes, kProfileAttr);
+}
+
+//------------------------------------------------------------------------
+} // namespace MeterLink
+} // namespace ha
@@ -0,0 +1,43 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_meter.h"
+#include "gain_automator_profile.h"
+#include "pluginterfaces/vst/ivstmessage.h"
+
+namespace ha {
+
+//------------------------------------------------------------------------
+//  MeterLink
+//
+//  Hands the processor's meter queue to the controller through the
+//  connection point, once, outside of the audio thread. Afterwards the
+//  levels travel through the queue without any locks or allocations.
+//
+//  The queue's address is only accepted by a controller in the same
+//  process and module. A distributed controller simply gets no meters.
+//------------------------------------------------------------------------
+namespace MeterLink {
+
+// Processor -> controller, carries the queue.
+static constexpr const char* kQueueMessageId = "MeterQueue";
+// Controller -> processor, the queue is polled from now on.
+static constexpr const char* kAcceptedMessageId = "MeterQueueAccepted";
+
+void write(Steinberg::Vst::IAttributeList& attributes, dsp::meter_queue* queue);
+
+// Returns null, if the attributes come from another process or module.
+dsp::meter_queue* read(Steinberg::Vst::IAttributeList& attributes);
+
+// The process() profile travels along with the queue, if profiling is compiled in.
+void writeProfile(Steinberg::Vst::IAttributeList& attributes,
+                  const dsp::process_profile* profile);
+const dsp::process_profile* readProfile(Steinberg::Vst::IAttributeList& attributes);
+
+} // namespace MeterLink
+
+//------------------------------------------------------------------------
+} // namespace ha
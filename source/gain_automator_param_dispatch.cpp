@@ -0,0 +1,146 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_param_dispatch.h"
+
+#include <algorithm>
+
+using namespace Steinberg;
+
+namespace ha {
+namespace {
+
+//------------------------------------------------------------------------
+// Queued points per parameter but the gain, a lot for block rate settings
+// and trims. More of them within the delay merge into the latest.
+constexpr int kMaxDelayedPoints = 1024;
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// ParamChangeDispatcher
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::setup(int32 maxPointsPerParam)
+{
+    capacity = std::max(maxPointsPerParam, int32(1));
+    points.assign(static_cast<size_t>(capacity) * kNumParams, {});
+    pointCounts.fill(0);
+}
+
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::dispatch(Vst::IParameterChanges* changes)
+{
+    pointCounts.fill(0);
+    if (!changes || capacity == 0)
+        return;
+
+    const int32 numParamsChanges = changes->getParameterCount();
+    for (int32 index = 0; index < numParamsChanges; index++)
+    {
+        auto* queue = changes->getParameterData(index);
+        if (!queue)
+            continue;
+
+        const Vst::ParamID id = queue->getParameterId();
+        if (id < kNumParams)
+            decode(*queue, static_cast<int32>(id));
+    }
+}
+
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::decode(Vst::IParamValueQueue& queue, int32 slot)
+{
+    dsp::automation_point* slotPoints = &points[static_cast<size_t>(slot) * capacity];
+    int32& count                      = pointCounts[slot];
+
+    const int32 numPoints = queue.getPointCount();
+    for (int32 index = 0; index < numPoints; index++)
+    {
+        int32 offset          = 0;
+        Vst::ParamValue value = 0.;
+        if (queue.getPoint(index, offset, value) != kResultOk)
+            continue;
+
+        // More points than samples in a block is a host error. Keep the
+        // latest one in the last slot, so the final value is never lost.
+        if (count == capacity)
+            count--;
+
+        slotPoints[count++] = {offset, static_cast<float>(value)};
+    }
+}
+
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::setupDelays(int32 maxDelay)
+{
+    // Only the gain is automated densely, the other rings stay small.
+    for (auto& delay : delays)
+        delay.setup(maxDelay, capacity, kMaxDelayedPoints);
+}
+
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::delayPoints(int32 delay, int32 numSamples, Vst::ParamID exceptId)
+{
+    for (int32 slot = 0; slot < kNumParams; ++slot)
+    {
+        if (static_cast<Vst::ParamID>(slot) == exceptId)
+            continue;
+
+        dsp::automation_point* slotPoints = &points[static_cast<size_t>(slot) * capacity];
+        int32& count                      = pointCounts[slot];
+
+        int numDue                       = 0;
+        const dsp::automation_point* due = delays[slot].process(slotPoints, count, delay,
+                                                                numSamples, numDue);
+        if (due == slotPoints)
+            continue;
+
+        // Like decode: if more are due than fit, the latest ones are kept.
+        const int32 first = std::max(numDue - capacity, 0);
+        count             = numDue - first;
+        std::copy(due + first, due + numDue, slotPoints);
+    }
+}
+
+//------------------------------------------------------------------------
+void ParamChangeDispatcher::collapseDelays()
+{
+    for (auto& delay : delays)
+        delay.collapse();
+}
+
+//------------------------------------------------------------------------
+int32 ParamChangeDispatcher::getPointCount(Vst::ParamID id) const
+{
+    return id < kNumParams ? pointCounts[id] : 0;
+}
+
+//------------------------------------------------------------------------
+int32 ParamChangeDispatcher::getTotalPointCount() const
+{
+    int32 total = 0;
+    for (const int32 count : pointCounts)
+        total += count;
+    return total;
+}
+
+//------------------------------------------------------------------------
+const dsp::automation_point* ParamChangeDispatcher::getPoints(Vst::ParamID id) const
+{
+    if (id >= kNumParams || points.empty())
+        return nullptr;
+
+    return &points[static_cast<size_t>(id) * capacity];
+}
+
+//------------------------------------------------------------------------
+float ParamChangeDispatcher::getLastValue(Vst::ParamID id, float fallback) const
+{
+    const int32 count = getPointCount(id);
+    return count > 0 ? getPoints(id)[count - 1].value : fallback;
+}
+
+//------------------------------------------------------------------------
+} // namespace ha
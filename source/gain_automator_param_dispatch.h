@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_automation_delay.h"
+#include "gain_automator_param_ids.h"
+#include "gain_automator_segments.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+#include <array>
+#include <vector>
+
+namespace ha {
+
+//------------------------------------------------------------------------
+//  ParamChangeDispatcher
+//
+//  Walks IParameterChanges once per block and decodes the points of every
+//  known parameter into a preallocated, flat per-parameter slot. The DSP
+//  then reads plain arrays instead of querying the host's queues.
+//
+//  Parameter ids are dense (see gain_automator_param_ids.h), so the slot
+//  of a parameter is its id. Unknown ids are ignored.
+//
+//  While the audio is delayed in front of the gain stage, the points can
+//  be delayed by as much, so they still meet the audio they were written
+//  for, see delayPoints.
+//------------------------------------------------------------------------
+class ParamChangeDispatcher
+{
+public:
+    //--------------------------------------------------------------------
+    // Allocates 'maxPointsPerParam' points for every slot. Not real-time safe.
+    void setup(Steinberg::int32 maxPointsPerParam);
+
+    // Decodes all queues of 'changes' (may be null). Real-time safe.
+    void dispatch(Steinberg::Vst::IParameterChanges* changes);
+
+    // Allocates a delay of up to 'maxDelay' samples per parameter. Not real-time safe.
+    void setupDelays(Steinberg::int32 maxDelay);
+
+    // Replaces the points of every parameter but 'exceptId' by those due
+    // in this block after 'delay' samples. Real-time safe.
+    void delayPoints(Steinberg::int32 delay,
+                     Steinberg::int32 numSamples,
+                     Steinberg::Vst::ParamID exceptId);
+
+    // For a delay that jumps: the latest queued value of each parameter
+    // falls due at the start of the next block.
+    void collapseDelays();
+
+    Steinberg::int32 getPointCount(Steinberg::Vst::ParamID id) const;
+    const dsp::automation_point* getPoints(Steinberg::Vst::ParamID id) const;
+    bool hasChanges(Steinberg::Vst::ParamID id) const { return getPointCount(id) > 0; }
+
+    // Points of all parameters in this block.
+    Steinberg::int32 getTotalPointCount() const;
+
+    // Value of the last point of 'id' in this block or 'fallback' if there is none.
+    float getLastValue(Steinberg::Vst::ParamID id, float fallback) const;
+
+    //--------------------------------------------------------------------
+private:
+    void decode(Steinberg::Vst::IParamValueQueue& queue, Steinberg::int32 slot);
+
+    std::vector<dsp::automation_point> points;
+    std::array<Steinberg::int32, kNumParams> pointCounts{};
+    Steinberg::int32 capacity = 0;
+
+    std::array<dsp::automation_delay, kNumParams> delays;
+};
+
+//------------------------------------------------------------------------
+} // namespace ha
@@ -7,10 +7,72 @@
 namespace ha {
 
 //------------------------------------------------------------------------
+// Trims of the first channels, see dsp::channel_gains.
+static constexpr int kNumTrims = 8;
+
+//------------------------------------------------------------------------
+enum
+{
+    kParamGainId             = 0,
+    kParamGainLawId          = 1,
+    kParamSmoothingModeId    = 2,
+    kParamSmoothingTimeId    = 3,
+    kParamBypassId           = 4,
+    kParamBypassFadeId       = 5,
+    kParamGainGroupId        = 6,
+    kParamGroupRoleId        = 7,
+    kParamTrimId             = 8, // first of kNumTrims
+    kParamBalanceId          = 16,
+    kParamMidGainId          = 17,
+    kParamSideGainId         = 18,
+    kParamCeilingId          = 19,
+    kParamCeilingOnId        = 20,
+    kParamAutoGainId         = 21,
+    kParamLoudnessTargetId   = 22,
+    kParamAutoGainSlewId     = 23,
+    kParamAutomationOffsetId = 24,
+    kParamOffsetLookaheadId  = 25,
+
+    kNumParams
+};
+
+//------------------------------------------------------------------------
+// Read-only parameters of the controller, fed by the processor's meter
+// queue. They never reach the processor and need no dispatcher slot.
 enum
 {
-    kParamGainId = 0,
+    kMeterInputPeakId = 1000,
+    kMeterInputRmsId,
+    kMeterOutputPeakId,
+    kMeterOutputRmsId,
+    kMeterGainId,
+
+    // Loudness of the output in LUFS
+    kMeterMomentaryId,
+    kMeterShortTermId,
+    kMeterIntegratedId,
+
+    // Only with HA_GAIN_AUTOMATOR_PROFILING, in microseconds
+    kProfileAverageTimeId,
+    kProfileMaxTimeId
 };
 
+//------------------------------------------------------------------------
+// Controller -> processor, the new 'Ceiling On' value. Sent before the
+// controller announces the latency change, which the host may query
+// before the parameter change reaches process().
+static constexpr const char* kCeilingMessageId = "CeilingOn";
+static constexpr const char* kCeilingOnAttr    = "On";
+
+// Controller -> processor, the new 'Offset Lookahead' value, which delays
+// the audio. Sent for the same reason.
+static constexpr const char* kLookaheadMessageId = "OffsetLookahead";
+static constexpr const char* kLookaheadOnAttr    = "On";
+
+// Controller -> processor, whether 'Gain Group' and 'Group Role' make the
+// instance a follower, which delays the audio. Sent for the same reason.
+static constexpr const char* kFollowerMessageId = "GroupFollower";
+static constexpr const char* kFollowerOnAttr    = "On";
+
 //------------------------------------------------------------------------
 } // namespace ha
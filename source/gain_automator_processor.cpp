@@ -4,14 +4,17 @@
 
 #include "gain_automator_processor.h"
 #include "gain_automator_cids.h"
+#include "gain_automator_meter_link.h"
 #include "gain_automator_param_ids.h"
-#include "ha/param_tool_box/process/ramp_processor.h"
-
-#include "base/source/fstreamer.h"
-#include "pluginterfaces/vst/ivstparameterchanges.h"
+#include "gain_automator_state.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
 
 using namespace Steinberg;
 
@@ -19,47 +22,125 @@ namespace ha {
 namespace {
 
 //------------------------------------------------------------------------
-bool get_queue_value(Vst::IParamValueQueue* queue, int index, int& offset, float& value)
+template <typename SampleType>
+SampleType** get_channel_buffers(Vst::AudioBusBuffers& bus);
+
+template <>
+float** get_channel_buffers<float>(Vst::AudioBusBuffers& bus)
 {
-    if (!queue)
-        return false;
+    return bus.channelBuffers32;
+}
 
-    if (index < queue->getPointCount())
-    {
-        Vst::ParamValue tmpValue = 0.;
-        int32 tmpOffset          = 0;
-        if (queue->getPoint(index, tmpOffset, tmpValue) != kResultOk)
-            return false;
+template <>
+double** get_channel_buffers<double>(Vst::AudioBusBuffers& bus)
+{
+    return bus.channelBuffers64;
+}
+
+//------------------------------------------------------------------------
+uint64 get_channel_mask(int32 numChannels)
+{
+    // Silence flags only exist for the first 64 channels.
+    return numChannels >= 64 ? ~uint64(0) : (uint64(1) << numChannels) - 1;
+}
 
-        offset = tmpOffset;
-        value  = tmpValue;
-        return true;
+//------------------------------------------------------------------------
+template <typename SampleType>
+void copy_channels(SampleType** in,
+                   SampleType* const* out,
+                   int32 numChannels,
+                   int32 numSamples)
+{
+    for (int32 channel = 0; channel < numChannels; ++channel)
+    {
+        if (in[channel] && out[channel] && in[channel] != out[channel])
+            std::memcpy(out[channel], in[channel], numSamples * sizeof(SampleType));
     }
+}
 
-    return false;
+//------------------------------------------------------------------------
+template <typename SampleType>
+void clear_channels(SampleType** in,
+                    SampleType* const* out,
+                    int32 numChannels,
+                    int32 numSamples)
+{
+    // With 'in' given, in-place channels are skipped because their input is
+    // known to be silent already. Pass null to clear every channel.
+    for (int32 channel = 0; channel < numChannels; ++channel)
+    {
+        if (out[channel] && (!in || in[channel] != out[channel]))
+            std::memset(out[channel], 0, numSamples * sizeof(SampleType));
+    }
 }
 
 //------------------------------------------------------------------------
-Vst::IParamValueQueue* findParamValueQueue(Vst::ParamID id, Vst::IParameterChanges* paramChanges)
+template <typename SampleType>
+void measure_channels(const dsp::gain_kernel<SampleType>& kernel,
+                      SampleType** in,
+                      int32 numChannels,
+                      int32 numSamples,
+                      float gain,
+                      dsp::level_meter& meter)
 {
-    Vst::IParamValueQueue* queue = nullptr;
-    if (!paramChanges)
-        return queue;
+    // For the fast paths which do not run a metered gain kernel.
+    for (int32 channel = 0; channel < numChannels; ++channel)
+    {
+        if (in[channel])
+            kernel.measure(in[channel], numSamples, gain, meter);
+    }
+}
 
-    const int32 numParamsChanges = paramChanges->getParameterCount();
-    for (int32 index = 0; index < numParamsChanges; index++)
+//------------------------------------------------------------------------
+dsp::process_path to_process_path(dsp::gain_curve::shape shape)
+{
+    switch (shape)
     {
-        if (auto* paramQueue = paramChanges->getParameterData(index))
-        {
-            if (paramQueue->getParameterId() == id)
-            {
-                queue = paramQueue;
-                break;
-            }
-        }
+        case dsp::gain_curve::shape::segments: return dsp::process_path::segments;
+        case dsp::gain_curve::shape::samples: return dsp::process_path::samples;
+        default: return dsp::process_path::constant;
     }
+}
+
+//------------------------------------------------------------------------
+int64 get_project_time(const Vst::ProcessContext* context)
+{
+    // Only a running transport defines where a block is.
+    if (context && (context->state & Vst::ProcessContext::kPlaying))
+        return context->projectTimeSamples;
+    return -1;
+}
+
+//------------------------------------------------------------------------
+// The latency of the offset lookahead, the furthest negative offsets reach.
+int get_max_offset_samples(double sample_rate)
+{
+    return dsp::get_offset_samples(dsp::kMaxAutomationOffset, sample_rate);
+}
+
+//------------------------------------------------------------------------
+// Set to a directory to capture the applied gain of every instance there.
+constexpr const char* kCaptureDirVariable = "HA_GAIN_CAPTURE_DIR";
+constexpr int kMaxLogFileAttempts         = 16;
+
+#if HA_PROFILING
+// Set to a directory to profile process() and write the histograms there on deactivation.
+constexpr const char* kProfileDirVariable = "HA_GAIN_PROFILE_DIR";
+#endif
+
+//------------------------------------------------------------------------
+std::string make_log_path(const std::string& directory,
+                          const char* prefix,
+                          const char* extension,
+                          int attempt)
+{
+    // e.g. gain-capture-20210314-153012-0.gacl, 'attempt' resolves name clashes
+    char stamp[32]        = {};
+    const std::time_t now = std::time(nullptr);
+    if (const std::tm* utc = std::gmtime(&now))
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", utc);
 
-    return queue;
+    return directory + "/" + prefix + "-" + stamp + "-" + std::to_string(attempt) + extension;
 }
 
 //------------------------------------------------------------------------
@@ -69,6 +150,8 @@ Vst::IParamValueQueue* findParamValueQueue(Vst::ParamID id, Vst::IParameterChang
 // GainAutomatorProcessor
 //------------------------------------------------------------------------
 GainAutomatorProcessor::GainAutomatorProcessor()
+: gainKernel32(&dsp::get_gain_kernel<float>(dsp::simd_level::scalar))
+, gainKernel64(&dsp::get_gain_kernel<double>(dsp::simd_level::scalar))
 {
     setControllerClass(kGainAutomatorControllerUID);
 }
@@ -85,8 +168,9 @@ tresult PLUGIN_API GainAutomatorProcessor::initialize(FUnknown* context)
         return result;
     }
 
-    addAudioInput(STR16("Stereo In"), Steinberg::Vst::SpeakerArr::kStereo);
-    addAudioOutput(STR16("Stereo Out"), Steinberg::Vst::SpeakerArr::kStereo);
+    // Stereo by default, any other arrangement is accepted in setBusArrangements.
+    addAudioInput(STR16("Main In"), Steinberg::Vst::SpeakerArr::kStereo);
+    addAudioOutput(STR16("Main Out"), Steinberg::Vst::SpeakerArr::kStereo);
 
     return kResultOk;
 }
@@ -94,88 +178,921 @@ tresult PLUGIN_API GainAutomatorProcessor::initialize(FUnknown* context)
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::terminate()
 {
+    if (workerPool)
+    {
+        dsp::worker_pool::release();
+        workerPool = nullptr;
+    }
+    closeCapture();
+#if HA_PROFILING
+    writeProfile();
+#endif
     return AudioEffect::terminate();
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::setActive(TBool state)
 {
+    // Start from the (restored) gain and bypass, no transition.
+    if (state)
+    {
+        applyRestoredState();
+        gainSmoother.reset(gainValue);
+        gainSegments.set_ramp(dsp::gain_ramp());
+        bypassFader.reset(bypassValue);
+
+        // The bus arrangement is final now.
+        const Vst::AudioBus* outputBus = getAudioOutput(0);
+        const int32 numChannels =
+            outputBus ? Vst::SpeakerArr::getChannelCount(outputBus->getArrangement()) : 0;
+        outputCeiling.setup(processSetup.sampleRate, numChannels, processSetup.maxSamplesPerBlock,
+                            processSetup.symbolicSampleSize == Vst::kSample64);
+        outputCeiling.set_ceiling(ceilingDecibel);
+        isCeilingActive = isCeilingOn.load(std::memory_order_relaxed);
+        isLookaheadActive = isLookaheadOn.load(std::memory_order_relaxed);
+        isFollowerActive  = isFollower.load(std::memory_order_relaxed);
+        inputDelay.setup(get_max_offset_samples(processSetup.sampleRate) +
+                             processSetup.maxSamplesPerBlock,
+                         numChannels, processSetup.maxSamplesPerBlock,
+                         processSetup.symbolicSampleSize == Vst::kSample64);
+        inputDelay.set_delay(getAudioDelay());
+        inputPositions.reset();
+        groupCursor = dsp::gain_bus::cursor();
+        gainDelay.reset();
+        paramDispatcher.collapseDelays();
+        setupLoudness();
+
+        if (processSetup.processMode == Vst::kOffline && !workerPool)
+            workerPool = &dsp::worker_pool::acquire();
+
+        if (const char* directory = std::getenv(kCaptureDirVariable))
+            openCapture(directory);
+
+#if HA_PROFILING
+        const char* profileDirectory = std::getenv(kProfileDirVariable);
+        isProfiling                  = profileDirectory != nullptr;
+        if (isProfiling)
+        {
+            profilePath = profileDirectory;
+            processProfile.reset(processSetup.sampleRate);
+        }
+#endif
+    }
+    else
+    {
+        closeCapture();
+#if HA_PROFILING
+        writeProfile();
+#endif
+    }
+
     return AudioEffect::setActive(state);
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::process(Vst::ProcessData& data)
 {
-    auto* queue = findParamValueQueue(kParamGainId, data.inputParameterChanges);
-    ptb::ramp_processor gainProc(
-        [queue, gainValue = gainValue](int index, int& offset, float& value) -> bool {
-            bool const res          = get_queue_value(queue, index, offset, value);
-            bool const isQueueEmpty = (!res) && (index == 0);
-            if (isQueueEmpty)
+#if HA_PROFILING
+    if (isProfiling)
+    {
+        const uint64 startCycles     = dsp::read_cycle_counter();
+        const dsp::process_path path = processBlock(data);
+        const uint64 cycles          = dsp::read_cycle_counter() - startCycles;
+        const int32 numPoints        = paramDispatcher.getTotalPointCount();
+        processProfile.record(cycles, data.numSamples, numPoints, path);
+        return kResultOk;
+    }
+#endif
+
+    processBlock(data);
+    return kResultOk;
+}
+
+//------------------------------------------------------------------------
+dsp::process_path GainAutomatorProcessor::processBlock(Vst::ProcessData& data)
+{
+    // A restored state first, the block's parameter changes come on top.
+    applyRestoredState();
+    paramDispatcher.dispatch(data.inputParameterChanges);
+    const int64 projectTime = get_project_time(data.processContext);
+
+    // The input delay line starts empty whenever the offset lookahead or
+    // the follower role is switched, the queued points fall due at once.
+    // Automating the offset only moves the gain points.
+    const bool isLookaheadRequested = isLookaheadOn.load(std::memory_order_relaxed);
+    const bool isFollowerRequested  = isFollower.load(std::memory_order_relaxed);
+    if (isLookaheadRequested != isLookaheadActive || isFollowerRequested != isFollowerActive)
+    {
+        isLookaheadActive = isLookaheadRequested;
+        isFollowerActive  = isFollowerRequested;
+        inputDelay.set_delay(getAudioDelay());
+        inputPositions.reset();
+        groupCursor = dsp::gain_bus::cursor();
+        paramDispatcher.collapseDelays();
+        gainDelay.collapse();
+    }
+
+    // All points but the gain's meet the audio they were written for, and
+    // so does the group's curve: it is keyed by where that audio was.
+    int numRuns                        = 0;
+    const dsp::position_run* inputRuns = inputPositions.process(
+        projectTime, data.numSamples, inputDelay.get_delay(), numRuns);
+    paramDispatcher.delayPoints(getAudioDelay(), data.numSamples, kParamGainId);
+
+    // Law and smoothing are not sample accurate, switching them mid-block is not a use case.
+    if (paramDispatcher.hasChanges(kParamGainLawId))
+        gainLaw = dsp::to_gain_law(paramDispatcher.getLastValue(kParamGainLawId, 0.f));
+    if (paramDispatcher.hasChanges(kParamSmoothingModeId))
+        smoothingMode =
+            dsp::to_smoothing_mode(paramDispatcher.getLastValue(kParamSmoothingModeId, 0.f));
+    if (paramDispatcher.hasChanges(kParamSmoothingTimeId))
+        smoothingTime =
+            dsp::to_smoothing_time(paramDispatcher.getLastValue(kParamSmoothingTimeId, 0.f));
+    if (paramDispatcher.hasChanges(kParamBypassFadeId))
+        bypassFadeTime =
+            paramDispatcher.getLastValue(kParamBypassFadeId, 0.f) * dsp::kMaxBypassFadeTime;
+    if (paramDispatcher.hasChanges(kParamGainGroupId))
+        gainGroup = dsp::to_gain_group(paramDispatcher.getLastValue(kParamGainGroupId, 0.f));
+    if (paramDispatcher.hasChanges(kParamGroupRoleId))
+        groupRole = dsp::to_group_role(paramDispatcher.getLastValue(kParamGroupRoleId, 0.f));
+    if (paramDispatcher.hasChanges(kParamGainGroupId) ||
+        paramDispatcher.hasChanges(kParamGroupRoleId))
+        isFollower.store(gainGroup >= 0 && groupRole == dsp::group_role::follower,
+                         std::memory_order_relaxed);
+    if (paramDispatcher.hasChanges(kParamCeilingId))
+    {
+        ceilingDecibel =
+            dsp::to_ceiling_decibel(paramDispatcher.getLastValue(kParamCeilingId, 0.f));
+        outputCeiling.set_ceiling(ceilingDecibel);
+    }
+    if (paramDispatcher.hasChanges(kParamCeilingOnId))
+        isCeilingOn.store(paramDispatcher.getLastValue(kParamCeilingOnId, 0.f) >= 0.5f,
+                          std::memory_order_relaxed);
+    if (paramDispatcher.hasChanges(kParamAutoGainId))
+        isAutoGain = paramDispatcher.getLastValue(kParamAutoGainId, 0.f) >= 0.5f;
+    if (paramDispatcher.hasChanges(kParamLoudnessTargetId))
+        loudnessTarget =
+            dsp::to_loudness_target(paramDispatcher.getLastValue(kParamLoudnessTargetId, 0.f));
+    if (paramDispatcher.hasChanges(kParamAutoGainSlewId))
+        autoGainSlew =
+            dsp::to_auto_gain_slew(paramDispatcher.getLastValue(kParamAutoGainSlewId, 0.f));
+    if (paramDispatcher.hasChanges(kParamAutomationOffsetId))
+        automationOffset = dsp::to_automation_offset(
+            paramDispatcher.getLastValue(kParamAutomationOffsetId, 0.5f));
+    if (paramDispatcher.hasChanges(kParamOffsetLookaheadId))
+        isLookaheadOn.store(paramDispatcher.getLastValue(kParamOffsetLookaheadId, 0.f) >= 0.5f,
+                            std::memory_order_relaxed);
+    gainSmoother.configure(smoothingMode, smoothingTime);
+    bypassFader.configure(dsp::smoothing_mode::linear, bypassFadeTime);
+
+    // Bypass is sample accurate. The crossfade in * (g + (1 - g) * bypass)
+    // is a gain curve, so it costs no extra pass. Fully bypassed, no curve
+    // is computed at all and the audio is passed through.
+    const bool isBypassSettled =
+        bypassFader.process(paramDispatcher.getPoints(kParamBypassId),
+                            paramDispatcher.getPointCount(kParamBypassId), data.numSamples,
+                            simdLevel);
+    bypassValue           = bypassFader.get_target();
+    const bool isBypassed = isBypassSettled && bypassFader.get_value() >= 1.f;
+    const bool isLeader   = gainGroup >= 0 && groupRole == dsp::group_role::leader;
+    buildChannelGains(data.numSamples);
+
+    // The delay line starts empty whenever the ceiling is switched. Bypassed,
+    // it only delays and releases what it was limiting.
+    const bool isCeilingRequested = isCeilingOn.load(std::memory_order_relaxed);
+    if (isCeilingRequested != isCeilingActive)
+    {
+        outputCeiling.reset();
+        isCeilingActive = isCeilingRequested;
+    }
+    isLimiting = !isBypassed;
+
+    // The integrated loudness restarts with the transport, e.g. a new pass over the mix.
+    const bool isPlaying = projectTime >= 0;
+    if (isPlaying && !wasPlaying)
+        outputLoudness.reset();
+    wasPlaying = isPlaying;
+
+    if (isBypassed && !isLeader)
+    {
+        followGain();
+        gainCurve.build_constant(1.f, data.numSamples);
+    }
+    else
+    {
+        // A bypassed leader keeps driving its group.
+        buildGainCurve(data.numSamples);
+        linkGainGroup(inputRuns, numRuns, data.numSamples);
+        applyAutoGain(data.numSamples);
+        if (isBypassed)
+        {
+            gainCurve.build_constant(1.f, data.numSamples);
+        }
+        else if (!isBypassSettled)
+        {
+            gainCurve.mix_to_unity(bypassFader.get_samples());
+            channelGains.mix_to_unity(bypassFader.get_samples());
+        }
+        else if (bypassFader.get_value() > 0.f)
+        {
+            gainCurve.mix_to_unity(bypassFader.get_value());
+            channelGains.mix_to_unity(bypassFader.get_value());
+        }
+    }
+
+    // Oversized blocks (a host error) have no scratch space, they only get the curve.
+    const auto scratchSize = static_cast<size_t>(dsp::kChannelGainsScratch) * data.numSamples;
+    hasChannelGains =
+        !isBypassed && !channelGains.is_unity() && scratchSize <= channelScratch.size();
+
+    const float gain = dsp::to_gain(gainLaw, gainValue) * groupGain * autoGain.get_gain();
+    appliedGain      = gain + (1.f - gain) * bypassFader.get_value();
+
+    // One bus pair, see setBusArrangements.
+    if (!data.outputs || !data.inputs || data.numInputs < 1 || data.numOutputs < 1)
+    {
+        captureGain(projectTime, data.numSamples, nullptr);
+        return dsp::process_path::idle;
+    }
+
+    dsp::level_meter* meter = isMeterAccepted.load(std::memory_order_relaxed)
+                                  ? &meterCollector.get_meter()
+                                  : nullptr;
+    const bool is64 = data.symbolicSampleSize == Vst::kSample64;
+
+    // Processing may be in place, the input is measured before.
+    if (isAutoGain)
+    {
+        if (is64)
+            measureLoudness<Vst::Sample64>(data.inputs[0], data.numSamples, inputLoudness);
+        else
+            measureLoudness<Vst::Sample32>(data.inputs[0], data.numSamples, inputLoudness);
+    }
+
+    const dsp::process_path path = is64
+                                       ? processAudio<Vst::Sample64>(data, *gainKernel64, meter)
+                                       : processAudio<Vst::Sample32>(data, *gainKernel32, meter);
+    captureGain(projectTime, data.numSamples,
+                isCeilingActive ? outputCeiling.get_gains() : nullptr);
+
+    if (meter)
+    {
+        if (is64)
+            measureLoudness<Vst::Sample64>(data.outputs[0], data.numSamples, outputLoudness);
+        else
+            measureLoudness<Vst::Sample32>(data.outputs[0], data.numSamples, outputLoudness);
+        meterCollector.end_block(data.numSamples, appliedGain, outputLoudness.get_levels(),
+                                 meterQueue);
+    }
+
+    return path;
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::buildGainCurve(int32 numSamples)
+{
+    // Without an offset the points come straight from the dispatcher.
+    int32 numGainPoints                     = 0;
+    const dsp::automation_point* gainPoints = gainDelay.process(
+        paramDispatcher.getPoints(kParamGainId), paramDispatcher.getPointCount(kParamGainId),
+        getGainDelay(), numSamples, numGainPoints);
+    if (gainSmoother.is_enabled())
+    {
+        const bool isSettled =
+            gainSmoother.process(gainPoints, numGainPoints, numSamples, simdLevel);
+        gainValue = gainSmoother.get_value();
+        if (isSettled)
+        {
+            gainSegments.assign(nullptr, 0, numSamples, gainValue);
+            gainCurve.build(gainSegments, gainLaw, simdLevel);
+        }
+        else
+        {
+            gainCurve.build(gainSmoother.get_samples(), numSamples, gainLaw, simdLevel);
+        }
+    }
+    else
+    {
+        gainSegments.assign(gainPoints, numGainPoints, numSamples, gainValue);
+        gainValue = gainSegments.get_last_value();
+        gainCurve.build(gainSegments, gainLaw, simdLevel);
+
+        // Switching the smoothing on continues from here.
+        gainSmoother.reset(gainValue);
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::buildChannelGains(int32 numSamples)
+{
+    static_assert(kNumTrims == dsp::kNumTrimChannels, "one trim parameter per trim channel");
+    static_assert(kParamSideGainId - kParamTrimId == dsp::channel_gains::kSide,
+                  "channel parameter ids in the order of dsp::channel_gains::param");
+
+    const dsp::automation_point* points[dsp::channel_gains::kNumParams];
+    int numPoints[dsp::channel_gains::kNumParams];
+    for (int param = 0; param < dsp::channel_gains::kNumParams; ++param)
+    {
+        points[param]    = paramDispatcher.getPoints(kParamTrimId + param);
+        numPoints[param] = paramDispatcher.getPointCount(kParamTrimId + param);
+    }
+    channelGains.build(points, numPoints, numSamples);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::followGain()
+{
+    // While bypassed the gain jumps to its latest value, nobody hears it.
+    gainValue = paramDispatcher.getLastValue(kParamGainId, gainValue);
+    gainSmoother.reset(gainValue);
+    gainSegments.set_ramp(dsp::gain_ramp());
+    gainDelay.reset();
+}
+
+//------------------------------------------------------------------------
+int GainAutomatorProcessor::getAudioDelay() const
+{
+    int delay = 0;
+    if (isLookaheadActive)
+        delay += get_max_offset_samples(processSetup.sampleRate);
+    if (isFollowerActive)
+        delay += processSetup.maxSamplesPerBlock;
+    return delay;
+}
+
+//------------------------------------------------------------------------
+int GainAutomatorProcessor::getGainDelay() const
+{
+    // The gain points are late by the audio delay plus the offset. Without
+    // the lookahead, negative offsets have nothing to move into.
+    const int offset    = dsp::get_offset_samples(automationOffset, processSetup.sampleRate);
+    const int lookahead = isLookaheadActive ? get_max_offset_samples(processSetup.sampleRate) : 0;
+    return getAudioDelay() + std::max(offset, -lookahead);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::linkGainGroup(const dsp::position_run* runs,
+                                           int numRuns,
+                                           int32 numSamples)
+{
+    groupGain = 1.f;
+    if (gainGroup < 0)
+        return;
+
+    // Leader and followers match their curves by the project time of the
+    // audio they process, one run per locate or loop within the block.
+    // Without a playing transport there is none, followers hold the
+    // leader's latest gain then.
+    const bool isOversized = numSamples > static_cast<int32>(groupGains.size());
+    auto& gainBus          = dsp::gain_bus::get_instance();
+    if (groupRole == dsp::group_role::leader)
+    {
+        for (int index = 0; index < numRuns; ++index)
+        {
+            const int64 position = isOversized ? dsp::gain_bus::kNoPosition : runs[index].position;
+            gainBus.publish(gainGroup, position, gainCurve, runs[index].offset, runs[index].length);
+        }
+        return;
+    }
+
+    // The follower's own gain is its offset to the leader.
+    if (isOversized || numRuns <= 1)
+    {
+        const bool hasPosition = !isOversized && numRuns == 1;
+        const int64 position   = hasPosition ? runs[0].position : dsp::gain_bus::kNoPosition;
+        const auto block =
+            gainBus.read(gainGroup, position, numSamples, groupGains.data(), groupCursor);
+        groupGain = block.is_constant ? groupGains[0] : groupGains[numSamples - 1];
+        if (block.is_constant)
+            gainCurve.multiply(groupGain);
+        else
+            gainCurve.multiply(groupGains.data());
+        return;
+    }
+
+    for (int index = 0; index < numRuns; ++index)
+    {
+        float* gains     = groupGains.data() + runs[index].offset;
+        const auto block = gainBus.read(gainGroup, runs[index].position, runs[index].length,
+                                        gains, groupCursor);
+        if (block.is_constant)
+            std::fill(gains + 1, gains + runs[index].length, gains[0]);
+    }
+    groupGain = groupGains[numSamples - 1];
+    gainCurve.multiply(groupGains.data());
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::applyAutoGain(int32 numSamples)
+{
+    // Open loop: the gain follows the input's short-term loudness up to the
+    // previous block, so it cannot chase its own output. Switched off, it
+    // returns to 0 dB with the same slew.
+    if (isAutoGain)
+        autoGain.process(inputLoudness.get_levels().short_term, loudnessTarget, autoGainSlew,
+                         numSamples);
+    else if (autoGain.get_decibel() != 0.f)
+        autoGain.release(autoGainSlew, numSamples);
+    else
+        return;
+
+    const bool isOversized = numSamples > static_cast<int32>(autoGains.size());
+    if (autoGain.is_moving() && !isOversized)
+    {
+        autoGain.render(autoGains.data(), numSamples);
+        gainCurve.multiply(autoGains.data());
+    }
+    else
+    {
+        gainCurve.multiply(autoGain.get_gain());
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::setupLoudness()
+{
+    // Channel weights of ITU-R BS.1770 by speaker: none for the LFE, more for the surrounds.
+    const Vst::AudioBus* outputBus = getAudioOutput(0);
+    const Vst::SpeakerArrangement arrangement =
+        outputBus ? outputBus->getArrangement() : Vst::SpeakerArr::kEmpty;
+    const int32 numChannels = Vst::SpeakerArr::getChannelCount(arrangement);
+
+    for (dsp::loudness_meter* loudness : {&inputLoudness, &outputLoudness})
+    {
+        loudness->setup(processSetup.sampleRate, numChannels, simdLevel);
+        for (int32 channel = 0; channel < numChannels; ++channel)
+        {
+            float weight = 1.f;
+            switch (Vst::SpeakerArr::getSpeaker(arrangement, channel))
             {
-                // If queue is empty, simply initialise with the last cached gainValue.
-                offset = 0;
-                value  = gainValue;
-                return true;
+                case Vst::kSpeakerLfe:
+                case Vst::kSpeakerLfe2: weight = 0.f; break;
+                case Vst::kSpeakerLs:
+                case Vst::kSpeakerRs:
+                case Vst::kSpeakerSl:
+                case Vst::kSpeakerSr: weight = 1.41f; break;
+                default: break;
             }
+            loudness->set_channel_weight(channel, weight);
+        }
+    }
+    autoGain.setup(processSetup.sampleRate);
+    autoGain.reset(autoGain.get_decibel());
+}
 
-            return res;
-        });
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::openCapture(const char* directory)
+{
+    closeCapture();
+    captureEncoder.setup(processSetup.sampleRate, processSetup.maxSamplesPerBlock,
+                         dsp::get_ceiling_latency(processSetup.sampleRate));
+    captureEncoder.reset();
+    capturePositions.reset();
 
-    if (!data.outputs || !data.inputs)
-        return kResultOk;
+    // One file per activation. Failing to create one leaves capturing off.
+    for (int attempt = 0; attempt < kMaxLogFileAttempts; ++attempt)
+    {
+        const std::string path = make_log_path(directory, "gain-capture", ".gacl", attempt);
+        if (captureWriter.open(path, processSetup.sampleRate))
+            break;
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::closeCapture()
+{
+    if (!captureWriter.is_open())
+        return;
+
+    captureEncoder.flush(captureWriter.get_queue());
+    captureWriter.close();
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::captureGain(int64 projectTime,
+                                         int32 numSamples,
+                                         const float* ceilingGains)
+{
+    if (!captureWriter.is_open())
+        return;
+
+    // The gain as applied to the output, a few records per block at most,
+    // written by another thread. The output is late by the input delay and
+    // the ceiling's lookahead, the records carry the project time of the
+    // audio they were processed from.
+    const int ceilingDelay = isCeilingActive ? outputCeiling.get_latency() : 0;
+    int numRuns            = 0;
+    const dsp::position_run* runs =
+        capturePositions.process(projectTime, numSamples, inputDelay.get_delay() + ceilingDelay,
+                                 numRuns);
+    captureEncoder.set_delay(ceilingDelay);
+    captureEncoder.set_channel_gains(hasChannelGains);
+    captureEncoder.add(gainCurve, ceilingGains, runs, numRuns, captureWriter.get_queue());
+}
+
+#if HA_PROFILING
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::writeProfile()
+{
+    if (!isProfiling)
+        return;
+
+    dsp::profile_snapshot snapshot;
+    processProfile.read(snapshot);
+    isProfiling = false;
+    if (snapshot.num_calls == 0)
+        return;
+
+    for (int attempt = 0; attempt < kMaxLogFileAttempts; ++attempt)
+    {
+        if (dsp::write_profile(make_log_path(profilePath, "gain-profile", ".gapr", attempt),
+                               snapshot))
+            break;
+    }
+}
+#endif
 
-    gainValue                       = gainProc.get_value();
+//------------------------------------------------------------------------
+template <typename SampleType>
+dsp::process_path GainAutomatorProcessor::processAudio(Vst::ProcessData& data,
+                                                       const dsp::gain_kernel<SampleType>& kernel,
+                                                       dsp::level_meter* meter)
+{
+    // The main bus is the only one, see setBusArrangements.
+    const int32 numSamples          = data.numSamples;
     Vst::AudioBusBuffers& outputBus = data.outputs[0];
     Vst::AudioBusBuffers& inputBus  = data.inputs[0];
-    for (int i = 0; i < data.numSamples; ++i)
-    {
-        if (outputBus.channelBuffers32[kIndexL] && inputBus.channelBuffers32[kIndexL])
-            outputBus.channelBuffers32[kIndexL][i] =
-                inputBus.channelBuffers32[kIndexL][i] * gainValue;
+    const int32 numChannels         = std::min(outputBus.numChannels, inputBus.numChannels);
+    SampleType** in                 = get_channel_buffers<SampleType>(inputBus);
+    SampleType** out                = get_channel_buffers<SampleType>(outputBus);
+
+    const uint64 channelMask = get_channel_mask(numChannels);
+    uint64 inputSilence      = inputBus.silenceFlags & channelMask;
 
-        if (outputBus.numChannels > 1)
+    // The offset lookahead and the follower role delay the audio in front
+    // of the gain stage.
+    if (inputDelay.get_delay() > 0)
+    {
+        if (SampleType** delayed = inputDelay.process<SampleType>(in, numChannels, numSamples))
         {
-            if (outputBus.channelBuffers32[kIndexR] && inputBus.channelBuffers32[kIndexR])
-                outputBus.channelBuffers32[kIndexR][i] =
-                    inputBus.channelBuffers32[kIndexR][i] * gainValue;
+            in           = delayed;
+            inputSilence = 0; // the delay line may still sound
         }
+    }
+
+    // With the ceiling on, the gain stage writes into its delay lines.
+    SampleType* const* ceilingInputs =
+        isCeilingActive ? outputCeiling.get_inputs<SampleType>(numChannels, numSamples)
+                        : nullptr;
+    if (!ceilingInputs)
+        return applyGainStage(kernel, in, out, numChannels, numSamples, inputSilence, meter,
+                              outputBus.silenceFlags);
 
-        gainValue = gainProc.advance();
+    // Always metered, the output peak decides whether there is anything to limit.
+    dsp::level_meter stageMeter;
+    uint64 stageSilence = 0;
+    const dsp::process_path path =
+        applyGainStage(kernel, in, ceilingInputs, numChannels, numSamples, inputSilence,
+                       &stageMeter, stageSilence);
+
+    const bool isStageSilent  = numChannels <= 64 && stageSilence == channelMask;
+    const bool isOutputSilent = outputCeiling.process(out, numChannels, numSamples,
+                                                      isStageSilent, isLimiting, stageMeter);
+    outputBus.silenceFlags    = isOutputSilent ? channelMask : 0;
+    if (meter)
+        meter->add(stageMeter);
+    return path;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void GainAutomatorProcessor::measureLoudness(Vst::AudioBusBuffers& bus,
+                                             int32 numSamples,
+                                             dsp::loudness_meter& loudness)
+{
+    // The meter's channels are the bus's speakers.
+    const SampleType* const* channels = get_channel_buffers<SampleType>(bus);
+    if (channels)
+        loudness.process(channels, bus.numChannels, numSamples);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+dsp::process_path GainAutomatorProcessor::applyGainStage(const dsp::gain_kernel<SampleType>& kernel,
+                                                         SampleType** in,
+                                                         SampleType* const* out,
+                                                         int32 numChannels,
+                                                         int32 numSamples,
+                                                         uint64 inputSilence,
+                                                         dsp::level_meter* meter,
+                                                         uint64& outputSilence)
+{
+    const bool isConstant = gainCurve.is_constant();
+    const float gain      = gainCurve.get_constant();
+
+    // Silent channels stay silent whatever the gain is.
+    const uint64 channelMask = get_channel_mask(numChannels);
+    const bool isInputSilent = numChannels <= 64 && inputSilence == channelMask;
+    if (isInputSilent)
+    {
+        if (meter)
+            meter->num_samples += numChannels * numSamples;
+        clear_channels<SampleType>(in, out, numChannels, numSamples);
+        outputSilence = channelMask;
+        return dsp::process_path::silent;
     }
 
-    return kResultOk;
+    if (isConstant && gain == 1.f && !hasChannelGains)
+    {
+        // Unity gain: nothing to do in place, a plain copy otherwise.
+        if (meter)
+            measure_channels<SampleType>(kernel, in, numChannels, numSamples, gain, *meter);
+        copy_channels<SampleType>(in, out, numChannels, numSamples);
+        outputSilence = inputSilence;
+        return dsp::process_path::unity;
+    }
+
+    if (isConstant && gain == 0.f)
+    {
+        if (meter)
+            measure_channels<SampleType>(kernel, in, numChannels, numSamples, gain, *meter);
+        clear_channels<SampleType>(nullptr, out, numChannels, numSamples);
+        outputSilence = channelMask;
+        return dsp::process_path::mute;
+    }
+
+    if (hasChannelGains)
+    {
+        dsp::apply_channel_gains(kernel, gainCurve, channelGains, in, out, numChannels,
+                                 channelScratch.data(), meter);
+
+        // Mid/side mixes a silent channel of the pair with the other one.
+        const uint64 pairMask = numChannels >= 2 ? 3 : 0;
+        if (channelGains.has_mid_side() && (inputSilence & pairMask) != pairMask)
+            outputSilence = inputSilence & ~pairMask;
+        else
+            outputSilence = inputSilence;
+        return to_process_path(gainCurve.get_shape());
+    }
+
+    // The host may switch to real-time processing without terminating.
+    const bool isParallel = processSetup.processMode == Vst::kOffline && workerPool;
+    if (isParallel)
+        dsp::apply_gain_curve_parallel(kernel, gainCurve, in, out, numChannels, meter,
+                                       *workerPool);
+    else
+        dsp::apply_gain_curve(kernel, gainCurve, in, out, numChannels, meter);
+    outputSilence = inputSilence;
+    return to_process_path(gainCurve.get_shape());
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorProcessor::setBusArrangements(Vst::SpeakerArrangement* inputs,
+                                                              int32 numIns,
+                                                              Vst::SpeakerArrangement* outputs,
+                                                              int32 numOuts)
+{
+    // One bus pair of any speaker arrangement, as long as input and output match.
+    if (numIns != 1 || numOuts != 1)
+        return kResultFalse;
+
+    const int32 numChannels = Vst::SpeakerArr::getChannelCount(inputs[0]);
+    if (numChannels == 0 || numChannels != Vst::SpeakerArr::getChannelCount(outputs[0]))
+        return kResultFalse;
+
+    return AudioEffect::setBusArrangements(inputs, numIns, outputs, numOuts);
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::setupProcessing(Vst::ProcessSetup& newSetup)
 {
+    simdLevel    = dsp::detect_simd_level();
+    gainKernel32 = &dsp::get_gain_kernel<Vst::Sample32>(simdLevel);
+    gainKernel64 = &dsp::get_gain_kernel<Vst::Sample64>(simdLevel);
+
+    paramDispatcher.setup(newSetup.maxSamplesPerBlock);
+
+    // The largest audio delay is the offset lookahead plus a follower's block.
+    const int maxOffset = get_max_offset_samples(newSetup.sampleRate);
+    paramDispatcher.setupDelays(maxOffset + newSetup.maxSamplesPerBlock);
+    gainDelay.setup(2 * maxOffset + newSetup.maxSamplesPerBlock, newSetup.maxSamplesPerBlock);
+
+    gainSegments.reserve(newSetup.maxSamplesPerBlock);
+    gainCurve.reserve(newSetup.maxSamplesPerBlock);
+    channelGains.setup(newSetup.maxSamplesPerBlock);
+    channelScratch.resize(static_cast<size_t>(dsp::kChannelGainsScratch) *
+                          std::max(newSetup.maxSamplesPerBlock, 0));
+    meterCollector.setup(newSetup.sampleRate);
+    gainSmoother.setup(newSetup.sampleRate, newSetup.maxSamplesPerBlock);
+    autoGains.resize(std::max(newSetup.maxSamplesPerBlock, 1));
+    bypassFader.setup(newSetup.sampleRate, newSetup.maxSamplesPerBlock);
+    groupGains.resize(std::max(newSetup.maxSamplesPerBlock, 1));
+
     return AudioEffect::setupProcessing(newSetup);
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorProcessor::connect(Vst::IConnectionPoint* other)
+{
+    tresult result = AudioEffect::connect(other);
+    if (result != kResultOk)
+        return result;
+
+    // Offer the meter queue, the controller answers if it can poll it.
+    if (IPtr<Vst::IMessage> message = owned(allocateMessage()))
+    {
+        message->setMessageID(MeterLink::kQueueMessageId);
+        MeterLink::write(*message->getAttributes(), &meterQueue);
+#if HA_PROFILING
+        MeterLink::writeProfile(*message->getAttributes(), &processProfile);
+#endif
+        sendMessage(message);
+    }
+    return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorProcessor::disconnect(Vst::IConnectionPoint* other)
+{
+    isMeterAccepted.store(false);
+    return AudioEffect::disconnect(other);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API GainAutomatorProcessor::notify(Vst::IMessage* message)
+{
+    if (message && FIDStringsEqual(message->getMessageID(), MeterLink::kAcceptedMessageId))
+    {
+        isMeterAccepted.store(true);
+        return kResultOk;
+    }
+    if (message && FIDStringsEqual(message->getMessageID(), kCeilingMessageId))
+    {
+        int64 isOn = 0;
+        if (message->getAttributes()->getInt(kCeilingOnAttr, isOn) == kResultOk)
+            isCeilingOn.store(isOn != 0);
+        return kResultOk;
+    }
+    if (message && FIDStringsEqual(message->getMessageID(), kLookaheadMessageId))
+    {
+        int64 isOn = 0;
+        if (message->getAttributes()->getInt(kLookaheadOnAttr, isOn) == kResultOk)
+            isLookaheadOn.store(isOn != 0);
+        return kResultOk;
+    }
+    if (message && FIDStringsEqual(message->getMessageID(), kFollowerMessageId))
+    {
+        int64 isOn = 0;
+        if (message->getAttributes()->getInt(kFollowerOnAttr, isOn) == kResultOk)
+            isFollower.store(isOn != 0);
+        return kResultOk;
+    }
+    return AudioEffect::notify(message);
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::canProcessSampleSize(int32 symbolicSampleSize)
 {
-    if (symbolicSampleSize == Vst::kSample32)
+    if (symbolicSampleSize == Vst::kSample32 || symbolicSampleSize == Vst::kSample64)
         return kResultTrue;
 
     return kResultFalse;
 }
 
+//------------------------------------------------------------------------
+uint32 PLUGIN_API GainAutomatorProcessor::getLatencySamples()
+{
+    // Known before the first activation, it only depends on the setup.
+    int latency = 0;
+    if (isCeilingOn.load(std::memory_order_relaxed))
+        latency += dsp::get_ceiling_latency(processSetup.sampleRate);
+    if (isLookaheadOn.load(std::memory_order_relaxed))
+        latency += get_max_offset_samples(processSetup.sampleRate);
+    if (isFollower.load(std::memory_order_relaxed))
+        latency += processSetup.maxSamplesPerBlock;
+    return static_cast<uint32>(latency);
+}
+
+//------------------------------------------------------------------------
+uint32 PLUGIN_API GainAutomatorProcessor::getTailSamples()
+{
+    // A gain has no tail, bypassed or not.
+    return Vst::kNoTail;
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::setState(IBStream* state)
 {
-    IBStreamer streamer(state, kLittleEndian);
+    ParamState paramState;
+    const tresult result = paramState.read(state);
+    if (result != kResultOk)
+        return result;
+
+    // The switches which change the latency are read by getLatencySamples
+    // right away, the host asks for it after the restart.
+    const auto& values = paramState.values;
+    isFollower.store(dsp::to_gain_group(values[kParamGainGroupId]) >= 0 &&
+                     dsp::to_group_role(values[kParamGroupRoleId]) == dsp::group_role::follower);
+    isCeilingOn.store(values[kParamCeilingOnId] >= 0.5);
+    isLookaheadOn.store(values[kParamOffsetLookaheadId] >= 0.5);
 
+    lockRestoredState();
+    restoredState = paramState;
+    restoreStatus.store(kRestorePending, std::memory_order_release);
     return kResultOk;
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API GainAutomatorProcessor::getState(IBStream* state)
 {
-    IBStreamer streamer(state, kLittleEndian);
+    // A state not applied yet is the current one.
+    if (lockRestoredState())
+    {
+        const ParamState paramState = restoredState;
+        restoreStatus.store(kRestorePending, std::memory_order_release);
+        return paramState.write(state);
+    }
+    restoreStatus.store(kRestoreNone, std::memory_order_release);
 
-    return kResultOk;
+    ParamState paramState;
+    paramState.values[kParamGainId]          = gainValue;
+    paramState.values[kParamGainLawId]       = dsp::to_normalized(gainLaw);
+    paramState.values[kParamSmoothingModeId] = dsp::to_normalized(smoothingMode);
+    paramState.values[kParamSmoothingTimeId] = dsp::to_normalized_smoothing_time(smoothingTime);
+    paramState.values[kParamBypassId]        = bypassValue;
+    paramState.values[kParamBypassFadeId]    = bypassFadeTime / dsp::kMaxBypassFadeTime;
+    paramState.values[kParamGainGroupId]     = dsp::to_normalized_gain_group(gainGroup);
+    paramState.values[kParamGroupRoleId]     = dsp::to_normalized(groupRole);
+    for (int param = 0; param < dsp::channel_gains::kNumParams; ++param)
+        paramState.values[kParamTrimId + param] = channelGains.get_value(param);
+    paramState.values[kParamCeilingId]        = dsp::to_normalized_ceiling(ceilingDecibel);
+    paramState.values[kParamCeilingOnId]      = isCeilingOn.load() ? 1. : 0.;
+    paramState.values[kParamAutoGainId]       = isAutoGain ? 1. : 0.;
+    paramState.values[kParamLoudnessTargetId] = dsp::to_normalized_loudness_target(loudnessTarget);
+    paramState.values[kParamAutoGainSlewId]   = dsp::to_normalized_auto_gain_slew(autoGainSlew);
+    paramState.values[kParamAutomationOffsetId] =
+        dsp::to_normalized_automation_offset(automationOffset);
+    paramState.values[kParamOffsetLookaheadId] = isLookaheadOn.load() ? 1. : 0.;
+
+    return paramState.write(state);
+}
+
+//------------------------------------------------------------------------
+bool GainAutomatorProcessor::lockRestoredState()
+{
+    // Waits while the audio thread applies a state, which never blocks.
+    int status = restoreStatus.load(std::memory_order_acquire);
+    while (true)
+    {
+        if (status == kRestoreWriting || status == kRestoreApplying)
+        {
+            std::this_thread::yield();
+            status = restoreStatus.load(std::memory_order_acquire);
+            continue;
+        }
+        if (restoreStatus.compare_exchange_weak(status, kRestoreWriting,
+                                                std::memory_order_acquire))
+            return status == kRestorePending;
+    }
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::applyRestoredState()
+{
+    // Skipped while setState is still writing, the next block applies it.
+    int status = kRestorePending;
+    if (!restoreStatus.compare_exchange_strong(status, kRestoreApplying,
+                                               std::memory_order_acquire))
+        return;
+
+    applyState(restoredState);
+    restoreStatus.store(kRestoreNone, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void GainAutomatorProcessor::applyState(const ParamState& paramState)
+{
+    const auto& values = paramState.values;
+    gainValue          = static_cast<float>(values[kParamGainId]);
+    gainLaw            = dsp::to_gain_law(values[kParamGainLawId]);
+    smoothingMode      = dsp::to_smoothing_mode(values[kParamSmoothingModeId]);
+    smoothingTime      = dsp::to_smoothing_time(values[kParamSmoothingTimeId]);
+    bypassValue        = static_cast<float>(values[kParamBypassId]);
+    bypassFadeTime     = static_cast<float>(values[kParamBypassFadeId]) * dsp::kMaxBypassFadeTime;
+    gainGroup          = dsp::to_gain_group(values[kParamGainGroupId]);
+    groupRole          = dsp::to_group_role(values[kParamGroupRoleId]);
+
+    for (int param = 0; param < dsp::channel_gains::kNumParams; ++param)
+        channelGains.set_value(param, static_cast<float>(values[kParamTrimId + param]));
+
+    ceilingDecibel = dsp::to_ceiling_decibel(values[kParamCeilingId]);
+    outputCeiling.set_ceiling(ceilingDecibel);
+
+    isAutoGain     = values[kParamAutoGainId] >= 0.5;
+    loudnessTarget = dsp::to_loudness_target(values[kParamLoudnessTargetId]);
+    autoGainSlew   = dsp::to_auto_gain_slew(values[kParamAutoGainSlewId]);
+
+    automationOffset = dsp::to_automation_offset(values[kParamAutomationOffsetId]);
 }
 
 //------------------------------------------------------------------------
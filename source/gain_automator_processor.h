@@ -4,7 +4,26 @@
 
 #pragma once
 
+#include "gain_automator_automation_delay.h"
+#include "gain_automator_capture.h"
+#include "gain_automator_capture_writer.h"
+#include "gain_automator_ceiling.h"
+#include "gain_automator_channel_gains.h"
+#include "gain_automator_gain_bus.h"
+#include "gain_automator_gain_curve.h"
+#include "gain_automator_kernel.h"
+#include "gain_automator_loudness.h"
+#include "gain_automator_meter.h"
+#include "gain_automator_param_dispatch.h"
+#include "gain_automator_profile.h"
+#include "gain_automator_segments.h"
+#include "gain_automator_smoother.h"
+#include "gain_automator_state.h"
+#include "gain_automator_worker_pool.h"
 #include "public.sdk/source/vst/vstaudioeffect.h"
+#include <atomic>
+#include <string>
+#include <vector>
 
 namespace ha {
 
@@ -33,16 +52,173 @@ public:
     Steinberg::tresult PLUGIN_API setupProcessing(Steinberg::Vst::ProcessSetup& newSetup)
         SMTG_OVERRIDE;
 
+    Steinberg::tresult PLUGIN_API setBusArrangements(Steinberg::Vst::SpeakerArrangement* inputs,
+                                                     Steinberg::int32 numIns,
+                                                     Steinberg::Vst::SpeakerArrangement* outputs,
+                                                     Steinberg::int32 numOuts) SMTG_OVERRIDE;
+
     Steinberg::tresult PLUGIN_API canProcessSampleSize(Steinberg::int32 symbolicSampleSize)
         SMTG_OVERRIDE;
+    Steinberg::uint32 PLUGIN_API getLatencySamples() SMTG_OVERRIDE;
+    Steinberg::uint32 PLUGIN_API getTailSamples() SMTG_OVERRIDE;
 
     Steinberg::tresult PLUGIN_API process(Steinberg::Vst::ProcessData& data) SMTG_OVERRIDE;
     Steinberg::tresult PLUGIN_API setState(Steinberg::IBStream* state) SMTG_OVERRIDE;
     Steinberg::tresult PLUGIN_API getState(Steinberg::IBStream* state) SMTG_OVERRIDE;
 
+    // ComponentBase overrides:
+    Steinberg::tresult PLUGIN_API connect(Steinberg::Vst::IConnectionPoint* other) SMTG_OVERRIDE;
+    Steinberg::tresult PLUGIN_API disconnect(Steinberg::Vst::IConnectionPoint* other)
+        SMTG_OVERRIDE;
+    Steinberg::tresult PLUGIN_API notify(Steinberg::Vst::IMessage* message) SMTG_OVERRIDE;
+
     //--------------------------------------------------------------------
 protected:
     float gainValue = 1.;
+    void buildGainCurve(Steinberg::int32 numSamples);
+    void buildChannelGains(Steinberg::int32 numSamples);
+    void followGain();
+    void linkGainGroup(const dsp::position_run* runs, int numRuns, Steinberg::int32 numSamples);
+    void applyAutoGain(Steinberg::int32 numSamples);
+    int getAudioDelay() const;
+    int getGainDelay() const;
+    void setupLoudness();
+    void openCapture(const char* directory);
+    void closeCapture();
+    void captureGain(Steinberg::int64 projectTime,
+                     Steinberg::int32 numSamples,
+                     const float* ceilingGains);
+
+    dsp::process_path processBlock(Steinberg::Vst::ProcessData& data);
+    void applyState(const ParamState& paramState);
+    void applyRestoredState();
+    bool lockRestoredState();
+
+    template <typename SampleType>
+    dsp::process_path processAudio(Steinberg::Vst::ProcessData& data,
+                                   const dsp::gain_kernel<SampleType>& kernel,
+                                   dsp::level_meter* meter);
+    template <typename SampleType>
+    void measureLoudness(Steinberg::Vst::AudioBusBuffers& bus,
+                         Steinberg::int32 numSamples,
+                         dsp::loudness_meter& loudness);
+    template <typename SampleType>
+    dsp::process_path applyGainStage(const dsp::gain_kernel<SampleType>& kernel,
+                                     SampleType** in,
+                                     SampleType* const* out,
+                                     Steinberg::int32 numChannels,
+                                     Steinberg::int32 numSamples,
+                                     Steinberg::uint64 inputSilence,
+                                     dsp::level_meter* meter,
+                                     Steinberg::uint64& outputSilence);
+
+    dsp::gain_law gainLaw             = dsp::gain_law::decibel;
+    dsp::smoothing_mode smoothingMode = dsp::smoothing_mode::off;
+    float smoothingTime               = dsp::kDefaultSmoothingTime;
+    ParamChangeDispatcher paramDispatcher;
+    dsp::gain_segments gainSegments;
+    dsp::gain_curve gainCurve;
+    dsp::gain_smoother gainSmoother;
+
+    // The bypass crossfade is folded into the gain curve, see process.
+    dsp::gain_smoother bypassFader;
+    float bypassValue    = 0.f;
+    float bypassFadeTime = dsp::kDefaultBypassFadeTime;
+    float appliedGain    = 1.f;
+
+    // Followers multiply the leader's curve into their own, see linkGainGroup.
+    // They delay their audio by one block so the leader has published it
+    // whatever the host's order. Being a follower changes the latency, so
+    // the controller also tells it directly, see notify.
+    int gainGroup             = -1;
+    dsp::group_role groupRole = dsp::group_role::follower;
+    float groupGain           = 1.f;
+    std::vector<float> groupGains;
+    dsp::gain_bus::cursor groupCursor;
+    std::atomic<bool> isFollower{false};
+    bool isFollowerActive = false;
+
+    // setState runs on the UI thread while the audio thread may process.
+    // It only stages the restored values, the audio thread applies them at
+    // the start of the next block or on activation, see applyRestoredState.
+    enum RestoreStatus
+    {
+        kRestoreNone,
+        kRestoreWriting,  // by setState or getState
+        kRestorePending,
+        kRestoreApplying, // by the audio thread
+    };
+    ParamState restoredState;
+    std::atomic<int> restoreStatus{kRestoreNone};
+
+    // Trims, balance and mid/side, applied in the same pass as the curve.
+    dsp::channel_gains channelGains;
+    std::vector<float> channelScratch;
+    bool hasChannelGains = false;
+
+    // Lookahead limiter on the output of the main bus, the only one, so the
+    // latency it reports holds for all of the plug-in's audio. Switching it
+    // on or off changes the latency, so the controller also tells it
+    // directly, see notify.
+    dsp::output_ceiling outputCeiling;
+    float ceilingDecibel = dsp::kDefaultCeilingDecibel;
+    std::atomic<bool> isCeilingOn{false};
+    bool isCeilingActive = false;
+    bool isLimiting      = false;
+
+    // Time offset of the gain automation. Positive offsets delay the gain
+    // points. Negative ones need the offset lookahead: the audio and all
+    // other points are delayed by the maximum offset, the gain points by
+    // the rest, see getGainDelay. The offset itself is automatable, only
+    // the lookahead changes the latency, so the controller also tells it
+    // directly, see notify. The input delay also holds a follower's block.
+    // Like the ceiling, it delays the main bus, the only one.
+    dsp::automation_delay gainDelay;
+    dsp::audio_delay inputDelay;
+    dsp::position_delay inputPositions;
+    float automationOffset = 0.f;
+    std::atomic<bool> isLookaheadOn{false};
+    bool isLookaheadActive = false;
+
+    // Loudness of the output for the meters. The auto gain rides on the
+    // input's, measured before the gain, see applyAutoGain.
+    dsp::loudness_meter outputLoudness;
+    dsp::loudness_meter inputLoudness;
+    dsp::auto_gain autoGain;
+    std::vector<float> autoGains;
+    bool isAutoGain      = false;
+    float loudnessTarget = dsp::kDefaultLoudnessTarget;
+    float autoGainSlew   = dsp::kDefaultAutoGainSlew;
+    bool wasPlaying      = false;
+
+    dsp::simd_level simdLevel                                      = dsp::simd_level::scalar;
+    const dsp::gain_kernel<Steinberg::Vst::Sample32>* gainKernel32 = nullptr;
+    const dsp::gain_kernel<Steinberg::Vst::Sample64>* gainKernel64 = nullptr;
+
+    // Offline renders spread the gain kernels of large blocks over the
+    // threads of the process wide pool. Acquired with the first offline
+    // activation, released in terminate.
+    dsp::worker_pool* workerPool = nullptr;
+
+    // Applied gain log for compliance audits, see openCapture. Aligned
+    // with the output, the ceiling's gain reduction included.
+    dsp::capture_encoder captureEncoder;
+    dsp::capture_writer captureWriter;
+    dsp::position_delay capturePositions;
+
+    // Levels are only measured while a controller polls the queue.
+    dsp::meter_queue meterQueue;
+    dsp::meter_collector meterCollector;
+    std::atomic<bool> isMeterAccepted{false};
+
+#if HA_PROFILING
+    // Compiled in with HA_GAIN_AUTOMATOR_PROFILING, switched on per activation.
+    void writeProfile();
+
+    dsp::process_profile processProfile;
+    std::string profilePath;
+    bool isProfiling = false;
+#endif
 };
 
 //------------------------------------------------------------------------
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_profile.h"
+#include "gain_automator_simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr std::uint32_t kProfileTag     = 0x72704147; // 'GApr'
+constexpr std::uint32_t kProfileVersion = 1;
+
+//------------------------------------------------------------------------
+std::int64_t read_nanoseconds()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+const char* to_string(process_path path)
+{
+    switch (path)
+    {
+        case process_path::idle: return "idle";
+        case process_path::silent: return "silent";
+        case process_path::unity: return "unity";
+        case process_path::mute: return "mute";
+        case process_path::constant: return "constant";
+        case process_path::segments: return "segments";
+        case process_path::samples: return "samples";
+        default: return "?";
+    }
+}
+
+//------------------------------------------------------------------------
+int to_bucket(std::uint64_t value, int num_buckets)
+{
+    int bucket = 0;
+    while (value != 0 && bucket < num_buckets - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+//------------------------------------------------------------------------
+std::uint64_t read_cycle_counter()
+{
+#if HA_ARCH_X86
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(read_nanoseconds());
+#endif
+}
+
+//------------------------------------------------------------------------
+bool write_profile(const std::string& path, const profile_snapshot& snapshot)
+{
+    // Never overwrite another instance's profile.
+    if (FILE* existing = std::fopen(path.c_str(), "rb"))
+    {
+        std::fclose(existing);
+        return false;
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool isOk = std::fwrite(&kProfileTag, sizeof(kProfileTag), 1, file) == 1;
+    isOk      = isOk && std::fwrite(&kProfileVersion, sizeof(kProfileVersion), 1, file) == 1;
+    isOk      = isOk && std::fwrite(&snapshot, sizeof(snapshot), 1, file) == 1;
+    return std::fclose(file) == 0 && isOk;
+}
+
+//------------------------------------------------------------------------
+bool read_profile(const std::string& path, profile_snapshot& snapshot)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    std::uint32_t tag     = 0;
+    std::uint32_t version = 0;
+
+    bool isOk = std::fread(&tag, sizeof(tag), 1, file) == 1 && tag == kProfileTag;
+    isOk      = isOk && std::fread(&version, sizeof(version), 1, file) == 1;
+    isOk      = isOk && version == kProfileVersion;
+    isOk      = isOk && std::fread(&snapshot, sizeof(snapshot), 1, file) == 1;
+    std::fclose(file);
+    return isOk;
+}
+
+//------------------------------------------------------------------------
+// process_profile
+//------------------------------------------------------------------------
+void process_profile::reset(double new_sample_rate)
+{
+    for (auto& histogram : cycles)
+        for (auto& bucket : histogram)
+            bucket.store(0, std::memory_order_relaxed);
+    for (auto& bucket : block_sizes)
+        bucket.store(0, std::memory_order_relaxed);
+    for (auto& bucket : point_counts)
+        bucket.store(0, std::memory_order_relaxed);
+
+    num_calls.store(0, std::memory_order_relaxed);
+    total_cycles.store(0, std::memory_order_relaxed);
+    worst_cycles.store(0, std::memory_order_relaxed);
+    worst_num_samples.store(0, std::memory_order_relaxed);
+    worst_num_points.store(0, std::memory_order_relaxed);
+    worst_path.store(0, std::memory_order_relaxed);
+
+    sample_rate.store(new_sample_rate, std::memory_order_relaxed);
+    start_cycles.store(read_cycle_counter(), std::memory_order_relaxed);
+    start_nanoseconds.store(read_nanoseconds(), std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+void process_profile::record(std::uint64_t call_cycles,
+                             int num_samples,
+                             int num_points,
+                             process_path path)
+{
+    const int path_index = static_cast<int>(path);
+    increment(cycles[path_index][to_bucket(call_cycles, kNumCycleBuckets)]);
+    increment(block_sizes[to_bucket(std::max(num_samples, 0), kNumCountBuckets)]);
+    increment(point_counts[to_bucket(std::max(num_points, 0), kNumCountBuckets)]);
+    increment(num_calls);
+    total_cycles.store(total_cycles.load(std::memory_order_relaxed) + call_cycles,
+                       std::memory_order_relaxed);
+
+    if (call_cycles <= worst_cycles.load(std::memory_order_relaxed))
+        return;
+
+    const std::uint32_t sequence = worst_sequence.load(std::memory_order_relaxed);
+    worst_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    worst_cycles.store(call_cycles, std::memory_order_relaxed);
+    worst_num_samples.store(num_samples, std::memory_order_relaxed);
+    worst_num_points.store(num_points, std::memory_order_relaxed);
+    worst_path.store(path_index, std::memory_order_relaxed);
+    worst_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void process_profile::read(profile_snapshot& snapshot) const
+{
+    for (std::size_t path = 0; path < cycles.size(); ++path)
+        for (int bucket = 0; bucket < kNumCycleBuckets; ++bucket)
+            snapshot.cycles[path][bucket] = cycles[path][bucket].load(std::memory_order_relaxed);
+    for (int bucket = 0; bucket < kNumCountBuckets; ++bucket)
+    {
+        snapshot.block_sizes[bucket]  = block_sizes[bucket].load(std::memory_order_relaxed);
+        snapshot.point_counts[bucket] = point_counts[bucket].load(std::memory_order_relaxed);
+    }
+    snapshot.num_calls    = num_calls.load(std::memory_order_relaxed);
+    snapshot.total_cycles = total_cycles.load(std::memory_order_relaxed);
+
+    // A few attempts, a torn worst call is replaced by the next one anyway.
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        const std::uint32_t sequence = worst_sequence.load(std::memory_order_acquire);
+        snapshot.worst.cycles        = worst_cycles.load(std::memory_order_relaxed);
+        snapshot.worst.num_samples   = worst_num_samples.load(std::memory_order_relaxed);
+        snapshot.worst.num_points    = worst_num_points.load(std::memory_order_relaxed);
+        snapshot.worst.path = static_cast<process_path>(worst_path.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((sequence & 1) == 0 && worst_sequence.load(std::memory_order_relaxed) == sequence)
+            break;
+    }
+
+    const std::uint64_t cycles_now = read_cycle_counter();
+    const std::int64_t nanoseconds = read_nanoseconds();
+    const double elapsed_cycles =
+        static_cast<double>(cycles_now - start_cycles.load(std::memory_order_relaxed));
+    const double elapsed_seconds =
+        (nanoseconds - start_nanoseconds.load(std::memory_order_relaxed)) * 1e-9;
+    snapshot.cycles_per_second = elapsed_seconds > 0. ? elapsed_cycles / elapsed_seconds : 0.;
+    snapshot.sample_rate       = sample_rate.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// process_path
+//
+// What a process() call did with the audio, ordered by cost. With several
+// buses the most expensive one counts.
+//------------------------------------------------------------------------
+enum class process_path
+{
+    idle,     // no audio buffers, parameters only
+    silent,   // silent input, outputs cleared
+    unity,    // unity gain, copied or nothing to do in place
+    mute,     // zero gain, outputs cleared
+    constant, // constant gain kernel
+    segments, // constant and ramp segments
+    samples,  // per sample gains
+    count
+};
+
+const char* to_string(process_path path);
+
+//------------------------------------------------------------------------
+// Histogram buckets are powers of two: bucket b counts values in
+// [2^(b-1), 2^b), bucket 0 counts zeros, the last bucket everything above.
+static constexpr int kNumCycleBuckets = 40;
+static constexpr int kNumCountBuckets = 16;
+
+int to_bucket(std::uint64_t value, int num_buckets);
+
+// Time stamp counter where available, nanoseconds otherwise.
+std::uint64_t read_cycle_counter();
+
+//------------------------------------------------------------------------
+// profile_call
+//------------------------------------------------------------------------
+struct profile_call
+{
+    std::uint64_t cycles     = 0;
+    std::int32_t num_samples = 0;
+    std::int32_t num_points  = 0;
+    process_path path        = process_path::idle;
+};
+
+//------------------------------------------------------------------------
+// profile_snapshot
+//
+// A plain copy of a process_profile, also the payload of a profile file.
+//------------------------------------------------------------------------
+struct profile_snapshot
+{
+    using cycle_histogram = std::array<std::uint64_t, kNumCycleBuckets>;
+    using count_histogram = std::array<std::uint64_t, kNumCountBuckets>;
+
+    std::array<cycle_histogram, static_cast<int>(process_path::count)> cycles{};
+    count_histogram block_sizes{};
+    count_histogram point_counts{};
+    std::uint64_t num_calls    = 0;
+    std::uint64_t total_cycles = 0;
+    profile_call worst;
+    double cycles_per_second = 0.; // read_cycle_counter() ticks
+    double sample_rate       = 0.;
+};
+
+// Profile files: a 'GApr' tag, a version and the snapshot, little endian.
+bool write_profile(const std::string& path, const profile_snapshot& snapshot);
+bool read_profile(const std::string& path, profile_snapshot& snapshot);
+
+//------------------------------------------------------------------------
+// process_profile
+//
+// Fixed size histograms of process() calls: cycles per path, block sizes
+// and automation point counts, plus the worst call. The audio thread is
+// the only writer; the counters are relaxed atomics it just stores to, so
+// recording a call is a handful of plain loads and stores. Other threads
+// read at any time, a snapshot may be one call apart between histograms.
+//------------------------------------------------------------------------
+class process_profile
+{
+public:
+    // Clears all counters and restarts the clock calibration. Not while
+    // record() may run.
+    void reset(double sample_rate);
+
+    // Audio thread
+    void record(std::uint64_t cycles, int num_samples, int num_points, process_path path);
+
+    // Any thread
+    void read(profile_snapshot& snapshot) const;
+
+private:
+    using counter = std::atomic<std::uint64_t>;
+
+    static void increment(counter& value)
+    {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::array<std::array<counter, kNumCycleBuckets>, static_cast<int>(process_path::count)>
+        cycles{};
+    std::array<counter, kNumCountBuckets> block_sizes{};
+    std::array<counter, kNumCountBuckets> point_counts{};
+    counter num_calls{0};
+    counter total_cycles{0};
+
+    // The worst call is written under a sequence count, odd while writing.
+    std::atomic<std::uint32_t> worst_sequence{0};
+    counter worst_cycles{0};
+    std::atomic<std::int32_t> worst_num_samples{0};
+    std::atomic<std::int32_t> worst_num_points{0};
+    std::atomic<int> worst_path{0};
+
+    // Written by reset() only, atomic as other threads may read meanwhile.
+    counter start_cycles{0};
+    std::atomic<std::int64_t> start_nanoseconds{0};
+    std::atomic<double> sample_rate{0.};
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
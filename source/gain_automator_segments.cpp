@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_segments.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// A few float roundings of a normalized value, e.g. of a host's point on
+// a ramp it cut at a block boundary.
+constexpr float kRampTolerance = 1e-6f;
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// gain_segments
+//------------------------------------------------------------------------
+void gain_segments::reserve(int max_samples_per_block)
+{
+    // Offsets are clamped into the block and duplicates collapse, so there
+    // can never be more segments than samples (plus the trailing hold).
+    segments.reserve(std::max(max_samples_per_block, 0) + 1);
+}
+
+//------------------------------------------------------------------------
+void gain_segments::begin(float start_value)
+{
+    segments.clear();
+    anchor_offset = -1;
+    anchor_value  = start_value;
+    has_pending   = false;
+    last_value    = start_value;
+
+    // A ramp only continues from where it ended.
+    if (ramp.end != start_value)
+        ramp.is_open = false;
+}
+
+//------------------------------------------------------------------------
+void gain_segments::add_point(int offset, float value)
+{
+    offset = std::max(offset, anchor_offset + 1);
+    if (has_pending)
+    {
+        // Points sharing an offset collapse into the latest one.
+        if (offset <= pending_offset)
+        {
+            pending_value = value;
+            return;
+        }
+
+        flush_pending(offset);
+    }
+
+    pending_offset = offset;
+    pending_value  = value;
+    has_pending    = true;
+}
+
+//------------------------------------------------------------------------
+void gain_segments::end(int num_samples)
+{
+    if (has_pending)
+        flush_pending(num_samples);
+
+    const int hold_offset = anchor_offset + 1;
+    if (hold_offset < num_samples)
+        push_segment(hold_offset, num_samples - hold_offset, anchor_value, 0.f, 0);
+
+    // Open into the next block if the last point is the last sample.
+    ramp.end     = anchor_value;
+    ramp.is_open = ramp.is_open && anchor_offset == num_samples - 1;
+    last_value   = anchor_value;
+}
+
+//------------------------------------------------------------------------
+void gain_segments::assign(const automation_point* points,
+                           int num_points,
+                           int num_samples,
+                           float start_value)
+{
+    begin(start_value);
+    for (int i = 0; i < num_points; ++i)
+        add_point(points[i].offset, points[i].value);
+    end(num_samples);
+}
+
+//------------------------------------------------------------------------
+int gain_segments::get_num_samples() const
+{
+    if (segments.empty())
+        return 0;
+
+    return segments.back().offset + segments.back().length;
+}
+
+//------------------------------------------------------------------------
+void gain_segments::flush_pending(int num_samples)
+{
+    const int distance = pending_offset - anchor_offset;
+    const int offset   = anchor_offset + 1;
+    const int length   = std::min(distance, num_samples - offset);
+    const float inc    = (pending_value - anchor_value) / static_cast<float>(distance);
+
+    // The point may lie on the ramp ending at the anchor. Then the ramp is
+    // aimed at it from its origin, not from the anchor's rounded value.
+    const int phase = ramp.phase + distance;
+    const bool is_continued =
+        inc != 0.f && ramp.is_open && phase < kMaxRampPhase &&
+        std::abs(ramp.start + ramp.increment * static_cast<float>(phase) - pending_value) <=
+            kRampTolerance;
+    if (is_continued)
+        ramp.increment = (pending_value - ramp.start) / static_cast<float>(phase);
+    else
+    {
+        ramp.start     = anchor_value;
+        ramp.increment = inc;
+        ramp.phase     = 0;
+    }
+
+    if (length > 0 && inc == 0.f)
+        push_segment(offset, length, anchor_value, 0.f, 0);
+    else if (length > 0)
+        push_segment(offset, length, ramp.start, ramp.increment, ramp.phase + 1);
+
+    ramp.phase    = is_continued ? phase : distance;
+    ramp.is_open  = inc != 0.f;
+    anchor_offset = pending_offset;
+    anchor_value  = pending_value;
+    has_pending   = false;
+}
+
+//------------------------------------------------------------------------
+void gain_segments::push_segment(int offset, int length, float start, float increment, int phase)
+{
+    if (!segments.empty())
+    {
+        // Merge with a preceding constant segment of the same gain.
+        auto& back = segments.back();
+        if (back.is_constant() && increment == 0.f && back.start == start)
+        {
+            back.length += length;
+            return;
+        }
+    }
+
+    if (segments.size() == segments.capacity())
+    {
+        // Never allocate on the audio thread. A host exceeding
+        // maxSamplesPerBlock gets the remainder held at the segment start.
+        if (segments.empty())
+            return;
+
+        segments.back().length += length;
+        return;
+    }
+
+    segments.push_back({offset, length, start, increment, phase});
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
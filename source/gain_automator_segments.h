@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Ramps are evaluated from their origin, which float counts exactly up to
+// 2^24 samples. Longer ramps start over at this phase, with room for a
+// block on top.
+static constexpr int kMaxRampPhase = 1 << 23;
+
+//------------------------------------------------------------------------
+// gain_segment
+//
+// A run of samples inside a block with either a constant gain
+// (increment == 0) or a piece of a linear ramp. The gain at sample i of
+// the segment is 'start + increment * (phase + i)': 'start' is the value
+// at the ramp's origin, 'phase' the distance of the segment's first
+// sample from it (0 for constants). The gains do not depend on where the
+// segment starts, a ramp keeps its origin across blocks.
+//------------------------------------------------------------------------
+struct gain_segment
+{
+    int offset      = 0;
+    int length      = 0;
+    float start     = 0.f;
+    float increment = 0.f;
+    int phase       = 0;
+
+    bool is_constant() const { return increment == 0.f; }
+    float get_gain(int i) const { return start + increment * static_cast<float>(phase + i); }
+};
+
+//------------------------------------------------------------------------
+// gain_ramp
+//
+// The ramp ending at the latest point: origin value, increment and the
+// point's phase and value. Open while the point is the block's last
+// sample, the next block then continues the ramp instead of starting a
+// new one from the rounded end value.
+//------------------------------------------------------------------------
+struct gain_ramp
+{
+    float start     = 0.f;
+    float increment = 0.f;
+    int phase       = 0;
+    float end       = 0.f;
+    bool is_open    = false;
+};
+
+//------------------------------------------------------------------------
+// automation_point
+//------------------------------------------------------------------------
+struct automation_point
+{
+    int offset  = 0;
+    float value = 0.f;
+};
+
+//------------------------------------------------------------------------
+// gain_segments
+//
+// Splits a block at the automation points of a VST 3 parameter queue.
+// Between two points the gain ramps linearly, after the last point it is
+// held. The first ramp starts at the value of the previous block's last
+// sample (anchored at offset -1).
+//
+// A point that lies on the running ramp (within a few float roundings)
+// continues it, also across blocks: hosts cut ramps at block boundaries
+// with a point on the last sample. The ramp keeps its origin and is aimed
+// at the new point from there, so behind the cut it computes exactly the
+// gains of the uncut ramp, and the cut point's rounding is not carried on.
+//
+// Usage per block: begin(), add_point() for every queue point in order,
+// end(). Call reserve() outside of the audio thread, no allocation
+// happens afterwards.
+//------------------------------------------------------------------------
+class gain_segments
+{
+public:
+    using segment_list   = std::vector<gain_segment>;
+    using const_iterator = segment_list::const_iterator;
+
+    void reserve(int max_samples_per_block);
+
+    void begin(float start_value);
+    void add_point(int offset, float value);
+    void end(int num_samples);
+
+    // Shortcut for begin(), add_point() for all 'points' and end().
+    void assign(const automation_point* points, int num_points, int num_samples, float start_value);
+
+    const_iterator cbegin() const { return segments.cbegin(); }
+    const_iterator cend() const { return segments.cend(); }
+    const_iterator begin() const { return segments.begin(); }
+    const_iterator end() const { return segments.end(); }
+    int size() const { return static_cast<int>(segments.size()); }
+    bool empty() const { return segments.empty(); }
+
+    bool is_constant() const { return segments.size() == 1 && segments.front().is_constant(); }
+    float get_last_value() const { return last_value; }
+    int get_num_samples() const;
+
+    // The ramp a block ended on, for users sharing one gain_segments
+    // between parameters. Setting a closed ramp starts the next block anew.
+    const gain_ramp& get_ramp() const { return ramp; }
+    void set_ramp(const gain_ramp& new_ramp) { ramp = new_ramp; }
+
+    // Writes the gain of every sample of the block to 'curve'.
+    template <typename SampleType>
+    void render(SampleType* curve) const;
+
+private:
+    void flush_pending(int num_samples);
+    void push_segment(int offset, int length, float start, float increment, int phase);
+
+    segment_list segments;
+    gain_ramp ramp;
+    int anchor_offset   = -1;
+    float anchor_value  = 0.f;
+    int pending_offset  = -1;
+    float pending_value = 0.f;
+    bool has_pending    = false;
+    float last_value    = 0.f;
+};
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void gain_segments::render(SampleType* curve) const
+{
+    for (const auto& segment : segments)
+    {
+        const auto start     = static_cast<SampleType>(segment.start);
+        const auto increment = static_cast<SampleType>(segment.increment);
+        SampleType* dst      = curve + segment.offset;
+        for (int i = 0; i < segment.length; ++i)
+            dst[i] = start + increment * static_cast<SampleType>(segment.phase + i);
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,31 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+// Instruction set detection and per-function target attributes shared by
+// the translation units containing vectorized code. Only include this
+// from .cpp files.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HA_ARCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define HA_ARCH_NEON 1
+#include <arm_neon.h>
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define HA_ARCH_NEON_F64 1
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HA_TARGET_SSE2 __attribute__((target("sse2")))
+#define HA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HA_TARGET_SSE2
+#define HA_TARGET_AVX2
+#endif
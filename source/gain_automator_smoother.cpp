@@ -0,0 +1,307 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_smoother.h"
+#include "gain_automator_simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+// Residual of the one pole transition after the smoothing time (-80 dB).
+constexpr double kOnePoleResidual = 1e-4;
+constexpr double kPi              = 3.14159265358979323846;
+
+//------------------------------------------------------------------------
+// Transition: out[i] = start + delta * shape[i]
+//------------------------------------------------------------------------
+void transition_scalar(float start, float delta, const float* shape, float* out, int num_samples)
+{
+    for (int i = 0; i < num_samples; ++i)
+        out[i] = start + delta * shape[i];
+}
+
+#if HA_ARCH_X86
+//------------------------------------------------------------------------
+HA_TARGET_SSE2 void
+transition_sse2(float start, float delta, const float* shape, float* out, int num_samples)
+{
+    const __m128 s = _mm_set1_ps(start);
+    const __m128 d = _mm_set1_ps(delta);
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(s, _mm_mul_ps(d, _mm_loadu_ps(shape + i))));
+
+    transition_scalar(start, delta, shape + i, out + i, num_samples - i);
+}
+
+//------------------------------------------------------------------------
+HA_TARGET_AVX2 void
+transition_avx2(float start, float delta, const float* shape, float* out, int num_samples)
+{
+    const __m256 s = _mm256_set1_ps(start);
+    const __m256 d = _mm256_set1_ps(delta);
+
+    int i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+        _mm256_storeu_ps(out + i,
+                         _mm256_add_ps(s, _mm256_mul_ps(d, _mm256_loadu_ps(shape + i))));
+
+    transition_scalar(start, delta, shape + i, out + i, num_samples - i);
+}
+#endif // HA_ARCH_X86
+
+#if HA_ARCH_NEON
+//------------------------------------------------------------------------
+void transition_neon(float start, float delta, const float* shape, float* out, int num_samples)
+{
+    const float32x4_t s = vdupq_n_f32(start);
+    const float32x4_t d = vdupq_n_f32(delta);
+
+    int i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+        vst1q_f32(out + i, vaddq_f32(s, vmulq_f32(d, vld1q_f32(shape + i))));
+
+    transition_scalar(start, delta, shape + i, out + i, num_samples - i);
+}
+#endif // HA_ARCH_NEON
+
+//------------------------------------------------------------------------
+void transition(
+    simd_level level, float start, float delta, const float* shape, float* out, int num_samples)
+{
+    switch (level)
+    {
+#if HA_ARCH_X86
+        case simd_level::avx2: transition_avx2(start, delta, shape, out, num_samples); break;
+        case simd_level::sse2: transition_sse2(start, delta, shape, out, num_samples); break;
+#endif
+#if HA_ARCH_NEON
+        case simd_level::neon: transition_neon(start, delta, shape, out, num_samples); break;
+#endif
+        default: transition_scalar(start, delta, shape, out, num_samples); break;
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+smoothing_mode to_smoothing_mode(double normalized)
+{
+    const int count = static_cast<int>(smoothing_mode::count);
+    const int index = static_cast<int>(normalized * (count - 1) + 0.5);
+    return static_cast<smoothing_mode>(std::min(std::max(index, 0), count - 1));
+}
+
+//------------------------------------------------------------------------
+double to_normalized(smoothing_mode mode)
+{
+    const int count = static_cast<int>(smoothing_mode::count);
+    return static_cast<double>(mode) / (count - 1);
+}
+
+//------------------------------------------------------------------------
+float to_smoothing_time(double normalized)
+{
+    const double value = std::min(std::max(normalized, 0.), 1.);
+    return static_cast<float>(kMinSmoothingTime + value * (kMaxSmoothingTime - kMinSmoothingTime));
+}
+
+//------------------------------------------------------------------------
+double to_normalized_smoothing_time(float time_ms)
+{
+    const double value = (time_ms - kMinSmoothingTime) / (kMaxSmoothingTime - kMinSmoothingTime);
+    return std::min(std::max(value, 0.), 1.);
+}
+
+//------------------------------------------------------------------------
+// gain_smoother
+//------------------------------------------------------------------------
+void gain_smoother::setup(double new_sample_rate, int max_samples_per_block)
+{
+    sample_rate = new_sample_rate > 0. ? new_sample_rate : 44100.;
+    shape.resize(static_cast<size_t>(std::ceil(sample_rate * kMaxSmoothingTime / 1000.)));
+    samples.resize(std::max(max_samples_per_block, 0));
+
+    build_shape();
+    reset(get_value());
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::configure(smoothing_mode new_mode, float new_time_ms)
+{
+    if (new_mode == mode && new_time_ms == time_ms)
+        return;
+
+    const float value = get_value();
+    mode              = new_mode;
+    time_ms           = new_time_ms;
+    build_shape();
+
+    // Restart a running transition with the new shape.
+    if (is_moving)
+    {
+        start     = value;
+        delta     = target - value;
+        phase     = 0;
+        is_moving = length > 0;
+    }
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::build_shape()
+{
+    const int time_samples = static_cast<int>(std::lround(time_ms * sample_rate / 1000.));
+    const int max_length   = static_cast<int>(shape.size());
+    length                 = std::min(std::max(time_samples - 1, 0), max_length);
+
+    // The last sample of the time is the target itself, it is not part of the shape.
+    const int num_steps = length + 1;
+    num_built           = 0;
+    switch (mode)
+    {
+        case smoothing_mode::one_pole:
+            factor  = std::pow(kOnePoleResidual, 1. / num_steps);
+            current = 1.;
+            break;
+        case smoothing_mode::linear: factor = num_steps; break;
+        case smoothing_mode::raised_cosine: {
+            // cos((i + 1) * w) by the Chebyshev recurrence, no cos() per entry
+            const double w = kPi / num_steps;
+            factor         = 2. * std::cos(w);
+            previous       = 1.;
+            current        = std::cos(w);
+            break;
+        }
+        default: length = 0; break;
+    }
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::extend_shape(int end)
+{
+    end = std::min(end, length);
+    switch (mode)
+    {
+        case smoothing_mode::one_pole:
+            for (; num_built < end; ++num_built)
+            {
+                current *= factor;
+                shape[num_built] = static_cast<float>(1. - current);
+            }
+            break;
+        case smoothing_mode::linear:
+            for (; num_built < end; ++num_built)
+                shape[num_built] = static_cast<float>(double(num_built + 1) / factor);
+            break;
+        case smoothing_mode::raised_cosine:
+            for (; num_built < end; ++num_built)
+            {
+                shape[num_built]  = static_cast<float>(0.5 - 0.5 * current);
+                const double next = factor * current - previous;
+                previous          = current;
+                current           = next;
+            }
+            break;
+        default: break;
+    }
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::reset(float value)
+{
+    target    = value;
+    start     = value;
+    delta     = 0.f;
+    phase     = 0;
+    is_moving = false;
+}
+
+//------------------------------------------------------------------------
+float gain_smoother::get_value() const
+{
+    if (!is_moving)
+        return target;
+
+    return phase > 0 ? start + delta * shape[phase - 1] : start;
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::set_target(float value)
+{
+    if (value == target)
+        return;
+
+    start     = get_value();
+    target    = value;
+    delta     = target - start;
+    phase     = 0;
+    is_moving = length > 0;
+}
+
+//------------------------------------------------------------------------
+bool gain_smoother::process(const automation_point* points,
+                            int num_points,
+                            int num_samples,
+                            simd_level level)
+{
+    if (num_samples > static_cast<int>(samples.size()))
+    {
+        if (num_points > 0)
+            reset(points[num_points - 1].value);
+        return true;
+    }
+
+    if (!is_moving)
+    {
+        const auto* first = points;
+        const auto* last  = points + num_points;
+        const bool holds  = std::all_of(
+            first, last, [this](const automation_point& point) { return point.value == target; });
+        if (holds)
+            return true;
+    }
+
+    // Sub-blocks between the points, each point retargets at its offset.
+    float* out = samples.data();
+    int offset = 0;
+    for (int index = 0; index <= num_points; ++index)
+    {
+        const int next =
+            index < num_points ? std::min(std::max(points[index].offset, offset), num_samples)
+                               : num_samples;
+        render(out + offset, next - offset, level);
+        offset = next;
+
+        if (index < num_points)
+            set_target(points[index].value);
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------
+void gain_smoother::render(float* out, int num_samples, simd_level level)
+{
+    int i = 0;
+    if (is_moving)
+    {
+        i = std::min(num_samples, length - phase);
+        extend_shape(phase + i);
+        transition(level, start, delta, shape.data() + phase, out, i);
+        phase += i;
+        is_moving = phase < length;
+    }
+
+    std::fill(out + i, out + num_samples, target);
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_kernel.h"
+#include "gain_automator_segments.h"
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// Range of the smoothing time parameter in milliseconds.
+static constexpr float kMinSmoothingTime     = 1.f;
+static constexpr float kMaxSmoothingTime     = 500.f;
+static constexpr float kDefaultSmoothingTime = 20.f;
+
+// Range of the bypass crossfade in milliseconds, see GainAutomatorProcessor.
+static constexpr float kMaxBypassFadeTime     = 100.f;
+static constexpr float kDefaultBypassFadeTime = 10.f;
+
+//------------------------------------------------------------------------
+// smoothing_mode
+//
+// Shape of the transition towards a new target. The order matches the
+// entries of the 'Smoothing' list parameter.
+//------------------------------------------------------------------------
+enum class smoothing_mode
+{
+    off,           // points are ramped to as sent by the host
+    one_pole,      // exponential, within -80 dB of the target after the time
+    linear,        // straight line over the time
+    raised_cosine, // half cosine over the time, no corners at both ends
+    count
+};
+
+//------------------------------------------------------------------------
+smoothing_mode to_smoothing_mode(double normalized);
+double to_normalized(smoothing_mode mode);
+float to_smoothing_time(double normalized);
+double to_normalized_smoothing_time(float time_ms);
+
+//------------------------------------------------------------------------
+// gain_smoother
+//
+// Anti-zipper stage for coarse automation. Every automation point is a
+// new target at its offset, the value moves there along a transition of
+// the configured time. Since the transition is independent of where the
+// blocks start and end, cutting a block in two gives the same values.
+//
+// All modes share one code path: a transition is
+// 'start + delta * shape[phase]' with a shape table for the mode and
+// time, evaluated vectorized in sub-blocks between the points. The table
+// is filled as transitions reach it, so a new time costs nothing until
+// samples are rendered with it.
+// Once the target is reached, blocks without new targets are reported as
+// constant and no per sample work is done at all.
+//
+// Mode and time are applied per block; changing them during a transition
+// restarts it from the current value.
+//------------------------------------------------------------------------
+class gain_smoother
+{
+public:
+    // Allocates the shape for the longest time and the per sample buffer.
+    // Not real-time safe.
+    void setup(double sample_rate, int max_samples_per_block);
+
+    // Starts a new shape if mode or time have changed. Real-time safe and
+    // constant time, e.g. for an automated time.
+    void configure(smoothing_mode mode, float time_ms);
+
+    bool is_enabled() const { return mode != smoothing_mode::off; }
+
+    // Jumps to 'value', no transition.
+    void reset(float value);
+
+    // Follows 'points' of a block of 'num_samples'. Returns true, if the
+    // whole block is constant at get_value(). Otherwise get_samples()
+    // holds one normalized value per sample. Blocks larger than
+    // max_samples_per_block jump to their final value.
+    bool process(const automation_point* points, int num_points, int num_samples, simd_level level);
+
+    // The value of the last processed sample.
+    float get_value() const;
+    float get_target() const { return target; }
+    const float* get_samples() const { return samples.data(); }
+
+private:
+    void set_target(float value);
+    void render(float* out, int num_samples, simd_level level);
+    void build_shape();
+    void extend_shape(int end);
+
+    std::vector<float> shape;
+    std::vector<float> samples;
+    double sample_rate  = 44100.;
+    smoothing_mode mode = smoothing_mode::off;
+    float time_ms       = 0.f;
+    int length          = 0; // transition samples before the target is held
+    int num_built       = 0; // of the shape
+    int phase           = 0;
+    float start         = 0.f;
+    float delta         = 0.f;
+    float target        = 0.f;
+    bool is_moving      = false;
+
+    // Recurrence of the shape at 'num_built'.
+    double factor   = 0.; // one pole: pole, linear: steps, raised cosine: 2 cos(w)
+    double previous = 0.;
+    double current  = 0.;
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// spsc_queue
+//
+// Wait-free single producer, single consumer queue of 'Capacity' - 1
+// elements. The storage is part of the object, so neither side ever
+// allocates. 'push' fails when the queue is full, the producer (e.g. the
+// audio thread) decides what to do with the element then. 'T' must be
+// trivially copyable.
+//------------------------------------------------------------------------
+template <typename T, std::size_t Capacity>
+class spsc_queue
+{
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+    // Producer side
+    bool push(const T& value)
+    {
+        const std::size_t write = write_index.load(std::memory_order_relaxed);
+        const std::size_t next  = (write + 1) & kMask;
+        if (next == read_index.load(std::memory_order_acquire))
+            return false;
+
+        elements[write] = value;
+        write_index.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& value)
+    {
+        const std::size_t read = read_index.load(std::memory_order_relaxed);
+        if (read == write_index.load(std::memory_order_acquire))
+            return false;
+
+        value = elements[read];
+        read_index.store((read + 1) & kMask, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    void clear()
+    {
+        read_index.store(write_index.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return read_index.load(std::memory_order_acquire) ==
+               write_index.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::size_t kMask = Capacity - 1;
+
+    // Indices on separate cache lines, the threads do not share a line.
+    alignas(64) std::atomic<std::size_t> write_index{0};
+    alignas(64) std::atomic<std::size_t> read_index{0};
+    alignas(64) std::array<T, Capacity> elements{};
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_state.h"
+#include "gain_automator_automation_delay.h"
+#include "gain_automator_ceiling.h"
+#include "gain_automator_channel_gains.h"
+#include "gain_automator_gain_bus.h"
+#include "gain_automator_gain_law.h"
+#include "gain_automator_loudness.h"
+#include "gain_automator_smoother.h"
+
+#include "base/source/fstreamer.h"
+
+#include <algorithm>
+
+using namespace Steinberg;
+
+namespace ha {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr uint32 kValueSize = sizeof(double);
+
+// Far more parameters than this plug-in will ever have, rejects garbage.
+constexpr uint32 kMaxPayloadSize = 4096 * kValueSize;
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// ParamState
+//------------------------------------------------------------------------
+Vst::ParamValue ParamState::getDefault(Vst::ParamID id)
+{
+    switch (id)
+    {
+        case kParamGainId: return 1.;
+        case kParamGainLawId: return dsp::to_normalized(dsp::gain_law::decibel);
+        case kParamSmoothingModeId: return dsp::to_normalized(dsp::smoothing_mode::off);
+        case kParamSmoothingTimeId:
+            return dsp::to_normalized_smoothing_time(dsp::kDefaultSmoothingTime);
+        case kParamBypassId: return 0.;
+        case kParamBypassFadeId: return dsp::kDefaultBypassFadeTime / dsp::kMaxBypassFadeTime;
+        case kParamGainGroupId: return dsp::to_normalized_gain_group(-1);
+        case kParamGroupRoleId: return dsp::to_normalized(dsp::group_role::follower);
+        case kParamBalanceId: return 0.5;
+        case kParamMidGainId:
+        case kParamSideGainId: return dsp::to_normalized_trim(0.f);
+        case kParamCeilingId: return dsp::to_normalized_ceiling(dsp::kDefaultCeilingDecibel);
+        case kParamLoudnessTargetId:
+            return dsp::to_normalized_loudness_target(dsp::kDefaultLoudnessTarget);
+        case kParamAutoGainSlewId:
+            return dsp::to_normalized_auto_gain_slew(dsp::kDefaultAutoGainSlew);
+        case kParamAutomationOffsetId: return dsp::to_normalized_automation_offset(0.f);
+        default: break;
+    }
+
+    if (id >= kParamTrimId && id < kParamTrimId + kNumTrims)
+        return dsp::to_normalized_trim(0.f);
+    return 0.;
+}
+
+//------------------------------------------------------------------------
+void ParamState::setDefaults()
+{
+    for (Vst::ParamID id = 0; id < kNumParams; ++id)
+        values[id] = getDefault(id);
+}
+
+//------------------------------------------------------------------------
+tresult ParamState::read(IBStream* stream)
+{
+    if (!stream)
+        return kInvalidArgument;
+
+    IBStreamer streamer(stream, kLittleEndian);
+
+    uint32 magic       = 0;
+    uint32 version     = 0;
+    uint32 payloadSize = 0;
+    if (!streamer.readInt32u(magic) || magic != kMagic)
+        return kResultFalse;
+    if (!streamer.readInt32u(version) || version == 0 || version > kVersion)
+        return kResultFalse;
+    if (!streamer.readInt32u(payloadSize) || payloadSize > kMaxPayloadSize ||
+        payloadSize % kValueSize != 0)
+        return kResultFalse;
+
+    // Only assign once the whole payload has been read.
+    std::array<Vst::ParamValue, kNumParams> restored;
+    for (Vst::ParamID id = 0; id < kNumParams; ++id)
+        restored[id] = getDefault(id);
+
+    const uint32 numStored = payloadSize / kValueSize;
+    const uint32 numKnown  = std::min(numStored, static_cast<uint32>(kNumParams));
+    for (uint32 index = 0; index < numKnown; ++index)
+    {
+        if (!streamer.readDouble(restored[index]))
+            return kResultFalse;
+
+        // Also maps NaN to 0
+        restored[index] = restored[index] >= 0. ? std::min(restored[index], 1.) : 0.;
+    }
+
+    // Values of parameters this version does not know
+    if (numStored > numKnown)
+        streamer.seek((numStored - numKnown) * kValueSize, kSeekCurrent);
+
+    values = restored;
+    return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult ParamState::write(IBStream* stream) const
+{
+    if (!stream)
+        return kInvalidArgument;
+
+    IBStreamer streamer(stream, kLittleEndian);
+
+    bool isOk = streamer.writeInt32u(kMagic);
+    isOk      = isOk && streamer.writeInt32u(kVersion);
+    isOk      = isOk && streamer.writeInt32u(kNumParams * kValueSize);
+    for (const auto value : values)
+        isOk = isOk && streamer.writeDouble(value);
+
+    return isOk ? kResultOk : kResultFalse;
+}
+
+//------------------------------------------------------------------------
+} // namespace ha
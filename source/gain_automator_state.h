@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_param_ids.h"
+#include "pluginterfaces/base/ibstream.h"
+#include "pluginterfaces/vst/vsttypes.h"
+#include <array>
+
+namespace ha {
+
+//------------------------------------------------------------------------
+//  ParamState
+//
+//  The normalized values of all parameters, as stored by the processor
+//  and restored by processor and controller alike.
+//
+//  Stream layout, little endian:
+//
+//      uint32  magic ('GAst')
+//      uint32  version
+//      uint32  payload size in bytes
+//      double  normalized value per parameter, in id order
+//
+//  New parameters are appended, existing ones are never reordered, so a
+//  reader takes the values it knows and skips the rest of the payload.
+//  Values missing from an older state keep their defaults. The version
+//  only changes if the meaning of an existing value changes.
+//
+//  Reading and writing never allocate.
+//------------------------------------------------------------------------
+struct ParamState
+{
+    static constexpr Steinberg::uint32 kMagic   = 0x74734147; // 'GAst'
+    static constexpr Steinberg::uint32 kVersion = 1;
+
+    std::array<Steinberg::Vst::ParamValue, kNumParams> values;
+
+    ParamState() { setDefaults(); }
+
+    void setDefaults();
+    static Steinberg::Vst::ParamValue getDefault(Steinberg::Vst::ParamID id);
+
+    Steinberg::tresult read(Steinberg::IBStream* stream);
+    Steinberg::tresult write(Steinberg::IBStream* stream) const;
+};
+
+//------------------------------------------------------------------------
+} // namespace ha
@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "gain_automator_worker_pool.h"
+
+#include <algorithm>
+
+namespace ha {
+namespace dsp {
+namespace {
+
+//------------------------------------------------------------------------
+struct shared_pool
+{
+    worker_pool pool;
+    std::mutex mutex; // instances are activated from any thread
+    int num_users = 0;
+};
+
+//------------------------------------------------------------------------
+shared_pool& get_shared_pool()
+{
+    static shared_pool shared;
+    return shared;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+worker_pool::~worker_pool()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------
+int worker_pool::get_default_num_threads()
+{
+    const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(num_cores - 1, 1);
+}
+
+//------------------------------------------------------------------------
+worker_pool& worker_pool::acquire()
+{
+    shared_pool& shared = get_shared_pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (shared.num_users++ == 0)
+        shared.pool.start(get_default_num_threads());
+    return shared.pool;
+}
+
+//------------------------------------------------------------------------
+void worker_pool::release()
+{
+    shared_pool& shared = get_shared_pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (shared.num_users > 0 && --shared.num_users == 0)
+        shared.pool.stop();
+}
+
+//------------------------------------------------------------------------
+void worker_pool::start(int num_threads)
+{
+    stop();
+
+    threads.reserve(num_threads);
+    for (int index = 0; index < num_threads; ++index)
+        threads.emplace_back([this]() { work(); });
+}
+
+//------------------------------------------------------------------------
+void worker_pool::stop()
+{
+    if (threads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+    job_started.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    threads.clear();
+    is_stopping = false;
+}
+
+//------------------------------------------------------------------------
+void worker_pool::run(task_func func, void* context, int num_tasks)
+{
+    if (num_tasks <= 0)
+        return;
+
+    if (threads.empty() || is_busy.exchange(true, std::memory_order_acquire))
+    {
+        for (int task = 0; task < num_tasks; ++task)
+            func(context, task);
+        return;
+    }
+
+    {
+        // Workers still leaving the previous job would take tasks of this one.
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [this]() { return num_active_workers == 0; });
+
+        job_func      = func;
+        job_context   = context;
+        job_num_tasks = num_tasks;
+        next_task.store(0, std::memory_order_relaxed);
+        ++job_sequence;
+    }
+    job_started.notify_all();
+
+    run_tasks(func, context, num_tasks);
+
+    // All tasks are taken, wait for the ones still running on the workers.
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [this]() { return num_active_workers == 0; });
+    }
+    is_busy.store(false, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void worker_pool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned sequence = job_sequence;
+    while (true)
+    {
+        job_started.wait(lock, [&]() { return is_stopping || job_sequence != sequence; });
+        if (is_stopping)
+            return;
+
+        sequence             = job_sequence;
+        const task_func func = job_func;
+        void* const context  = job_context;
+        const int num_tasks  = job_num_tasks;
+        ++num_active_workers;
+
+        lock.unlock();
+        run_tasks(func, context, num_tasks);
+        lock.lock();
+
+        if (--num_active_workers == 0)
+            job_finished.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------
+void worker_pool::run_tasks(task_func func, void* context, int num_tasks)
+{
+    while (true)
+    {
+        const int task = next_task.fetch_add(1, std::memory_order_relaxed);
+        if (task >= num_tasks)
+            return;
+
+        func(context, task);
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ha {
+namespace dsp {
+
+//------------------------------------------------------------------------
+// worker_pool
+//
+// A fixed set of threads that run the tasks of one job at a time. The
+// threads and the calling thread take the next task index from a shared
+// counter until none is left, so who finishes early takes over the
+// remaining work. Waking the workers and waiting for them takes a lock:
+// meant for offline processing, not for the real-time audio thread.
+//
+// One job runs at a time. A caller finding the pool busy, e.g. another
+// plug-in instance the host renders in parallel, runs its tasks alone, so
+// the cores are not oversubscribed.
+//------------------------------------------------------------------------
+class worker_pool
+{
+public:
+    using task_func = void (*)(void* context, int task);
+
+    ~worker_pool();
+
+    // One thread less than the hardware runs, the caller works as well.
+    static int get_default_num_threads();
+
+    // The pool shared by all users of the process: started with the
+    // default number of threads by the first acquire(), stopped by the
+    // last release(). Not real-time safe.
+    static worker_pool& acquire();
+    static void release();
+
+    // Starts 'num_threads' threads, stops running ones first.
+    void start(int num_threads);
+    void stop();
+
+    bool is_running() const { return !threads.empty(); }
+    int get_num_threads() const { return static_cast<int>(threads.size()); }
+
+    // Calls 'func(context, task)' for every task in [0, num_tasks) on the
+    // workers and the calling thread. Returns when all tasks are done.
+    void run(task_func func, void* context, int num_tasks);
+
+private:
+    void work();
+    void run_tasks(task_func func, void* context, int num_tasks);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable job_started;
+    std::condition_variable job_finished;
+
+    // The current job, written under 'mutex' while no worker is active.
+    task_func job_func     = nullptr;
+    void* job_context      = nullptr;
+    int job_num_tasks      = 0;
+    unsigned job_sequence  = 0;
+    int num_active_workers = 0;
+    bool is_stopping       = false;
+
+    std::atomic<bool> is_busy{false};
+    std::atomic<int> next_task{0};
+    std::atomic<int> num_done{0};
+};
+
+//------------------------------------------------------------------------
+} // namespace dsp
+} // namespace ha
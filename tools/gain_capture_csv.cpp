@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Converts a gain capture file (.gacl, see HA_GAIN_CAPTURE_DIR) to CSV.
+//
+// Usage: gain-capture-csv [-s] input.gacl [output.csv]
+//
+// By default there is one line per record:
+//
+//     position,project_time,length,start,increment,phase,gap,channel_gains
+//
+// With -s the records are expanded to one line per sample, with the gain
+// computed exactly like the processor did:
+//
+//     position,project_time,gain,channel_gains
+//
+// 'position' counts output samples, 'project_time' is where their audio
+// was on the timeline, -1 where the transport was stopped. The gain is the
+// one all channels share, 'channel_gains' is 1 where trims, balance or
+// mid/side came on top. Without an output path the CSV goes to stdout. A
+// summary is printed to stderr.
+
+#include "gain_automator_capture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+void print_usage()
+{
+    std::fprintf(stderr, "usage: gain-capture-csv [-s] input.gacl [output.csv]\n");
+}
+
+//------------------------------------------------------------------------
+bool read_header(std::ifstream& file, dsp::capture_file_header& header, std::string& error)
+{
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        error = "file too short";
+        return false;
+    }
+    if (header.magic != dsp::capture_file_header::kMagic)
+    {
+        error = "not a gain capture file";
+        return false;
+    }
+    if (header.version > dsp::capture_file_header::kVersion ||
+        header.record_size != sizeof(dsp::capture_record) ||
+        header.header_size < sizeof(dsp::capture_file_header))
+    {
+        error = "unsupported version " + std::to_string(header.version);
+        return false;
+    }
+
+    file.seekg(header.header_size);
+    return true;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    bool per_sample = false;
+    int index       = 1;
+    if (index < argc && std::strcmp(argv[index], "-s") == 0)
+    {
+        per_sample = true;
+        ++index;
+    }
+
+    const int num_paths = argc - index;
+    if (num_paths < 1 || num_paths > 2)
+    {
+        print_usage();
+        return 1;
+    }
+
+    const char* input_path = argv[index];
+    std::ifstream input(input_path, std::ios::binary);
+    if (!input)
+    {
+        std::fprintf(stderr, "error: cannot open '%s'\n", input_path);
+        return 1;
+    }
+
+    dsp::capture_file_header header;
+    std::string error;
+    if (!read_header(input, header, error))
+    {
+        std::fprintf(stderr, "error: %s: %s\n", input_path, error.c_str());
+        return 1;
+    }
+
+    FILE* output = num_paths == 2 ? std::fopen(argv[index + 1], "w") : stdout;
+    if (!output)
+    {
+        std::fprintf(stderr, "error: cannot create '%s'\n", argv[index + 1]);
+        return 1;
+    }
+
+    if (per_sample)
+        std::fprintf(output, "position,project_time,gain,channel_gains\n");
+    else
+        std::fprintf(output,
+                     "position,project_time,length,start,increment,phase,gap,channel_gains\n");
+
+    long long num_records = 0;
+    long long num_samples = 0;
+    long long num_gaps    = 0;
+    dsp::capture_record record;
+    while (input.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        // Zeroed records follow the last one if the file was not closed.
+        if (record.length <= 0)
+            break;
+
+        const bool is_gap     = (record.flags & dsp::kCaptureGap) != 0;
+        const int has_channel = (record.flags & dsp::kCaptureChannelGains) != 0 ? 1 : 0;
+        if (per_sample)
+        {
+            for (std::int32_t i = 0; i < record.length; ++i)
+            {
+                const float gain = record.get_gain(i);
+                const long long project_time =
+                    record.project_time < 0 ? -1 : record.project_time + i;
+                std::fprintf(output, "%lld,%lld,%.9g,%d\n",
+                             static_cast<long long>(record.position + i), project_time, gain,
+                             has_channel);
+            }
+        }
+        else
+        {
+            std::fprintf(output, "%lld,%lld,%d,%.9g,%.9g,%d,%d,%d\n",
+                         static_cast<long long>(record.position),
+                         static_cast<long long>(record.project_time), record.length,
+                         record.start, record.increment, record.get_phase(), is_gap ? 1 : 0,
+                         has_channel);
+        }
+
+        ++num_records;
+        num_samples += record.length;
+        num_gaps += is_gap ? 1 : 0;
+    }
+
+    if (output != stdout)
+        std::fclose(output);
+
+    const auto start_time = static_cast<std::time_t>(header.start_time);
+    char stamp[32]        = {};
+    if (const std::tm* utc = std::gmtime(&start_time))
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S UTC", utc);
+
+    std::fprintf(stderr, "%s: started %s, %.0f Hz, %lld records, %lld samples, %lld gaps\n",
+                 input_path, stamp, header.sample_rate, num_records, num_samples, num_gaps);
+    return 0;
+}
@@ -0,0 +1,181 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Times opening the editors of many controller instances, headless. No
+// window is opened: an editor is created through the controller as by the
+// host and its views are built from the description as on open(). The
+// cold run does what every open did before the description was shared:
+// parse the XML and build the views, decoding the knob filmstrip.
+//
+// Usage: gain-editor-bench [-n instances] resource_dir
+//
+// 'resource_dir' holds gain_automator_editor.uidesc and the knob bitmaps,
+// e.g. the Contents/Resources folder of the built plug-in. Fails if the
+// description cannot be parsed or the views cannot be built.
+
+#include "gain_automator_controller.h"
+#include "gain_automator_editor_description.h"
+#include "pluginterfaces/base/smartpointer.h"
+#include "pluginterfaces/gui/iplugview.h"
+#include "vstgui/lib/cview.h"
+#include "vstgui/lib/platform/linux/linuxfactory.h"
+#include "vstgui/lib/platform/platformfactory.h"
+#include "vstgui/lib/vstguiinit.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------
+struct timing
+{
+    double first_ms = 0.;
+    double total_ms = 0.;
+    int num_opens   = 0;
+
+    void add(double ms)
+    {
+        if (num_opens++ == 0)
+            first_ms = ms;
+        total_ms += ms;
+    }
+
+    double get_mean_rest_ms() const
+    {
+        return num_opens > 1 ? (total_ms - first_ms) / (num_opens - 1) : 0.;
+    }
+};
+
+//------------------------------------------------------------------------
+double get_elapsed_ms(clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+}
+
+//------------------------------------------------------------------------
+// Builds the editor's views like VST3Editor::open(), without a frame.
+bool build_views(VSTGUI::UIDescription& description)
+{
+    VSTGUI::CView* view = description.createView(EditorDescription::kViewName, nullptr);
+    if (!view)
+        return false;
+
+    view->forget();
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool open_cold(timing& result)
+{
+    const auto begin = clock::now();
+    auto description = VSTGUI::makeOwned<VSTGUI::UIDescription>(
+        VSTGUI::CResourceDescription(EditorDescription::kFileName));
+    const bool ok = description->parse() && build_views(*description);
+    result.add(get_elapsed_ms(begin));
+    return ok;
+}
+
+//------------------------------------------------------------------------
+bool open_shared(GainAutomatorController& controller, timing& result)
+{
+    const auto begin                   = clock::now();
+    Steinberg::IPlugView* editor       = controller.createView(Steinberg::Vst::ViewType::kEditor);
+    VSTGUI::UIDescription* description = EditorDescription::get();
+    const bool ok                      = editor && description && build_views(*description);
+    result.add(get_elapsed_ms(begin));
+
+    if (editor)
+        editor->release();
+    return ok;
+}
+
+//------------------------------------------------------------------------
+void print(const char* name, const timing& result)
+{
+    std::printf("%-8s %12.3f %12.3f %12.3f\n", name, result.first_ms, result.get_mean_rest_ms(),
+                result.total_ms);
+}
+
+//------------------------------------------------------------------------
+int usage(const char* name)
+{
+    std::fprintf(stderr, "Usage: %s [-n instances] resource_dir\n", name);
+    return 1;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int num_instances = 50;
+    std::string resource_dir;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "-n") == 0 && has_value)
+            num_instances = std::atoi(argv[++i]);
+        else if (resource_dir.empty() && argv[i][0] != '-')
+            resource_dir = argv[i];
+        else
+            return usage(argv[0]);
+    }
+
+    if (num_instances < 1 || resource_dir.empty())
+        return usage(argv[0]);
+    if (resource_dir.back() != '/')
+        resource_dir += '/';
+
+    // Without a display: neither frames nor the run loop are used.
+    VSTGUI::init(dlopen(nullptr, RTLD_LAZY));
+    VSTGUI::getPlatformFactory().asLinuxFactory()->setResourcePath(resource_dir);
+
+    bool ok = true;
+    timing cold;
+    for (int i = 0; ok && i < num_instances; ++i)
+        ok = open_cold(cold);
+
+    timing shared;
+    std::vector<Steinberg::IPtr<GainAutomatorController>> controllers;
+    for (int i = 0; ok && i < num_instances; ++i)
+    {
+        controllers.push_back(Steinberg::owned(new GainAutomatorController));
+        ok = controllers.back()->initialize(nullptr) == Steinberg::kResultOk;
+    }
+    for (int i = 0; ok && i < num_instances; ++i)
+        ok = open_shared(*controllers[i], shared);
+
+    // The last one frees the shared description, while VSTGUI is still up.
+    for (auto& controller : controllers)
+        controller->terminate();
+    controllers.clear();
+
+    if (ok)
+    {
+        std::printf("instances: %d\n\n", num_instances);
+        std::printf("%-8s %12s %12s %12s\n", "open", "first ms", "others ms", "total ms");
+        print("cold", cold);
+        print("shared", shared);
+    }
+    else
+    {
+        std::fprintf(stderr, "Cannot build the editor from %s%s\n", resource_dir.c_str(),
+                     EditorDescription::kFileName);
+    }
+
+    VSTGUI::exit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Measures formatting and parsing of the gain parameter's display string,
+// as called by hosts through getParamStringByValue/getParamValueByString.
+// The table path is compared against formatting through std::string and
+// a string stream, the way the parameter used to do it.
+//
+// Usage: gain-format-bench [seconds_per_run]
+
+#include "gain_automator_gain_format.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+using clock_type = std::chrono::steady_clock;
+using string128  = char16_t[128];
+
+//------------------------------------------------------------------------
+void format_table(double normalized, string128 string)
+{
+    std::memcpy(string, dsp::to_decibel_string(dsp::gain_law::decibel, normalized),
+                dsp::kMaxDecibelStringSize * sizeof(char16_t));
+}
+
+//------------------------------------------------------------------------
+void format_stream(double normalized, string128 string)
+{
+    const double dB = dsp::normalized_to_decibel(normalized);
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(dB < -10. ? 1 : 2) << dB;
+    const std::string text = stream.str();
+
+    size_t i = 0;
+    for (; i < text.size() && i < 127; ++i)
+        string[i] = static_cast<char16_t>(text[i]);
+    string[i] = 0;
+}
+
+//------------------------------------------------------------------------
+bool parse_table(const char16_t* string, double& normalized)
+{
+    return dsp::from_decibel_string(dsp::gain_law::decibel, string, normalized);
+}
+
+//------------------------------------------------------------------------
+bool parse_stream(const char16_t* string, double& normalized)
+{
+    std::string text;
+    for (; *string; ++string)
+        text.push_back(static_cast<char>(*string));
+
+    normalized = dsp::decibel_to_normalized(std::strtod(text.c_str(), nullptr));
+    return true;
+}
+
+//------------------------------------------------------------------------
+template <typename Func>
+double run_format(Func func, double seconds)
+{
+    string128 string = {};
+    long long calls  = 0;
+    double elapsed   = 0.;
+    unsigned sink    = 0;
+    const auto begin = clock_type::now();
+    while (elapsed < seconds)
+    {
+        // Sweep the whole range like a fader drag, in chunks between clock reads.
+        for (int i = 0; i < 1024; ++i)
+        {
+            func(static_cast<double>((calls + i) % 4096) / 4095., string);
+            sink += string[1];
+        }
+        calls += 1024;
+        elapsed = std::chrono::duration<double>(clock_type::now() - begin).count();
+    }
+
+    if (sink == 0)
+        std::printf(" ");
+    return elapsed * 1e9 / static_cast<double>(calls);
+}
+
+//------------------------------------------------------------------------
+template <typename Func>
+double run_parse(Func func, double seconds)
+{
+    const char16_t* strings[] = {u"-12.3", u"-0.25", u"-96.0", u"-48.7 dB", u"0.00", u"-9.99"};
+    constexpr int num_strings = sizeof(strings) / sizeof(strings[0]);
+
+    long long calls  = 0;
+    double elapsed   = 0.;
+    double sink      = 0.;
+    const auto begin = clock_type::now();
+    while (elapsed < seconds)
+    {
+        for (int i = 0; i < 1024; ++i)
+        {
+            double normalized = 0.;
+            func(strings[(calls + i) % num_strings], normalized);
+            sink += normalized;
+        }
+        calls += 1024;
+        elapsed = std::chrono::duration<double>(clock_type::now() - begin).count();
+    }
+
+    if (sink == 0.)
+        std::printf(" ");
+    return elapsed * 1e9 / static_cast<double>(calls);
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+    if (seconds <= 0.)
+    {
+        std::fprintf(stderr, "Usage: %s [seconds_per_run]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%-24s %10s\n", "", "ns/call");
+    std::printf("%-24s %10.2f\n", "toString (table)", run_format(format_table, seconds));
+    std::printf("%-24s %10.2f\n", "toString (stream)", run_format(format_stream, seconds));
+    std::printf("%-24s %10.2f\n", "fromString (table)", run_parse(parse_table, seconds));
+    std::printf("%-24s %10.2f\n", "fromString (stream)", run_parse(parse_stream, seconds));
+
+    return 0;
+}
@@ -0,0 +1,285 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Drives one gain group leader and several followers in one process, the
+// way a host would, and checks that the followers line up with the leader
+// sample for sample. Every host cycle has a random block size, random gain
+// automation on the leader only and processes the instances in a random
+// order, or all at once on their own threads with -p; from time to time
+// all transports jump to a random position, like a loop.
+//
+// Followers report their one block delay as latency. Compensated for it,
+// as a host would, follower 0 runs at unity gain and must reproduce the
+// leader's output bit exactly. Every other follower has its own gain as an
+// offset, its output must match the leader's times the offset (within
+// float rounding). Any follower block which missed the leader's curve
+// while playing fails the check as well.
+//
+// Usage: gain-group-check [-f num_followers] [-c cycles] [-b max_block_size] [-d] [-p]
+//
+// Returns 0 if all followers line up, 1 otherwise.
+
+#include "gain_automator_gain_bus.h"
+#include "gain_automator_gain_format.h"
+#include "gain_automator_gain_law.h"
+#include "gain_automator_param_ids.h"
+#include "processor_host.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+constexpr int kNumChannels    = 2;
+constexpr double kSampleRate  = 48000.;
+constexpr int kGroup          = 0;
+constexpr double kGainGroup   = 1. / 8.; // 'Gain Group' entry 1, kGroup
+constexpr double kLeader      = 0.;
+constexpr double kFollower    = 1.;
+constexpr int kLocateInterval = 250; // cycles, on average
+constexpr double kTolerance   = 1e-6;
+
+//------------------------------------------------------------------------
+struct options
+{
+    int num_followers  = 4;
+    int num_cycles     = 5000;
+    int max_block_size = 1024;
+    bool is_double     = false;
+    bool is_parallel   = false;
+};
+
+//------------------------------------------------------------------------
+void print_usage()
+{
+    std::fprintf(stderr,
+                 "usage: gain-group-check [-f num_followers] [-c cycles] [-b max_block_size] "
+                 "[-d] [-p]\n");
+}
+
+//------------------------------------------------------------------------
+bool parse_options(int argc, char* argv[], options& opts)
+{
+    for (int index = 1; index < argc; ++index)
+    {
+        const char* arg    = argv[index];
+        const bool is_last = index + 1 >= argc;
+        if (std::strcmp(arg, "-f") == 0 && !is_last)
+            opts.num_followers = std::atoi(argv[++index]);
+        else if (std::strcmp(arg, "-c") == 0 && !is_last)
+            opts.num_cycles = std::atoi(argv[++index]);
+        else if (std::strcmp(arg, "-b") == 0 && !is_last)
+            opts.max_block_size = std::atoi(argv[++index]);
+        else if (std::strcmp(arg, "-d") == 0)
+            opts.is_double = true;
+        else if (std::strcmp(arg, "-p") == 0)
+            opts.is_parallel = true;
+        else
+            return false;
+    }
+    return opts.num_followers > 0 && opts.num_cycles > 0 && opts.max_block_size > 0;
+}
+
+//------------------------------------------------------------------------
+double get_output(tools::processor_host& host, int channel, int index)
+{
+    return host.is_double() ? host.get_output64(channel)[index]
+                            : host.get_output32(channel)[index];
+}
+
+//------------------------------------------------------------------------
+void process_all(std::vector<std::unique_ptr<tools::processor_host>>& hosts,
+                 const std::vector<int>& order,
+                 int num_samples,
+                 bool is_parallel)
+{
+    if (!is_parallel)
+    {
+        for (int index : order)
+            hosts[index]->process(num_samples);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (int index : order)
+        threads.emplace_back([&hosts, index, num_samples] { hosts[index]->process(num_samples); });
+    for (auto& thread : threads)
+        thread.join();
+}
+
+//------------------------------------------------------------------------
+void fill_input(tools::processor_host& host, const std::vector<float>& noise, int num_samples)
+{
+    for (int channel = 0; channel < kNumChannels; ++channel)
+    {
+        const float* src = noise.data() + channel * num_samples;
+        if (host.is_double())
+            std::copy(src, src + num_samples, host.get_input64(channel));
+        else
+            std::copy(src, src + num_samples, host.get_input32(channel));
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    options opts;
+    if (!parse_options(argc, argv, opts))
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<tools::processor_host>> hosts;
+    std::vector<float> offsets; // linear gain of each follower
+    for (int index = 0; index <= opts.num_followers; ++index)
+    {
+        auto host = std::make_unique<tools::processor_host>();
+        if (!host->setup(kNumChannels, opts.max_block_size, kSampleRate, opts.is_double))
+        {
+            std::fprintf(stderr, "error: processor setup failed\n");
+            return 1;
+        }
+
+        // Host 0 leads, follower n is offset by -3 dB * (n - 1), follower 0 by nothing.
+        const bool is_leader = index == 0;
+        host->add_point(kParamGainGroupId, 0, kGainGroup);
+        host->add_point(kParamGroupRoleId, 0, is_leader ? kLeader : kFollower);
+        if (!is_leader)
+        {
+            const double offset     = index == 1 ? 0. : -3. * (index - 1);
+            const double normalized = dsp::decibel_to_normalized(offset);
+            host->add_point(kParamGainId, 0, normalized);
+            offsets.push_back(dsp::to_gain(dsp::gain_law::decibel, static_cast<float>(normalized)));
+        }
+        hosts.push_back(std::move(host));
+    }
+
+    // One silent block with the transport stopped applies the roles. A host
+    // would have them from the controller before starting.
+    std::vector<int> order(hosts.size());
+    for (int index = 0; index < static_cast<int>(order.size()); ++index)
+        order[index] = index;
+    for (auto& host : hosts)
+    {
+        host->set_playing(false);
+        host->process(opts.max_block_size);
+        host->set_playing(true);
+        host->set_project_time(0);
+    }
+
+    // The leader's output, kept as long as the followers are late.
+    std::vector<int> latencies;
+    int max_latency = 0;
+    for (auto& host : hosts)
+    {
+        latencies.push_back(host->get_latency_samples() - hosts.front()->get_latency_samples());
+        max_latency = std::max(max_latency, latencies.back());
+    }
+    const int history_size = max_latency + opts.max_block_size;
+    std::vector<std::vector<double>> history(kNumChannels, std::vector<double>(history_size, 0.));
+
+    auto& leader = *hosts.front();
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> block_size_dist(1, opts.max_block_size);
+    std::uniform_real_distribution<float> value_dist(0.f, 1.f);
+    std::uniform_real_distribution<float> noise_dist(-1.f, 1.f);
+    std::uniform_int_distribution<int> event_dist(0, kLocateInterval - 1);
+
+    std::vector<float> noise(kNumChannels * opts.max_block_size);
+    long long num_samples_total = 0;
+    long long num_mismatches    = 0;
+    double max_deviation        = 0.;
+    for (int cycle = 0; cycle < opts.num_cycles; ++cycle)
+    {
+        const int num_samples = block_size_dist(random);
+
+        if (cycle > 0 && event_dist(random) == 0)
+        {
+            const long long position = random() % (60 * static_cast<long long>(kSampleRate));
+            for (auto& host : hosts)
+                host->set_project_time(position);
+        }
+
+        // Automation on the leader only, a few points per block or none.
+        const int num_points = std::max(0, static_cast<int>(random() % 6) - 2);
+        std::vector<int> point_offsets;
+        for (int point = 0; point < num_points; ++point)
+            point_offsets.push_back(random() % num_samples);
+        std::sort(point_offsets.begin(), point_offsets.end());
+        for (int offset : point_offsets)
+            leader.add_point(kParamGainId, offset, value_dist(random));
+
+        for (float& sample : noise)
+            sample = noise_dist(random);
+
+        // One host cycle, in any order.
+        for (auto& host : hosts)
+            fill_input(*host, noise, num_samples);
+        std::shuffle(order.begin(), order.end(), random);
+        process_all(hosts, order, num_samples, opts.is_parallel);
+
+        for (int channel = 0; channel < kNumChannels; ++channel)
+        {
+            for (int index = 0; index < num_samples; ++index)
+                history[channel][(num_samples_total + index) % history_size] =
+                    get_output(leader, channel, index);
+        }
+
+        for (int follower = 0; follower < opts.num_followers; ++follower)
+        {
+            auto& host        = *hosts[follower + 1];
+            const auto offset = static_cast<double>(offsets[follower]);
+            const int latency = latencies[follower + 1];
+            for (int channel = 0; channel < kNumChannels; ++channel)
+            {
+                // Before its latency, the follower plays what it got before the start.
+                for (int index = 0; index < num_samples; ++index)
+                {
+                    const long long leader_index = num_samples_total + index - latency;
+                    if (leader_index < 0)
+                        continue;
+
+                    const double expected =
+                        history[channel][leader_index % history_size] * offset;
+                    const double actual    = get_output(host, channel, index);
+                    const double deviation = std::abs(actual - expected);
+                    max_deviation          = std::max(max_deviation, deviation);
+
+                    // Without an offset there is nothing to round differently.
+                    const bool is_mismatch =
+                        offset == 1. ? actual != expected : deviation > kTolerance;
+                    if (is_mismatch && num_mismatches++ == 0)
+                        std::fprintf(stderr,
+                                     "first mismatch: cycle %d, follower %d, channel %d, "
+                                     "sample %d: %.9g instead of %.9g\n",
+                                     cycle, follower, channel, index, actual, expected);
+                }
+            }
+        }
+        num_samples_total += num_samples;
+    }
+
+    const unsigned long long num_misses = dsp::gain_bus::get_instance().get_num_misses(kGroup);
+    std::printf("%d followers, %d cycles, %lld samples (%s%s): %lld mismatches, max deviation "
+                "%g, %llu missed reads\n",
+                opts.num_followers, opts.num_cycles, num_samples_total,
+                opts.is_double ? "64 bit" : "32 bit", opts.is_parallel ? ", parallel" : "",
+                num_mismatches, max_deviation, num_misses);
+
+    return num_mismatches == 0 && num_misses == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Measures the cost of the gain kernel per channel and sample for growing
+// channel counts. With the curve computed once per block the cost per
+// channel is expected to stay flat from stereo up to 3rd order ambisonics.
+// The gain law is part of the curve, so its cost shows up most at 1 channel.
+//
+// Usage: gain-kernel-bench [block_size] [seconds_per_run]
+
+#include "gain_automator_gain_curve.h"
+#include "gain_automator_gain_law.h"
+#include "gain_automator_kernel.h"
+#include "gain_automator_segments.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+enum class automation
+{
+    none,
+    one_point,
+    every_sample
+};
+
+//------------------------------------------------------------------------
+const char* to_string(automation mode)
+{
+    switch (mode)
+    {
+        case automation::one_point: return "one point";
+        case automation::every_sample: return "every sample";
+        default: return "none";
+    }
+}
+
+//------------------------------------------------------------------------
+const char* to_string(dsp::gain_law law)
+{
+    switch (law)
+    {
+        case dsp::gain_law::decibel: return "decibel";
+        case dsp::gain_law::equal_power: return "equal power";
+        default: return "linear";
+    }
+}
+
+//------------------------------------------------------------------------
+void build_segments(automation mode, int block_size, int block_index, dsp::gain_segments& segments)
+{
+    const float start = 0.5f + 0.25f * std::sin(0.01f * block_index);
+    segments.begin(start);
+    switch (mode)
+    {
+        case automation::none: break;
+        case automation::one_point: segments.add_point(block_size - 1, 1.f - start); break;
+        case automation::every_sample:
+            for (int i = 0; i < block_size; ++i)
+                segments.add_point(i, start + 0.0001f * i * ((i & 1) ? 1.f : -1.f));
+            break;
+    }
+    segments.end(block_size);
+}
+
+//------------------------------------------------------------------------
+double run(const dsp::gain_kernel<float>& kernel,
+           dsp::gain_law law,
+           automation mode,
+           int num_channels,
+           int block_size,
+           double seconds)
+{
+    // Separate in and out buffers, processing in place would decay into denormals.
+    using buffer = std::vector<float>;
+    std::vector<buffer> in_buffers(num_channels, buffer(block_size, 0.5f));
+    std::vector<buffer> out_buffers(num_channels, buffer(block_size, 0.f));
+    std::vector<const float*> in(num_channels);
+    std::vector<float*> out(num_channels);
+    for (int c = 0; c < num_channels; ++c)
+    {
+        in[c]  = in_buffers[c].data();
+        out[c] = out_buffers[c].data();
+    }
+
+    dsp::gain_segments segments;
+    segments.reserve(block_size);
+    dsp::gain_curve curve;
+    curve.reserve(block_size);
+
+    using clock = std::chrono::steady_clock;
+
+    long long samples = 0;
+    double elapsed    = 0.;
+    int block_index   = 0;
+    const auto begin  = clock::now();
+    while (elapsed < seconds)
+    {
+        build_segments(mode, block_size, block_index++, segments);
+        curve.build(segments, law, kernel.level);
+        dsp::apply_gain_curve(kernel, curve, in.data(), out.data(), num_channels, nullptr);
+        samples += block_size;
+        elapsed = std::chrono::duration<double>(clock::now() - begin).count();
+    }
+
+    // Nanoseconds per sample and channel
+    return elapsed * 1e9 / (static_cast<double>(samples) * num_channels);
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const int block_size = argc > 1 ? std::atoi(argv[1]) : 512;
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 0.25;
+    if (block_size <= 0 || seconds <= 0.)
+    {
+        std::fprintf(stderr, "Usage: %s [block_size] [seconds_per_run]\n", argv[0]);
+        return 1;
+    }
+
+    const auto& kernel = dsp::get_gain_kernel<float>(dsp::detect_simd_level());
+    std::printf("kernel: %s, block size: %d\n\n", dsp::to_string(kernel.level), block_size);
+    std::printf("%-12s %-14s %9s %18s\n", "gain law", "automation", "channels",
+                "ns/sample/channel");
+
+    const int channel_counts[] = {1, 2, 4, 6, 8, 12, 16, 24, 32, 64};
+    for (auto law : {dsp::gain_law::linear, dsp::gain_law::decibel})
+    {
+        for (auto mode : {automation::none, automation::one_point, automation::every_sample})
+        {
+            for (int num_channels : channel_counts)
+            {
+                const double ns = run(kernel, law, mode, num_channels, block_size, seconds);
+                std::printf("%-12s %-14s %9d %18.4f\n", to_string(law), to_string(mode),
+                            num_channels, ns);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Thins automation lanes with the edit thinning of the controller and
+// reports how many points it removed per parameter.
+//
+// Usage: gain-lane-thin [-t tolerance] [-i interval_ms] [-r sample_rate]
+//                       automation.txt [thinned.txt]
+//
+// The automation file has the format of gain-render: one
+// '<sample position> <normalized value> [parameter id]' per line. Each
+// parameter is thinned as one edit, so its first and last point stay. The
+// thinned lanes are written to 'thinned.txt' in the same format, sorted
+// by position.
+
+#include "gain_automator_edit_thinning.h"
+#include "gain_automator_param_ids.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+struct lane_point
+{
+    long long position;
+    unsigned int id;
+    double value;
+};
+
+using lanes = std::map<unsigned int, std::vector<lane_point>>;
+
+//------------------------------------------------------------------------
+bool read_automation(const std::string& path, lanes& points, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open '" + path + "'";
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        ++line_number;
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream stream(line);
+        lane_point point{0, kParamGainId, 0.};
+        if (!(stream >> point.position >> point.value) || point.position < 0 ||
+            point.value < 0. || point.value > 1.)
+        {
+            error = path + ":" + std::to_string(line_number) + ": expected '<position> <value>'";
+            return false;
+        }
+
+        unsigned int id = 0;
+        if (stream >> id)
+            point.id = id;
+
+        points[point.id].push_back(point);
+    }
+
+    for (auto& lane : points)
+    {
+        std::stable_sort(lane.second.begin(), lane.second.end(),
+                         [](const lane_point& a, const lane_point& b) {
+                             return a.position < b.position;
+                         });
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+std::vector<lane_point> thin_lane(const std::vector<lane_point>& lane,
+                                  double sample_rate,
+                                  double tolerance,
+                                  double min_interval)
+{
+    std::vector<dsp::edit_point> points;
+    points.reserve(lane.size());
+    for (const lane_point& point : lane)
+        points.push_back({static_cast<double>(point.position) / sample_rate, point.value});
+
+    // Kept points are points of the lane, their positions round trip.
+    std::vector<lane_point> thinned;
+    for (const dsp::edit_point& point : dsp::thin_edit_points(points, tolerance, min_interval))
+        thinned.push_back({std::llround(point.time * sample_rate), lane.front().id, point.value});
+    return thinned;
+}
+
+//------------------------------------------------------------------------
+bool write_automation(const std::string& path, const lanes& points, std::string& error)
+{
+    std::vector<lane_point> sorted;
+    for (const auto& lane : points)
+        sorted.insert(sorted.end(), lane.second.begin(), lane.second.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const lane_point& a, const lane_point& b) {
+        return a.position < b.position;
+    });
+
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        error = "cannot write '" + path + "'";
+        return false;
+    }
+
+    std::fprintf(file, "# <sample position> <normalized value> [parameter id]\n");
+    for (const lane_point& point : sorted)
+        std::fprintf(file, "%lld %.17g %u\n", point.position, point.value, point.id);
+
+    const bool ok = std::fclose(file) == 0;
+    if (!ok)
+        error = "cannot write '" + path + "'";
+    return ok;
+}
+
+//------------------------------------------------------------------------
+int usage(const char* name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-t tolerance] [-i interval_ms] [-r sample_rate] automation.txt "
+                 "[thinned.txt]\n",
+                 name);
+    return 1;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    double tolerance   = dsp::kDefaultEditTolerance;
+    double interval_ms = dsp::kDefaultEditMinInterval * 1000.;
+    double sample_rate = 48000.;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "-t") == 0 && has_value)
+            tolerance = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-i") == 0 && has_value)
+            interval_ms = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-r") == 0 && has_value)
+            sample_rate = std::atof(argv[++i]);
+        else if (argv[i][0] == '-')
+            return usage(argv[0]);
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty() || paths.size() > 2 || tolerance < 0. || interval_ms < 0. ||
+        sample_rate <= 0.)
+        return usage(argv[0]);
+
+    std::string error;
+    lanes points;
+    if (!read_automation(paths[0], points, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf("tolerance: %g, interval: %g ms\n\n", tolerance, interval_ms);
+    std::printf("%9s %10s %10s %10s %9s\n", "parameter", "points", "kept", "removed", "removed%");
+
+    size_t total_points = 0;
+    size_t total_kept   = 0;
+    lanes thinned;
+    for (const auto& lane : points)
+    {
+        thinned[lane.first] = thin_lane(lane.second, sample_rate, tolerance, interval_ms * 0.001);
+
+        const size_t num_points = lane.second.size();
+        const size_t num_kept   = thinned[lane.first].size();
+        std::printf("%9u %10zu %10zu %10zu %8.1f%%\n", lane.first, num_points, num_kept,
+                    num_points - num_kept, 100. * (num_points - num_kept) / num_points);
+        total_points += num_points;
+        total_kept += num_kept;
+    }
+    if (total_points > 0)
+    {
+        std::printf("%9s %10zu %10zu %10zu %8.1f%%\n", "all", total_points, total_kept,
+                    total_points - total_kept,
+                    100. * (total_points - total_kept) / total_points);
+    }
+
+    if (paths.size() == 2 && !write_automation(paths[1], thinned, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
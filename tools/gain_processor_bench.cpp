@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Measures GainAutomatorProcessor::process() end to end, including the
+// parameter decoding, for combinations of block size, channel count and
+// automation density. Only the process() calls are timed, filling the
+// host's parameter queues is not.
+//
+// Usage: gain-processor-bench [-b block_sizes] [-c channel_counts]
+//                             [-s seconds_per_run] [-d] [-r]
+//
+// Lists are comma separated, e.g. -b 64,512 -c 2,16. -d selects 64 bit
+// processing. The host renders offline, where large blocks are spread
+// over a worker pool; -r selects real-time processing on one thread.
+
+#include "gain_automator_param_ids.h"
+#include "processor_host.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+enum class automation
+{
+    none,
+    one_point,
+    every_sample
+};
+
+//------------------------------------------------------------------------
+const char* to_string(automation mode)
+{
+    switch (mode)
+    {
+        case automation::one_point: return "one point";
+        case automation::every_sample: return "every sample";
+        default: return "none";
+    }
+}
+
+//------------------------------------------------------------------------
+std::vector<int> parse_list(const char* arg)
+{
+    std::vector<int> values;
+    std::stringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        values.push_back(std::atoi(item.c_str()));
+    return values;
+}
+
+//------------------------------------------------------------------------
+struct result
+{
+    double ns_per_sample           = 0.;
+    double ns_per_sample_channel   = 0.;
+    double mega_samples_per_second = 0.;
+};
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void fill_inputs(tools::processor_host& host, int block_size);
+
+template <>
+void fill_inputs<float>(tools::processor_host& host, int block_size)
+{
+    for (int c = 0; c < host.get_num_channels(); ++c)
+        std::fill_n(host.get_input32(c), block_size, 0.5f);
+}
+
+template <>
+void fill_inputs<double>(tools::processor_host& host, int block_size)
+{
+    for (int c = 0; c < host.get_num_channels(); ++c)
+        std::fill_n(host.get_input64(c), block_size, 0.5);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+bool run(automation mode,
+         int num_channels,
+         int block_size,
+         double seconds,
+         bool is_offline,
+         result& res)
+{
+    tools::processor_host host;
+    const bool is_double = sizeof(SampleType) == sizeof(double);
+    if (!host.setup(num_channels, block_size, 48000., is_double, is_offline))
+        return false;
+
+    // Separate in and out buffers, the input stays untouched.
+    fill_inputs<SampleType>(host, block_size);
+
+    using clock = std::chrono::steady_clock;
+
+    long long samples   = 0;
+    double elapsed      = 0.;
+    double process_time = 0.;
+    int block_index     = 0;
+    const auto begin    = clock::now();
+    while (elapsed < seconds)
+    {
+        // Keep the gain away from 0 and 1, those take the fast paths.
+        const double start = 0.5 + 0.25 * std::sin(0.01 * block_index++);
+        switch (mode)
+        {
+            case automation::none: break;
+            case automation::one_point:
+                host.add_point(kParamGainId, block_size - 1, 1. - start);
+                break;
+            case automation::every_sample:
+                for (int i = 0; i < block_size; ++i)
+                    host.add_point(kParamGainId, i, start + 0.0001 * i * ((i & 1) ? 1. : -1.));
+                break;
+        }
+        if (mode == automation::none && block_index == 1)
+            host.add_point(kParamGainId, 0, start);
+
+        const auto process_begin = clock::now();
+        host.process(block_size);
+        process_time += std::chrono::duration<double>(clock::now() - process_begin).count();
+
+        samples += block_size;
+        elapsed = std::chrono::duration<double>(clock::now() - begin).count();
+    }
+
+    res.ns_per_sample           = process_time * 1e9 / static_cast<double>(samples);
+    res.ns_per_sample_channel   = res.ns_per_sample / num_channels;
+    res.mega_samples_per_second = samples * num_channels / process_time * 1e-6;
+    return true;
+}
+
+//------------------------------------------------------------------------
+int usage(const char* name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-b block_sizes] [-c channel_counts] [-s seconds_per_run] [-d] [-r]\n",
+                 name);
+    return 1;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    std::vector<int> block_sizes    = {32, 64, 128, 512, 1024, 4096};
+    std::vector<int> channel_counts = {1, 2, 8, 16, 64};
+    double seconds                  = 0.25;
+    bool is_double                  = false;
+    bool is_offline                 = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "-b") == 0 && has_value)
+            block_sizes = parse_list(argv[++i]);
+        else if (std::strcmp(argv[i], "-c") == 0 && has_value)
+            channel_counts = parse_list(argv[++i]);
+        else if (std::strcmp(argv[i], "-s") == 0 && has_value)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-d") == 0)
+            is_double = true;
+        else if (std::strcmp(argv[i], "-r") == 0)
+            is_offline = false;
+        else
+            return usage(argv[0]);
+    }
+
+    if (block_sizes.empty() || channel_counts.empty() || seconds <= 0.)
+        return usage(argv[0]);
+
+    std::printf("precision: %d bit, %s\n\n", is_double ? 64 : 32,
+                is_offline ? "offline" : "real-time");
+    std::printf("%6s %9s %-14s %12s %20s %14s\n", "block", "channels", "automation", "ns/sample",
+                "ns/sample/channel", "Msamples/s");
+
+    for (int block_size : block_sizes)
+    {
+        for (int num_channels : channel_counts)
+        {
+            for (auto mode : {automation::none, automation::one_point, automation::every_sample})
+            {
+                result res;
+                const bool ok =
+                    is_double
+                        ? run<double>(mode, num_channels, block_size, seconds, is_offline, res)
+                        : run<float>(mode, num_channels, block_size, seconds, is_offline, res);
+                if (!ok)
+                {
+                    std::fprintf(stderr, "setup failed: block size %d, %d channels\n",
+                                 block_size, num_channels);
+                    return 1;
+                }
+
+                std::printf("%6d %9d %-14s %12.4f %20.4f %14.1f\n", block_size, num_channels,
+                            to_string(mode), res.ns_per_sample, res.ns_per_sample_channel,
+                            res.mega_samples_per_second);
+            }
+        }
+    }
+
+    return 0;
+}
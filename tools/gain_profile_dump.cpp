@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Prints process() profiles (.gapr, see HA_GAIN_PROFILE_DIR).
+//
+// Usage: gain-profile-dump file.gapr...
+//
+// For every file: the number of calls, average and worst time, the time
+// histogram of every processing path with estimated percentiles, and the
+// histograms of block sizes and automation points per block. Times are in
+// microseconds, converted with the counter rate measured while profiling.
+// Buckets are powers of two, percentiles interpolate linearly within one.
+
+#include "gain_automator_profile.h"
+
+#include <cstdio>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+// [lower, upper) of a bucket, see dsp::to_bucket()
+double get_bucket_lower(int bucket)
+{
+    return bucket == 0 ? 0. : static_cast<double>(1ull << (bucket - 1));
+}
+
+//------------------------------------------------------------------------
+double get_bucket_upper(int bucket)
+{
+    return static_cast<double>(1ull << bucket);
+}
+
+//------------------------------------------------------------------------
+template <typename Histogram>
+std::uint64_t get_total(const Histogram& histogram)
+{
+    std::uint64_t total = 0;
+    for (const std::uint64_t count : histogram)
+        total += count;
+    return total;
+}
+
+//------------------------------------------------------------------------
+template <typename Histogram>
+double get_percentile(const Histogram& histogram, double percentile)
+{
+    const double rank = percentile * 0.01 * static_cast<double>(get_total(histogram));
+    double below      = 0.;
+    for (std::size_t bucket = 0; bucket < histogram.size(); ++bucket)
+    {
+        const double count = static_cast<double>(histogram[bucket]);
+        if (count > 0. && below + count >= rank)
+        {
+            const double lower = get_bucket_lower(static_cast<int>(bucket));
+            const double upper = get_bucket_upper(static_cast<int>(bucket));
+            return lower + (upper - lower) * (rank - below) / count;
+        }
+        below += count;
+    }
+    return 0.;
+}
+
+//------------------------------------------------------------------------
+void print_cycle_histogram(const dsp::profile_snapshot::cycle_histogram& histogram,
+                           double us_per_cycle)
+{
+    const std::uint64_t total = get_total(histogram);
+    for (int bucket = 0; bucket < dsp::kNumCycleBuckets; ++bucket)
+    {
+        if (histogram[bucket] == 0)
+            continue;
+
+        std::printf("    %10.2f - %10.2f us %12llu %6.2f %%\n",
+                    get_bucket_lower(bucket) * us_per_cycle,
+                    get_bucket_upper(bucket) * us_per_cycle,
+                    static_cast<unsigned long long>(histogram[bucket]),
+                    100. * static_cast<double>(histogram[bucket]) / static_cast<double>(total));
+    }
+}
+
+//------------------------------------------------------------------------
+void print_count_histogram(const char* name,
+                           const dsp::profile_snapshot::count_histogram& histogram)
+{
+    const std::uint64_t total = get_total(histogram);
+    if (total == 0)
+        return;
+
+    std::printf("  %s\n", name);
+    for (int bucket = 0; bucket < dsp::kNumCountBuckets; ++bucket)
+    {
+        if (histogram[bucket] == 0)
+            continue;
+
+        std::printf("    %6.0f - %6.0f %12llu %6.2f %%\n", get_bucket_lower(bucket),
+                    get_bucket_upper(bucket) - 1.,
+                    static_cast<unsigned long long>(histogram[bucket]),
+                    100. * static_cast<double>(histogram[bucket]) / static_cast<double>(total));
+    }
+}
+
+//------------------------------------------------------------------------
+void print_profile(const char* path, const dsp::profile_snapshot& snapshot)
+{
+    const double us_per_cycle =
+        snapshot.cycles_per_second > 0. ? 1e6 / snapshot.cycles_per_second : 0.;
+    const double average_cycles =
+        snapshot.num_calls > 0
+            ? static_cast<double>(snapshot.total_cycles) / static_cast<double>(snapshot.num_calls)
+            : 0.;
+
+    std::printf("%s: %.0f Hz, %llu calls, %.3f MHz counter\n", path, snapshot.sample_rate,
+                static_cast<unsigned long long>(snapshot.num_calls),
+                snapshot.cycles_per_second * 1e-6);
+    std::printf("  average %.2f us, worst %.2f us (%s, %d samples, %d points)\n",
+                average_cycles * us_per_cycle,
+                static_cast<double>(snapshot.worst.cycles) * us_per_cycle,
+                dsp::to_string(snapshot.worst.path), snapshot.worst.num_samples,
+                snapshot.worst.num_points);
+
+    for (int index = 0; index < static_cast<int>(dsp::process_path::count); ++index)
+    {
+        const auto& histogram     = snapshot.cycles[index];
+        const std::uint64_t total = get_total(histogram);
+        if (total == 0)
+            continue;
+
+        std::printf("  %s: %llu calls, p50 %.2f us, p99 %.2f us, p99.9 %.2f us\n",
+                    dsp::to_string(static_cast<dsp::process_path>(index)),
+                    static_cast<unsigned long long>(total),
+                    get_percentile(histogram, 50.) * us_per_cycle,
+                    get_percentile(histogram, 99.) * us_per_cycle,
+                    get_percentile(histogram, 99.9) * us_per_cycle);
+        print_cycle_histogram(histogram, us_per_cycle);
+    }
+
+    print_count_histogram("block sizes", snapshot.block_sizes);
+    print_count_histogram("automation points", snapshot.point_counts);
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: gain-profile-dump file.gapr...\n");
+        return 1;
+    }
+
+    int result = 0;
+    for (int index = 1; index < argc; ++index)
+    {
+        dsp::profile_snapshot snapshot;
+        if (!dsp::read_profile(argv[index], snapshot))
+        {
+            std::fprintf(stderr, "error: '%s' is not a readable profile\n", argv[index]);
+            result = 1;
+            continue;
+        }
+
+        print_profile(argv[index], snapshot);
+    }
+    return result;
+}
@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+// Renders a WAV file through GainAutomatorProcessor, without a DAW. The
+// output is written as 32 bit float (64 bit with -d) so it can be compared
+// bit exactly against a reference rendering.
+//
+// Usage: gain-render [-b block_size] [-d] input.wav automation.txt output.wav
+//
+// The automation file holds one point per line:
+//
+//     # <sample position> <normalized value> [parameter id]
+//     0      1.0
+//     48000  0.5
+//     96000  0.0
+//
+// Lines starting with '#' are comments. The parameter id defaults to the
+// gain parameter. Points are sorted by position, a point at the same
+// position as a previous one replaces it.
+
+#include "gain_automator_param_ids.h"
+#include "processor_host.h"
+#include "wav_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ha;
+
+namespace {
+
+//------------------------------------------------------------------------
+struct lane_point
+{
+    long long position;
+    Steinberg::Vst::ParamID id;
+    double value;
+};
+
+//------------------------------------------------------------------------
+bool read_automation(const std::string& path, std::vector<lane_point>& points, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open '" + path + "'";
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        ++line_number;
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream stream(line);
+        lane_point point{0, kParamGainId, 0.};
+        if (!(stream >> point.position >> point.value) || point.position < 0 ||
+            point.value < 0. || point.value > 1.)
+        {
+            error = path + ":" + std::to_string(line_number) + ": expected '<position> <value>'";
+            return false;
+        }
+
+        unsigned int id = 0;
+        if (stream >> id)
+        {
+            if (id >= kNumParams)
+            {
+                error = path + ":" + std::to_string(line_number) + ": unknown parameter id";
+                return false;
+            }
+            point.id = id;
+        }
+
+        points.push_back(point);
+    }
+
+    std::stable_sort(points.begin(), points.end(), [](const lane_point& a, const lane_point& b) {
+        return a.position < b.position;
+    });
+    return true;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+SampleType* get_input(tools::processor_host& host, int channel);
+template <typename SampleType>
+SampleType* get_output(tools::processor_host& host, int channel);
+
+template <>
+float* get_input<float>(tools::processor_host& host, int channel)
+{
+    return host.get_input32(channel);
+}
+
+template <>
+float* get_output<float>(tools::processor_host& host, int channel)
+{
+    return host.get_output32(channel);
+}
+
+template <>
+double* get_input<double>(tools::processor_host& host, int channel)
+{
+    return host.get_input64(channel);
+}
+
+template <>
+double* get_output<double>(tools::processor_host& host, int channel)
+{
+    return host.get_output64(channel);
+}
+
+//------------------------------------------------------------------------
+// Returns the time spent in process() in seconds.
+template <typename SampleType>
+double render(tools::processor_host& host,
+              const std::vector<lane_point>& points,
+              int block_size,
+              const tools::wav_file& input,
+              tools::wav_file& output)
+{
+    using clock = std::chrono::steady_clock;
+
+    const int num_channels     = input.get_num_channels();
+    const long long num_frames = input.get_num_frames();
+    output.channels.assign(num_channels, std::vector<double>(num_frames));
+
+    double process_time = 0.;
+    auto point          = points.begin();
+    for (long long block_start = 0; block_start < num_frames; block_start += block_size)
+    {
+        const int num_samples =
+            static_cast<int>(std::min<long long>(block_size, num_frames - block_start));
+
+        for (int channel = 0; channel < num_channels; ++channel)
+        {
+            const double* src = input.channels[channel].data() + block_start;
+            std::transform(src, src + num_samples, get_input<SampleType>(host, channel),
+                           [](double value) { return static_cast<SampleType>(value); });
+        }
+
+        for (; point != points.end() && point->position < block_start + num_samples; ++point)
+            host.add_point(point->id, static_cast<int>(point->position - block_start),
+                           point->value);
+
+        const auto process_begin = clock::now();
+        host.process(num_samples);
+        process_time += std::chrono::duration<double>(clock::now() - process_begin).count();
+
+        for (int channel = 0; channel < num_channels; ++channel)
+        {
+            const SampleType* dst = get_output<SampleType>(host, channel);
+            std::copy(dst, dst + num_samples, output.channels[channel].begin() + block_start);
+        }
+    }
+
+    return process_time;
+}
+
+//------------------------------------------------------------------------
+int usage(const char* name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-b block_size] [-d] input.wav automation.txt output.wav\n", name);
+    return 1;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int block_size = 512;
+    bool is_double = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            block_size = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-d") == 0)
+            is_double = true;
+        else if (argv[i][0] == '-')
+            return usage(argv[0]);
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.size() != 3 || block_size <= 0)
+        return usage(argv[0]);
+
+    std::string error;
+    tools::wav_file input;
+    std::vector<lane_point> points;
+    if (!tools::read_wav(paths[0], input, error) || !read_automation(paths[1], points, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    tools::processor_host host;
+    if (!host.setup(input.get_num_channels(), block_size, input.sample_rate, is_double))
+    {
+        std::fprintf(stderr, "error: the processor rejects %d channels\n",
+                     input.get_num_channels());
+        return 1;
+    }
+
+    tools::wav_file output;
+    output.sample_rate     = input.sample_rate;
+    output.sample_format   = tools::wav_file::format::ieee_float;
+    output.bits_per_sample = is_double ? 64 : 32;
+
+    const double seconds = is_double ? render<double>(host, points, block_size, input, output)
+                                     : render<float>(host, points, block_size, input, output);
+
+    if (!tools::write_wav(paths[2], output, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    const double num_samples = static_cast<double>(input.get_num_frames());
+    std::printf("%lld frames, %d channels, %zu points, block size %d, %d bit\n",
+                input.get_num_frames(), input.get_num_channels(), points.size(), block_size,
+                output.bits_per_sample);
+    if (num_samples > 0.)
+        std::printf("process: %.3f ms, %.4f ns/sample, %.1fx real time\n", seconds * 1e3,
+                    seconds * 1e9 / num_samples, num_samples / input.sample_rate / seconds);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "processor_host.h"
+
+using namespace Steinberg;
+
+namespace ha {
+namespace tools {
+namespace {
+
+//------------------------------------------------------------------------
+Vst::SpeakerArrangement get_arrangement(int num_channels)
+{
+    switch (num_channels)
+    {
+        case 1: return Vst::SpeakerArr::kMono;
+        case 2: return Vst::SpeakerArr::kStereo;
+        default:
+            // One speaker bit per channel, the processor only counts them.
+            return num_channels >= 64 ? ~Vst::SpeakerArrangement(0)
+                                      : (Vst::SpeakerArrangement(1) << num_channels) - 1;
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// processor_host
+//------------------------------------------------------------------------
+processor_host::processor_host()
+: processor(owned(new GainAutomatorProcessor))
+{
+}
+
+//------------------------------------------------------------------------
+processor_host::~processor_host()
+{
+    shutdown();
+}
+
+//------------------------------------------------------------------------
+void processor_host::shutdown()
+{
+    if (!is_active)
+        return;
+
+    processor->setProcessing(false);
+    processor->setActive(false);
+    processor->terminate();
+    is_active = false;
+}
+
+//------------------------------------------------------------------------
+bool processor_host::setup(int channels,
+                           int max_block_size,
+                           double sample_rate,
+                           bool use_double,
+                           bool use_offline)
+{
+    shutdown();
+
+    if (channels <= 0 || channels > 64 || max_block_size <= 0)
+        return false;
+
+    num_channels         = channels;
+    symbolic_sample_size = use_double ? Vst::kSample64 : Vst::kSample32;
+
+    if (processor->initialize(nullptr) != kResultOk)
+        return false;
+
+    is_active = true;
+
+    Vst::SpeakerArrangement arrangement = get_arrangement(num_channels);
+    if (processor->setBusArrangements(&arrangement, 1, &arrangement, 1) != kResultTrue)
+        return false;
+
+    if (processor->canProcessSampleSize(symbolic_sample_size) != kResultTrue)
+        return false;
+
+    const int32 process_mode = use_offline ? Vst::kOffline : Vst::kRealtime;
+    Vst::ProcessSetup setup{process_mode, symbolic_sample_size, max_block_size, sample_rate};
+    if (processor->setupProcessing(setup) != kResultOk)
+        return false;
+
+    processor->setActive(true);
+    processor->setProcessing(true);
+
+    // All parameters may change in one block.
+    param_changes.setMaxParameters(kNumParams);
+
+    in32.assign(use_double ? 0 : num_channels, std::vector<float>(max_block_size, 0.f));
+    out32.assign(use_double ? 0 : num_channels, std::vector<float>(max_block_size, 0.f));
+    in64.assign(use_double ? num_channels : 0, std::vector<double>(max_block_size, 0.));
+    out64.assign(use_double ? num_channels : 0, std::vector<double>(max_block_size, 0.));
+
+    in_ptrs32.clear();
+    out_ptrs32.clear();
+    in_ptrs64.clear();
+    out_ptrs64.clear();
+    for (int channel = 0; channel < num_channels; ++channel)
+    {
+        if (use_double)
+        {
+            in_ptrs64.push_back(in64[channel].data());
+            out_ptrs64.push_back(out64[channel].data());
+        }
+        else
+        {
+            in_ptrs32.push_back(in32[channel].data());
+            out_ptrs32.push_back(out32[channel].data());
+        }
+    }
+
+    input_bus.numChannels  = num_channels;
+    output_bus.numChannels = num_channels;
+    if (use_double)
+    {
+        input_bus.channelBuffers64  = in_ptrs64.data();
+        output_bus.channelBuffers64 = out_ptrs64.data();
+    }
+    else
+    {
+        input_bus.channelBuffers32  = in_ptrs32.data();
+        output_bus.channelBuffers32 = out_ptrs32.data();
+    }
+
+    data.processMode           = process_mode;
+    data.symbolicSampleSize    = symbolic_sample_size;
+    data.numInputs             = 1;
+    data.numOutputs            = 1;
+    data.inputs                = &input_bus;
+    data.outputs               = &output_bus;
+    data.inputParameterChanges = &param_changes;
+    data.processContext        = &context;
+
+    context.state              = Vst::ProcessContext::kPlaying;
+    context.sampleRate         = sample_rate;
+    context.projectTimeSamples = 0;
+
+    return true;
+}
+
+//------------------------------------------------------------------------
+void processor_host::add_point(Vst::ParamID id, int offset, double value)
+{
+    int32 queue_index = 0;
+    int32 point_index = 0;
+    if (auto* queue = param_changes.addParameterData(id, queue_index))
+        queue->addPoint(offset, value, point_index);
+}
+
+//------------------------------------------------------------------------
+void processor_host::process(int num_samples)
+{
+    data.numSamples = num_samples;
+    processor->process(data);
+    param_changes.clearQueue();
+    context.projectTimeSamples += num_samples;
+}
+
+//------------------------------------------------------------------------
+void processor_host::set_playing(bool is_playing)
+{
+    context.state = is_playing ? Vst::ProcessContext::kPlaying : 0;
+}
+
+//------------------------------------------------------------------------
+int processor_host::get_latency_samples() const
+{
+    return static_cast<int>(processor->getLatencySamples());
+}
+
+//------------------------------------------------------------------------
+} // namespace tools
+} // namespace ha
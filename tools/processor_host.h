@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "gain_automator_processor.h"
+#include "pluginterfaces/base/smartpointer.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+#include <vector>
+
+namespace ha {
+namespace tools {
+
+//------------------------------------------------------------------------
+// processor_host
+//
+// Drives a GainAutomatorProcessor directly, without a plug-in module or a
+// DAW: one input and one output bus with separate buffers, parameter
+// points queued per block and a playing transport starting at 0. Used by
+// the benchmarks and the tools.
+//------------------------------------------------------------------------
+class processor_host
+{
+public:
+    processor_host();
+    ~processor_host();
+
+    // Initializes and activates the processor. 'is_double' selects 64 bit
+    // processing, 'is_offline' the offline process mode, in which large
+    // blocks are processed on several threads. Returns false if the
+    // processor rejects the setup.
+    bool setup(int num_channels,
+               int max_block_size,
+               double sample_rate,
+               bool is_double,
+               bool is_offline = true);
+
+    // Queues a point for the next call to process(). Points of one
+    // parameter must be added in ascending offset order.
+    void add_point(Steinberg::Vst::ParamID id, int offset, double value);
+
+    // Processes 'num_samples' (<= max_block_size) of the input buffers
+    // into the output buffers, clears the queued points and advances the
+    // project time.
+    void process(int num_samples);
+
+    // Moves the transport to 'samples', e.g. to simulate a loop.
+    void set_project_time(Steinberg::int64 samples) { context.projectTimeSamples = samples; }
+    Steinberg::int64 get_project_time() const { return context.projectTimeSamples; }
+
+    // Stops or restarts the transport, playing by default.
+    void set_playing(bool is_playing);
+
+    // As reported to a host, which would delay the other tracks by it.
+    int get_latency_samples() const;
+
+    int get_num_channels() const { return num_channels; }
+    bool is_double() const { return symbolic_sample_size == Steinberg::Vst::kSample64; }
+
+    float* get_input32(int channel) { return in32[channel].data(); }
+    float* get_output32(int channel) { return out32[channel].data(); }
+    double* get_input64(int channel) { return in64[channel].data(); }
+    double* get_output64(int channel) { return out64[channel].data(); }
+
+    // Silence flags of the input bus for the next block, cleared by default.
+    void set_input_silence_flags(Steinberg::uint64 flags) { input_bus.silenceFlags = flags; }
+    Steinberg::uint64 get_output_silence_flags() const { return output_bus.silenceFlags; }
+
+private:
+    void shutdown();
+
+    Steinberg::IPtr<GainAutomatorProcessor> processor;
+    Steinberg::Vst::ParameterChanges param_changes;
+    Steinberg::Vst::AudioBusBuffers input_bus{};
+    Steinberg::Vst::AudioBusBuffers output_bus{};
+    Steinberg::Vst::ProcessContext context{};
+    Steinberg::Vst::ProcessData data{};
+
+    std::vector<std::vector<float>> in32;
+    std::vector<std::vector<float>> out32;
+    std::vector<std::vector<double>> in64;
+    std::vector<std::vector<double>> out64;
+    std::vector<float*> in_ptrs32;
+    std::vector<float*> out_ptrs32;
+    std::vector<double*> in_ptrs64;
+    std::vector<double*> out_ptrs64;
+
+    Steinberg::int32 symbolic_sample_size = Steinberg::Vst::kSample32;
+    int num_channels                      = 0;
+    bool is_active                        = false;
+};
+
+//------------------------------------------------------------------------
+} // namespace tools
+} // namespace ha
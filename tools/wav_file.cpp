@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#include "wav_file.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace ha {
+namespace tools {
+namespace {
+
+//------------------------------------------------------------------------
+constexpr uint16_t kFormatPcm        = 1;
+constexpr uint16_t kFormatIeeeFloat  = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+//------------------------------------------------------------------------
+// WAVE files are little endian, independent of the host.
+uint32_t read_le(const unsigned char* bytes, int num_bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < num_bytes; ++i)
+        value |= uint32_t(bytes[i]) << (8 * i);
+    return value;
+}
+
+//------------------------------------------------------------------------
+void append_le(std::vector<unsigned char>& bytes, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; ++i)
+        bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+//------------------------------------------------------------------------
+double decode_sample(const unsigned char* bytes, const wav_file& wav)
+{
+    if (wav.sample_format == wav_file::format::ieee_float)
+    {
+        if (wav.bits_per_sample == 64)
+        {
+            const uint64_t bits = read_le(bytes, 4) | uint64_t(read_le(bytes + 4, 4)) << 32;
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        const uint32_t bits = read_le(bytes, 4);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Sign extend the integer and scale to [-1, 1)
+    const int num_bytes = wav.bits_per_sample / 8;
+    const uint32_t bits = read_le(bytes, num_bytes) << (32 - wav.bits_per_sample);
+    return static_cast<int32_t>(bits) / 2147483648.;
+}
+
+//------------------------------------------------------------------------
+void encode_sample(std::vector<unsigned char>& bytes, double value, const wav_file& wav)
+{
+    if (wav.sample_format == wav_file::format::ieee_float)
+    {
+        if (wav.bits_per_sample == 64)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            append_le(bytes, bits, 8);
+            return;
+        }
+
+        const float sample = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &sample, sizeof(bits));
+        append_le(bytes, bits, 4);
+        return;
+    }
+
+    const double scale   = std::ldexp(1., wav.bits_per_sample - 1);
+    const double clamped = std::fmax(-scale, std::fmin(scale - 1., std::round(value * scale)));
+    append_le(bytes, static_cast<uint64_t>(static_cast<int64_t>(clamped)),
+              wav.bits_per_sample / 8);
+}
+
+//------------------------------------------------------------------------
+bool is_supported(const wav_file& wav)
+{
+    if (wav.sample_format == wav_file::format::ieee_float)
+        return wav.bits_per_sample == 32 || wav.bits_per_sample == 64;
+
+    return wav.bits_per_sample == 16 || wav.bits_per_sample == 24 || wav.bits_per_sample == 32;
+}
+
+//------------------------------------------------------------------------
+} // namespace
+
+//------------------------------------------------------------------------
+// wav_file
+//------------------------------------------------------------------------
+long long wav_file::get_num_frames() const
+{
+    return channels.empty() ? 0 : static_cast<long long>(channels.front().size());
+}
+
+//------------------------------------------------------------------------
+bool read_wav(const std::string& path, wav_file& wav, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = "cannot open '" + path + "'";
+        return false;
+    }
+
+    unsigned char header[12];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        error = "'" + path + "' is not a RIFF WAVE file";
+        return false;
+    }
+
+    int num_channels = 0;
+    bool has_format  = false;
+    unsigned char chunk_header[8];
+    while (file.read(reinterpret_cast<char*>(chunk_header), sizeof(chunk_header)))
+    {
+        const uint32_t chunk_size = read_le(chunk_header + 4, 4);
+        if (std::memcmp(chunk_header, "fmt ", 4) == 0)
+        {
+            std::vector<unsigned char> fmt(chunk_size);
+            if (chunk_size < 16 || !file.read(reinterpret_cast<char*>(fmt.data()), chunk_size))
+                break;
+
+            uint16_t format_tag = static_cast<uint16_t>(read_le(&fmt[0], 2));
+            if (format_tag == kFormatExtensible && chunk_size >= 40)
+                format_tag = static_cast<uint16_t>(read_le(&fmt[24], 2));
+
+            num_channels        = static_cast<int>(read_le(&fmt[2], 2));
+            wav.sample_rate     = read_le(&fmt[4], 4);
+            wav.bits_per_sample = static_cast<int>(read_le(&fmt[14], 2));
+            wav.sample_format   = format_tag == kFormatIeeeFloat ? wav_file::format::ieee_float
+                                                                 : wav_file::format::pcm;
+            if ((format_tag != kFormatPcm && format_tag != kFormatIeeeFloat) || !is_supported(wav))
+            {
+                error = "'" + path + "' uses an unsupported sample format";
+                return false;
+            }
+            has_format = num_channels > 0;
+        }
+        else if (std::memcmp(chunk_header, "data", 4) == 0 && has_format)
+        {
+            const int frame_size      = num_channels * wav.bits_per_sample / 8;
+            const uint32_t num_frames = chunk_size / frame_size;
+            std::vector<unsigned char> bytes(static_cast<size_t>(num_frames) * frame_size);
+            file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+
+            // Tolerate truncated files, keep what was read.
+            const size_t frames_read = static_cast<size_t>(file.gcount()) / frame_size;
+            wav.channels.assign(num_channels, std::vector<double>(frames_read));
+            const unsigned char* sample = bytes.data();
+            for (size_t frame = 0; frame < frames_read; ++frame)
+            {
+                for (int channel = 0; channel < num_channels; ++channel)
+                {
+                    wav.channels[channel][frame] = decode_sample(sample, wav);
+                    sample += wav.bits_per_sample / 8;
+                }
+            }
+            return true;
+        }
+        else
+        {
+            // Chunks are padded to an even size.
+            file.seekg(chunk_size + (chunk_size & 1), std::ios::cur);
+        }
+    }
+
+    error = "'" + path + "' has no valid format or data chunk";
+    return false;
+}
+
+//------------------------------------------------------------------------
+bool write_wav(const std::string& path, const wav_file& wav, std::string& error)
+{
+    if (!is_supported(wav) || wav.channels.empty())
+    {
+        error = "unsupported output format";
+        return false;
+    }
+
+    const int num_channels     = wav.get_num_channels();
+    const long long num_frames = wav.get_num_frames();
+    const uint32_t block_align = num_channels * wav.bits_per_sample / 8;
+    const uint64_t data_size   = static_cast<uint64_t>(num_frames) * block_align;
+    const bool is_float        = wav.sample_format == wav_file::format::ieee_float;
+    const uint32_t fmt_size    = is_float ? 18 : 16;
+    const uint64_t riff_size   = 4 + (8 + fmt_size) + (8 + data_size + (data_size & 1));
+    if (riff_size > 0xFFFFFFFFu)
+    {
+        error = "output exceeds the 4 GB limit of RIFF WAVE";
+        return false;
+    }
+
+    std::vector<unsigned char> bytes;
+    bytes.reserve(static_cast<size_t>(riff_size) + 8);
+    bytes.insert(bytes.end(), {'R', 'I', 'F', 'F'});
+    append_le(bytes, riff_size, 4);
+    bytes.insert(bytes.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    append_le(bytes, fmt_size, 4);
+    append_le(bytes, is_float ? kFormatIeeeFloat : kFormatPcm, 2);
+    append_le(bytes, num_channels, 2);
+    append_le(bytes, static_cast<uint32_t>(wav.sample_rate), 4);
+    append_le(bytes, static_cast<uint32_t>(wav.sample_rate) * block_align, 4);
+    append_le(bytes, block_align, 2);
+    append_le(bytes, wav.bits_per_sample, 2);
+    if (is_float)
+        append_le(bytes, 0, 2); // cbSize
+    bytes.insert(bytes.end(), {'d', 'a', 't', 'a'});
+    append_le(bytes, data_size, 4);
+
+    for (long long frame = 0; frame < num_frames; ++frame)
+    {
+        for (int channel = 0; channel < num_channels; ++channel)
+            encode_sample(bytes, wav.channels[channel][frame], wav);
+    }
+    if (data_size & 1)
+        bytes.push_back(0);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+    {
+        error = "cannot write '" + path + "'";
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------
+} // namespace tools
+} // namespace ha
@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2021 Hansen Audio.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ha {
+namespace tools {
+
+//------------------------------------------------------------------------
+// wav_file
+//
+// Minimal RIFF WAVE reader and writer for the command line tools. Reads
+// 16, 24 and 32 bit integer PCM and 32 and 64 bit float, plain or
+// WAVE_FORMAT_EXTENSIBLE. Samples are held as double, which represents
+// every supported format exactly.
+//------------------------------------------------------------------------
+struct wav_file
+{
+    enum class format
+    {
+        pcm,
+        ieee_float
+    };
+
+    double sample_rate   = 48000.;
+    int bits_per_sample  = 32;
+    format sample_format = format::ieee_float;
+    std::vector<std::vector<double>> channels;
+
+    int get_num_channels() const { return static_cast<int>(channels.size()); }
+    long long get_num_frames() const;
+};
+
+//------------------------------------------------------------------------
+// Both return false and describe the problem in 'error' on failure.
+bool read_wav(const std::string& path, wav_file& wav, std::string& error);
+bool write_wav(const std::string& path, const wav_file& wav, std::string& error);
+
+//------------------------------------------------------------------------
+} // namespace tools
+} // namespace ha